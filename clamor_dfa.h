@@ -0,0 +1,498 @@
+// Header-only search routines for dense DFAs serialized with
+// `DenseDFA::to_bytes_native_endian`.
+//
+// Calling into the Rust library for every search crosses the FFI boundary,
+// and keeps the search loop from being inlined into the caller. This header
+// instead executes the serialized transition table directly from memory,
+// with the same search loops as `DFA::is_match`, `DFA::shortest_match`,
+// `DFA::find` and `DFA::rfind`, and the same iteration over matches as
+// `Regex::find_iter`. Every routine reports precisely the same results as
+// its Rust counterpart.
+//
+// A `DenseDFA` is templated on its state identifier type and on whether its
+// identifiers are premultiplied and it uses byte classes, which correspond
+// to the variants of the Rust `DenseDFA` enum. This lets the compiler
+// specialize the transition lookup of each search loop. `with_dense_dfa`
+// picks the instantiation matching a serialized DFA at runtime.
+//
+// A DFA never owns its memory. The buffer it is loaded from must outlive it,
+// and must be aligned to the size of its state identifiers. Buffers whose
+// address is a multiple of 8 are always suitably aligned.
+//
+// This requires C++11.
+
+#ifndef CLAMOR_DFA_H
+#define CLAMOR_DFA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace clamor {
+
+/// The offset returned by searches that don't find a match.
+static const size_t NO_MATCH = static_cast<size_t>(-1);
+
+/// Why a serialized DFA could not be loaded.
+enum class LoadError {
+  /// The DFA was loaded.
+  None,
+  /// The buffer is too short to hold the DFA it describes.
+  Truncated,
+  /// The buffer doesn't start with the label of a dense DFA.
+  Label,
+  /// The DFA was serialized with a different endianness.
+  Endianness,
+  /// The format version is not one of 1, 2 or 3.
+  Version,
+  /// The DFA's state identifier size, premultiplication or use of byte
+  /// classes doesn't match the `DenseDFA` instantiation it is loaded into.
+  Kind,
+  /// The transition table isn't aligned to the size of a state identifier.
+  Alignment,
+};
+
+/// The fields of a serialized dense DFA that precede its transition table.
+struct DenseHeader {
+  static const uint16_t MASK_PREMULTIPLIED = 0x1;
+  static const uint16_t MASK_ANCHORED = 0x2;
+  static const uint16_t MASK_POW2_STRIDE = 0x4;
+  static const uint16_t MASK_QUIT = 0x8;
+
+  uint16_t version;
+  /// The size of a state identifier, in bytes: 1, 2, 4 or 8.
+  uint16_t state_size;
+  uint16_t options;
+  uint64_t start;
+  uint64_t state_count;
+  uint64_t max_match;
+  /// The map from each byte to its equivalence class.
+  const uint8_t* classes;
+  /// The number of equivalence classes.
+  size_t alphabet_len;
+  /// The number of entries in each row of the transition table. This
+  /// differs from `alphabet_len` only when rows are padded to a power of
+  /// two.
+  size_t stride;
+  /// The start of the transition table.
+  const uint8_t* trans;
+
+  bool premultiplied() const { return (options & MASK_PREMULTIPLIED) != 0; }
+  bool anchored() const { return (options & MASK_ANCHORED) != 0; }
+  bool byte_classes() const { return alphabet_len != 256; }
+
+  /// The identifier of the quit state, or of the dead state (0) if there are
+  /// no quit bytes. The quit state always directly follows the dead state.
+  uint64_t quit() const {
+    if ((options & MASK_QUIT) == 0) {
+      return 0;
+    }
+    return premultiplied() ? stride : 1;
+  }
+
+  /// Parse the header of the serialized DFA in the `len` bytes at `buf`.
+  static LoadError parse(const void* buf, size_t len, DenseHeader* out) {
+    const uint8_t* p = static_cast<const uint8_t*>(buf);
+    const uint8_t* end = p + len;
+    static const char LABEL[] = "rust-regex-automata-dfa";
+    if (len < sizeof(LABEL) || std::memcmp(p, LABEL, sizeof(LABEL)) != 0) {
+      return LoadError::Label;
+    }
+    p += sizeof(LABEL);
+    // The rest of the header, up to and excluding the anchored start state,
+    // which is only present in versions 2 and 3.
+    if (end - p < 2 + 2 + 2 + 2 + 8 + 8 + 8) {
+      return LoadError::Truncated;
+    }
+    if (read<uint16_t>(&p) != 0xFEFF) {
+      return LoadError::Endianness;
+    }
+    out->version = read<uint16_t>(&p);
+    if (out->version < 1 || out->version > 3) {
+      return LoadError::Version;
+    }
+    out->state_size = read<uint16_t>(&p);
+    out->options = read<uint16_t>(&p);
+    out->start = read<uint64_t>(&p);
+    out->state_count = read<uint64_t>(&p);
+    out->max_match = read<uint64_t>(&p);
+    if (out->version >= 2) {
+      // The anchored start state, which the routines here don't use.
+      if (end - p < 8) {
+        return LoadError::Truncated;
+      }
+      p += 8;
+    }
+    if (end - p < 256) {
+      return LoadError::Truncated;
+    }
+    out->classes = p;
+    p += 256;
+    out->alphabet_len = static_cast<size_t>(out->classes[255]) + 1;
+    out->stride = out->alphabet_len;
+    if ((out->options & MASK_POW2_STRIDE) != 0) {
+      out->stride = 1;
+      while (out->stride < out->alphabet_len) {
+        out->stride <<= 1;
+      }
+    }
+    out->trans = p;
+    uint64_t trans_len = out->state_count * out->stride * out->state_size;
+    if (static_cast<uint64_t>(end - p) < trans_len) {
+      return LoadError::Truncated;
+    }
+    return LoadError::None;
+  }
+
+ private:
+  template <typename T>
+  static T read(const uint8_t** p) {
+    T v;
+    std::memcpy(&v, *p, sizeof(T));
+    *p += sizeof(T);
+    return v;
+  }
+};
+
+/// A dense DFA executed directly from its serialized form.
+///
+/// `S` is the state identifier type, one of `uint8_t`, `uint16_t`,
+/// `uint32_t` or `uint64_t`. A DFA serialized with `usize` identifiers uses
+/// `uint64_t` on 64-bit targets. `Premultiplied` and `ByteClass` must match
+/// how the DFA was built.
+template <typename S, bool Premultiplied, bool ByteClass>
+class DenseDFA {
+ public:
+  /// Create an empty DFA that never matches. Use `from_bytes` to load one.
+  DenseDFA()
+      : trans_(nullptr),
+        classes_(nullptr),
+        stride_(1),
+        start_(0),
+        max_match_(0),
+        quit_(0),
+        anchored_(false) {
+    static const S dead_row[256] = {};
+    static const uint8_t zero_classes[256] = {};
+    trans_ = dead_row;
+    classes_ = zero_classes;
+  }
+
+  /// Load the serialized DFA in the `len` bytes at `buf` into `out`.
+  ///
+  /// The buffer must outlive `out`. If the DFA can't be loaded, then `out`
+  /// is left unchanged and the reason is returned.
+  static LoadError from_bytes(const void* buf, size_t len, DenseDFA* out) {
+    DenseHeader h;
+    LoadError err = DenseHeader::parse(buf, len, &h);
+    if (err != LoadError::None) {
+      return err;
+    }
+    if (h.state_size != sizeof(S) || h.premultiplied() != Premultiplied ||
+        h.byte_classes() != ByteClass) {
+      return LoadError::Kind;
+    }
+    if (reinterpret_cast<uintptr_t>(h.trans) % sizeof(S) != 0) {
+      return LoadError::Alignment;
+    }
+    out->trans_ = reinterpret_cast<const S*>(h.trans);
+    out->classes_ = h.classes;
+    out->stride_ = h.stride;
+    out->start_ = static_cast<S>(h.start);
+    out->max_match_ = static_cast<S>(h.max_match);
+    out->quit_ = static_cast<S>(h.quit());
+    out->anchored_ = h.anchored();
+    return LoadError::None;
+  }
+
+  /// Returns true if and only if this DFA only matches at the beginning of
+  /// a search.
+  bool is_anchored() const { return anchored_; }
+
+  /// Returns true if and only if `text` matches. Like `DFA::is_match`.
+  bool is_match(const uint8_t* text, size_t len) const {
+    return is_match_at(text, len, 0);
+  }
+
+  /// Returns the end of the first match seen, or `NO_MATCH`. Like
+  /// `DFA::shortest_match`.
+  size_t shortest_match(const uint8_t* text, size_t len) const {
+    return shortest_match_at(text, len, 0);
+  }
+
+  /// Returns the end of the leftmost first match, or `NO_MATCH`. Like
+  /// `DFA::find`.
+  size_t find(const uint8_t* text, size_t len) const {
+    return find_at(text, len, 0);
+  }
+
+  /// Returns the start of the leftmost first match of a search from the end
+  /// of `text` to its beginning, or `NO_MATCH`. Like `DFA::rfind`.
+  size_t rfind(const uint8_t* text, size_t len) const {
+    return rfind_at(text, len, len);
+  }
+
+  /// Returns the same as `is_match`, but starts the search at `start`.
+  bool is_match_at(const uint8_t* text, size_t len, size_t start) const {
+    if (anchored_ && start > 0) {
+      return false;
+    }
+    S state = start_;
+    if (is_match_or_dead(state)) {
+      return is_match_state(state);
+    }
+    for (size_t i = start; i < len; i++) {
+      state = next(state, text[i]);
+      if (is_match_or_dead(state)) {
+        return is_match_state(state);
+      }
+    }
+    return false;
+  }
+
+  /// Returns the same as `shortest_match`, but starts the search at
+  /// `start`.
+  size_t shortest_match_at(const uint8_t* text, size_t len,
+                           size_t start) const {
+    if (anchored_ && start > 0) {
+      return NO_MATCH;
+    }
+    S state = start_;
+    if (is_match_or_dead(state)) {
+      return is_dead(state) ? NO_MATCH : start;
+    }
+    for (size_t i = start; i < len; i++) {
+      state = next(state, text[i]);
+      if (is_match_or_dead(state)) {
+        return is_dead(state) ? NO_MATCH : i + 1;
+      }
+    }
+    return NO_MATCH;
+  }
+
+  /// Returns the same as `find`, but starts the search at `start`.
+  size_t find_at(const uint8_t* text, size_t len, size_t start) const {
+    if (anchored_ && start > 0) {
+      return NO_MATCH;
+    }
+    S state = start_;
+    if (is_dead(state)) {
+      return NO_MATCH;
+    }
+    size_t last_match = is_match_state(state) ? start : NO_MATCH;
+    for (size_t i = start; i < len; i++) {
+      state = next(state, text[i]);
+      if (is_match_or_dead(state)) {
+        if (is_dead(state)) {
+          return last_match;
+        }
+        last_match = i + 1;
+      }
+    }
+    return last_match;
+  }
+
+  /// Returns the same as `rfind`, but searches backwards from `start`
+  /// instead of the end of `text`.
+  size_t rfind_at(const uint8_t* text, size_t len, size_t start) const {
+    if (anchored_ && start < len) {
+      return NO_MATCH;
+    }
+    S state = start_;
+    if (is_dead(state)) {
+      return NO_MATCH;
+    }
+    size_t last_match = is_match_state(state) ? start : NO_MATCH;
+    for (size_t i = start; i > 0; i--) {
+      state = next(state, text[i - 1]);
+      if (is_match_or_dead(state)) {
+        if (is_dead(state)) {
+          return last_match;
+        }
+        last_match = i - 1;
+      }
+    }
+    return last_match;
+  }
+
+ private:
+  S next(S id, uint8_t b) const {
+    size_t input = ByteClass ? classes_[b] : b;
+    if (Premultiplied) {
+      return trans_[static_cast<size_t>(id) + input];
+    }
+    return trans_[static_cast<size_t>(id) * stride_ + input];
+  }
+
+  // Match states follow the dead state and the quit state, if any, so one
+  // comparison detects that a search must stop.
+  bool is_match_or_dead(S id) const { return id <= max_match_; }
+  bool is_dead(S id) const { return id <= quit_; }
+  bool is_match_state(S id) const { return id <= max_match_ && id > quit_; }
+
+  const S* trans_;
+  const uint8_t* classes_;
+  size_t stride_;
+  S start_;
+  S max_match_;
+  S quit_;
+  bool anchored_;
+};
+
+/// Load the serialized DFA in the `len` bytes at `buf`, and call `f` with
+/// the `DenseDFA` instantiation that matches it.
+///
+/// `f` must accept a `const DenseDFA<S, P, B>&` for every combination of
+/// state identifier type and flags, e.g., by having a templated call
+/// operator. If the DFA can't be loaded, then `f` isn't called and the
+/// reason is returned.
+template <typename F>
+LoadError with_dense_dfa(const void* buf, size_t len, F&& f);
+
+namespace detail {
+
+template <typename S, bool P, bool B, typename F>
+LoadError call_with(const void* buf, size_t len, F& f) {
+  DenseDFA<S, P, B> dfa;
+  LoadError err = DenseDFA<S, P, B>::from_bytes(buf, len, &dfa);
+  if (err == LoadError::None) {
+    f(static_cast<const DenseDFA<S, P, B>&>(dfa));
+  }
+  return err;
+}
+
+template <typename S, typename F>
+LoadError call_with_flags(const void* buf, size_t len, const DenseHeader& h,
+                          F& f) {
+  if (h.premultiplied()) {
+    return h.byte_classes() ? call_with<S, true, true>(buf, len, f)
+                            : call_with<S, true, false>(buf, len, f);
+  }
+  return h.byte_classes() ? call_with<S, false, true>(buf, len, f)
+                          : call_with<S, false, false>(buf, len, f);
+}
+
+}  // namespace detail
+
+template <typename F>
+LoadError with_dense_dfa(const void* buf, size_t len, F&& f) {
+  DenseHeader h;
+  LoadError err = DenseHeader::parse(buf, len, &h);
+  if (err != LoadError::None) {
+    return err;
+  }
+  switch (h.state_size) {
+    case 1:
+      return detail::call_with_flags<uint8_t>(buf, len, h, f);
+    case 2:
+      return detail::call_with_flags<uint16_t>(buf, len, h, f);
+    case 4:
+      return detail::call_with_flags<uint32_t>(buf, len, h, f);
+    case 8:
+      return detail::call_with_flags<uint64_t>(buf, len, h, f);
+    default:
+      return LoadError::Kind;
+  }
+}
+
+/// A regex made of a forward DFA and a reverse DFA, like the Rust `Regex`.
+///
+/// The reverse DFA must be the one returned by `Regex::reverse` for the same
+/// regex as the forward DFA, i.e., an anchored reverse DFA with longest match
+/// semantics.
+template <typename DFA>
+class Regex {
+ public:
+  Regex(const DFA& forward, const DFA& reverse)
+      : forward_(forward), reverse_(reverse) {}
+
+  const DFA& forward() const { return forward_; }
+  const DFA& reverse() const { return reverse_; }
+
+  /// Returns true if and only if `text` matches.
+  bool is_match(const uint8_t* text, size_t len) const {
+    return forward_.is_match(text, len);
+  }
+
+  /// Find the leftmost first match in `text`, and write its bounds to
+  /// `*start` and `*end`. Returns false if there is no match.
+  bool find(const uint8_t* text, size_t len, size_t* start,
+            size_t* end) const {
+    return find_at(text, len, 0, start, end);
+  }
+
+  /// Returns the same as `find`, but starts the search at `at`.
+  bool find_at(const uint8_t* text, size_t len, size_t at, size_t* start,
+               size_t* end) const {
+    size_t e = forward_.find_at(text, len, at);
+    if (e == NO_MATCH) {
+      return false;
+    }
+    *start = at;
+    // When the forward DFA is anchored, every match begins where the search
+    // does, so there is no need to run the reverse DFA.
+    if (!forward_.is_anchored()) {
+      *start += reverse_.rfind(text + at, e - at);
+    }
+    *end = e;
+    return true;
+  }
+
+  /// An iterator over all non-overlapping leftmost first matches in a text,
+  /// like the Rust `Matches`.
+  class Matches {
+   public:
+    Matches(const Regex& re, const uint8_t* text, size_t len)
+        : re_(re), text_(text), len_(len), last_end_(0),
+          last_match_(NO_MATCH) {}
+
+    /// Write the bounds of the next match to `*start` and `*end`. Returns
+    /// false once there are no more matches.
+    bool next(size_t* start, size_t* end) {
+      while (last_end_ <= len_) {
+        size_t s, e;
+        if (!re_.find_at(text_, len_, last_end_, &s, &e)) {
+          return false;
+        }
+        if (s == e) {
+          // This is an empty match. To ensure we make progress, start the
+          // next search at the smallest possible starting position of the
+          // next match following this one.
+          last_end_ = e + 1;
+          // Don't accept empty matches immediately following a match.
+          if (e == last_match_) {
+            continue;
+          }
+        } else {
+          last_end_ = e;
+        }
+        last_match_ = e;
+        *start = s;
+        *end = e;
+        return true;
+      }
+      return false;
+    }
+
+   private:
+    const Regex& re_;
+    const uint8_t* text_;
+    size_t len_;
+    size_t last_end_;
+    size_t last_match_;
+  };
+
+  /// Returns an iterator over all non-overlapping leftmost first matches in
+  /// `text`.
+  Matches find_iter(const uint8_t* text, size_t len) const {
+    return Matches(*this, text, len);
+  }
+
+ private:
+  DFA forward_;
+  DFA reverse_;
+};
+
+}  // namespace clamor
+
+#endif  // CLAMOR_DFA_H
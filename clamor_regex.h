@@ -3,6 +3,92 @@
 #include <cstdlib>
 #include <new>
 
+/// The maximum number of DFAs that can be combined into a product DFA. Each
+/// DFA is tracked by one bit of a `u8` match set.
+constexpr static const uintptr_t MAX_PRODUCT_DFAS = 8;
+
+/// A group of regexes that answers whether any of them match, trying the
+/// regexes most likely to match cheaply first.
+///
+/// Asking whether a haystack matches any of a large number of regexes by
+/// searching with each regex in a fixed order pays for every regex that
+/// precedes the first one that matches. An `AnyOf` reduces that cost in two
+/// ways:
+///
+/// * Before searching, it makes one pass over the haystack to record which
+/// bytes occur in it. This pass is shared by all regexes in the group. A
+/// regex is skipped without being searched when none of the bytes that can
+/// end one of its matches occur in the haystack.
+/// * It records how often each regex matches and how many bytes each search
+/// with it scans, and periodically reorders the regexes so that those with
+/// the highest rate of matches per byte scanned are tried first.
+///
+/// The search stops at the first regex that matches. Since the order of the
+/// regexes changes over time, which of several matching regexes is reported
+/// may change as well. Whether any regex matches never does.
+///
+/// Searching updates the statistics of this group, and therefore requires a
+/// mutable borrow. Threads that share a set of regexes should each use their
+/// own clone of an `AnyOf`, which also lets each adapt to its own haystacks.
+///
+/// # Example
+///
+/// ```
+/// use regex_automata::{AnyOf, Regex};
+///
+/// # fn example() -> Result<(), regex_automata::Error> {
+/// let mut any = AnyOf::new(vec![
+///     Regex::new("error: [0-9]+")?,
+///     Regex::new("warn(ing)?:")?,
+///     Regex::new("panicked at")?,
+/// ]);
+/// assert!(any.is_match(b"warning: low disk space"));
+/// assert_eq!(Some(2), any.match_index(b"thread 'main' panicked at"));
+/// assert!(!any.is_match(b"all good"));
+/// # Ok(()) }; example().unwrap()
+/// ```
+template<typename D>
+struct AnyOf;
+
+/// A regex whose DFAs are built on a background thread, and which searches
+/// by simulating its NFA until they are ready.
+///
+/// Building the DFAs for a regex can take a long time, especially for big
+/// Unicode-aware patterns or when minimization is enabled. Its NFA, on the
+/// other hand, is cheap to build. An `AsyncRegex` is returned as soon as
+/// the NFA is built, and answers searches by simulating the NFA directly
+/// while the DFAs are built on another thread. Once they are built, every
+/// subsequent search, including searches from other threads, uses them
+/// instead. Simulating an NFA is much slower than searching with a DFA, but
+/// a search never has to wait for the DFAs.
+///
+/// Either way, an `AsyncRegex` always reports the same results as the
+/// corresponding [`Regex`](struct.Regex.html) built via
+/// [`RegexBuilder::build`](struct.RegexBuilder.html#method.build).
+///
+/// An `AsyncRegex` is built with
+/// [`RegexBuilder::build_async`](struct.RegexBuilder.html#method.build_async)
+/// or
+/// [`RegexBuilder::build_async_with`](struct.RegexBuilder.html#method.build_async_with).
+///
+/// # Example
+///
+/// ```
+/// use regex_automata::RegexBuilder;
+///
+/// # fn example() -> Result<(), regex_automata::Error> {
+/// let re = RegexBuilder::new().build_async(r"[0-9]+")?;
+/// // This is answered by either the NFA or the DFAs, depending on whether
+/// // they have been built yet.
+/// assert_eq!(Some((3, 6)), re.find(b"foo123"));
+///
+/// re.wait();
+/// assert!(re.is_ready());
+/// assert_eq!(Some((3, 6)), re.find(b"foo123"));
+/// # Ok(()) }; example().unwrap()
+/// ```
+struct AsyncRegex;
+
 /// A dense table-based deterministic finite automaton (DFA).
 ///
 /// A dense DFA represents the core matching primitive in this crate. That is,
@@ -99,6 +185,48 @@
 template<typename T, typename S>
 struct DenseDFA;
 
+/// A small group of dense DFAs that are always searched together, combined
+/// into a single product DFA when it is small enough.
+///
+/// Each state of a product DFA corresponds to a tuple of states, one from
+/// each of its component DFAs. Following one transition of the product DFA
+/// follows the corresponding transition in every component at once, so a
+/// group of DFAs is searched in a single pass over the haystack with the
+/// cost of searching with one DFA.
+///
+/// A product DFA answers which of its components match anywhere in a
+/// haystack, like calling `DFA::is_match` on each component. Each of its
+/// states records which components have matched so far as a set of match
+/// bits, and the search stops as soon as every component has either matched
+/// or can no longer match.
+///
+/// The number of states in a product DFA can be as large as the product of
+/// the number of states in each component. A product DFA is therefore only
+/// built when it fits within a budget of states. Otherwise, the components
+/// are kept as separate DFAs and searched one after the other, which reports
+/// the same results. [`is_product`](#method.is_product) says which of the two
+/// was chosen.
+///
+/// # Example
+///
+/// ```
+/// use regex_automata::{DenseDFA, ProductDFA};
+///
+/// # fn example() -> Result<(), regex_automata::Error> {
+/// let product = ProductDFA::new(&[
+///     DenseDFA::new("[0-9]+")?,
+///     DenseDFA::new("[a-z]+")?,
+///     DenseDFA::new("[A-Z]+")?,
+/// ]);
+/// assert!(product.is_product());
+/// assert_eq!(0b011, product.which_match(b"abc123"));
+/// assert_eq!(0b100, product.which_match(b"XYZ"));
+/// assert_eq!(0b000, product.which_match(b"!?"));
+/// # Ok(()) }; example().unwrap()
+/// ```
+template<typename S>
+struct ProductDFA;
+
 /// A regular expression that uses deterministic finite automata for fast
 /// searching.
 ///
@@ -194,13 +322,305 @@ struct Regex;
 template<typename D>
 struct Regex;
 
+/// A stream that replaces the matches of a regex in the records written to
+/// it. See `regex_replacer_create`.
+struct RegexReplacer;
+
+/// Splits texts into fields separated by the matches of a regex.
+///
+/// This reports the same fields as
+/// [`Regex::splitn`](struct.Regex.html#method.splitn), as offsets rather
+/// than slices, so that they can be handed across a foreign function
+/// interface in one call.
+///
+/// Many delimiters, such as `,` or `[\t;|]`, match exactly one byte from a
+/// fixed set. A `Splitter` detects such regexes when it is built, and then
+/// finds delimiters by scanning for those bytes directly instead of running
+/// the regex's DFAs. Sets of up to three bytes are scanned a word at a time.
+///
+/// # Example
+///
+/// ```
+/// use regex_automata::{Regex, Splitter};
+///
+/// # fn example() -> Result<(), regex_automata::Error> {
+/// let splitter = Splitter::new(Regex::new("[,;]")?);
+/// assert!(splitter.is_byte_set());
+///
+/// let (mut starts, mut ends) = ([0; 8], [0; 8]);
+/// let n = splitter.fields(b"a,bc;;d", &mut starts, &mut ends);
+/// assert_eq!(&starts[..n], &[0, 2, 5, 6]);
+/// assert_eq!(&ends[..n], &[1, 4, 5, 7]);
+/// # Ok(()) }; example().unwrap()
+/// ```
+template<typename D>
+struct Splitter;
+
 template<typename T>
 struct Vec;
 
+/// Options for `regex_build`. Each corresponds to the `RegexBuilder` option
+/// of the same name. `regex_options_default` returns the default options.
+struct RegexOptions {
+  bool anchored;
+  bool case_insensitive;
+  bool ignore_whitespace;
+  bool dot_matches_new_line;
+  bool swap_greed;
+  bool unicode;
+  bool minimize;
+  bool reverse_unanchored;
+  bool parallel;
+};
+
+/// Where an iteration over the matches of a regex is at, which lets
+/// `regex_find_batch` continue from where an earlier call stopped.
+///
+/// An iteration starts with `last_end` set to `0` and `last_match` set to
+/// `SIZE_MAX`.
+struct RegexCursor {
+  /// The offset at which the next search starts.
+  uintptr_t last_end;
+  /// The end of the last match found, or `SIZE_MAX` if none has been.
+  uintptr_t last_match;
+};
+
 extern "C" {
 
 Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *regex_create(const char *pattern);
 
 uintptr_t regex_match(Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *re, const char *text);
 
+/// Build a regex like `regex_create`, which can also find the last matches
+/// of a text without searching all of it. See `regex_find_last`.
+///
+/// This returns null if the pattern is invalid.
+Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *regex_create_reverse(const char *pattern);
+
+/// Write the start and end offsets of the last `n` matches of `re` in the
+/// `len` bytes at `text` to `starts` and `ends`, in the order in which they
+/// appear in `text`, and return how many matches were written.
+///
+/// `starts` and `ends` must each have room for `n` offsets. For a regex built
+/// by `regex_create_reverse`, this searches `text` backwards from its end and
+/// stops once it has found `n` matches. Otherwise, all of `text` is searched.
+///
+/// The two searches only differ when matches of `re` can overlap. Searching
+/// backwards finds each match relative to the end of the text not yet
+/// searched, like `Regex::rfind_iter`, while searching forwards returns the
+/// last `n` matches found by `Regex::find_iter`. For example, the last match
+/// of `aa` in `aaa` is `[1, 3)` for a regex built by `regex_create_reverse`,
+/// and `[0, 2)` otherwise.
+uintptr_t regex_find_last(const Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *re,
+                          const uint8_t *text,
+                          uintptr_t len,
+                          uintptr_t n,
+                          uintptr_t *starts,
+                          uintptr_t *ends);
+
+/// Return the options `regex_build` uses when it isn't given any.
+RegexOptions regex_options_default();
+
+/// Build a regex from the `len` bytes at `pattern`, which need not be NUL
+/// terminated, using `options`, or the defaults if `options` is null.
+///
+/// This returns null if the regex can't be built. If `error` is not null, it
+/// is then set to a NUL terminated description of the error, which must be
+/// freed with `regex_error_free`. The regex must be freed with `regex_free`.
+Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *regex_build(const uint8_t *pattern,
+                                                        uintptr_t len,
+                                                        const RegexOptions *options,
+                                                        char **error);
+
+/// Free an error description written by `regex_build`.
+void regex_error_free(char *error);
+
+/// Free a regex built by `regex_create`, `regex_create_reverse` or
+/// `regex_build`.
+void regex_free(Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *re);
+
+/// Return whether `re` matches anywhere in the `len` bytes at `text`.
+bool regex_is_match(const Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *re,
+                    const uint8_t *text,
+                    uintptr_t len);
+
+/// Write the start and end offsets of the next `n` matches of `re` in the
+/// `len` bytes at `text` to `starts` and `ends`, and return how many matches
+/// were written. Fewer than `n` are written only once there are no more.
+///
+/// The matches are those `Regex::find_iter` yields, continuing from
+/// `cursor`, which is advanced past them. `starts` and `ends` must each have
+/// room for `n` offsets.
+uintptr_t regex_find_batch(const Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *re,
+                           const uint8_t *text,
+                           uintptr_t len,
+                           RegexCursor *cursor,
+                           uintptr_t n,
+                           uintptr_t *starts,
+                           uintptr_t *ends);
+
+/// Write the `len` bytes at `text` to the `len` bytes at `out`, with every
+/// byte of every match of `re` overwritten by `mask`, and return the number
+/// of matches masked. `out` must not overlap `text`.
+uintptr_t regex_mask_all(const Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *re,
+                         const uint8_t *text,
+                         uintptr_t len,
+                         uint8_t mask,
+                         uint8_t *out);
+
+/// Start a stream that replaces every match of `re` with the
+/// `replacement_len` bytes at `replacement`, and passes its output to
+/// `callback` along with `user_data`.
+///
+/// The input written with `regex_replacer_write` is split into records, each
+/// terminated by `delimiter`, and complete records are replaced and passed
+/// to `callback` as soon as they have been written. The output is the same
+/// as replacing the matches in all of the input at once, provided no match
+/// contains the delimiter. `re` must outlive the stream, which is ended with
+/// `regex_replacer_finish`.
+RegexReplacer *regex_replacer_create(const Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *re,
+                                     const uint8_t *replacement,
+                                     uintptr_t replacement_len,
+                                     uint8_t delimiter,
+                                     void (*callback)(void*, const uint8_t*, uintptr_t),
+                                     void *user_data);
+
+/// Start a stream like `regex_replacer_create`, which overwrites every byte
+/// of every match of `re` with `mask` instead.
+RegexReplacer *regex_masker_create(const Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *re,
+                                   uint8_t mask,
+                                   uint8_t delimiter,
+                                   void (*callback)(void*, const uint8_t*, uintptr_t),
+                                   void *user_data);
+
+/// Write the `len` bytes at `data` to a stream started by
+/// `regex_replacer_create` or `regex_masker_create`.
+void regex_replacer_write(RegexReplacer *replacer, const uint8_t *data, uintptr_t len);
+
+/// End a stream, passing the replaced final record, if it wasn't terminated
+/// by the delimiter, to its callback. This frees the stream, and returns the
+/// number of matches it replaced.
+uintptr_t regex_replacer_finish(RegexReplacer *replacer);
+
+/// Build a splitter for texts whose fields are separated by the matches of
+/// `re`. The regex is copied into the splitter, so it may be freed once the
+/// splitter has been built.
+Splitter<DenseDFA<Vec<uintptr_t>, uintptr_t>> *regex_splitter_create(const Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *re);
+
+/// Write the start and end offsets of the fields of the `len` bytes at
+/// `text` to `starts` and `ends`, and return the number of fields written.
+///
+/// `starts` and `ends` must each have room for `n` offsets. When there are
+/// more than `n` fields, the last field written covers all of the remaining
+/// text. Delimiters that are a single byte from a fixed set, such as `,` or
+/// `[\t;]`, are found without running the regex.
+uintptr_t regex_splitter_fields(const Splitter<DenseDFA<Vec<uintptr_t>, uintptr_t>> *splitter,
+                                const uint8_t *text,
+                                uintptr_t len,
+                                uintptr_t n,
+                                uintptr_t *starts,
+                                uintptr_t *ends);
+
+/// Free a splitter built by `regex_splitter_create`.
+void regex_splitter_free(Splitter<DenseDFA<Vec<uintptr_t>, uintptr_t>> *splitter);
+
+/// Count the matches of `re` in `text` while checking that `text` is valid
+/// UTF-8 in the same pass.
+///
+/// This returns the number of matches, or `-1` if `text` is not valid UTF-8.
+/// In the latter case, the offset of the first invalid byte is written to
+/// `invalid_at` when it is not null.
+intptr_t regex_match_utf8(Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *re,
+                          const char *text,
+                          uintptr_t *invalid_at);
+
+/// Build a group matcher from `len` regexes, which combines their forward
+/// DFAs into a single product DFA when it is small enough.
+///
+/// This returns null if `len` is zero or greater than 8. The regexes may be
+/// freed once the group has been built.
+ProductDFA<uintptr_t> *regex_group_create(const Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *const *res,
+                                          uintptr_t len);
+
+/// Return the set of regexes in `group` that match `text`, where bit `i` is
+/// set if and only if the `i`th regex given to `regex_group_create` matches.
+uint8_t regex_group_match(const ProductDFA<uintptr_t> *group, const char *text);
+
+/// Free a group matcher built by `regex_group_create`.
+void regex_group_free(ProductDFA<uintptr_t> *group);
+
+/// Build a group of `len` regexes that answers whether any of them match,
+/// trying the regexes most likely to match cheaply first.
+///
+/// The regexes are copied into the group, so they may be freed once the
+/// group has been built. `res` may be null when `len` is zero, in which case
+/// the group never matches.
+AnyOf<DenseDFA<Vec<uintptr_t>, uintptr_t>> *regex_any_create(const Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *const *res,
+                                                             uintptr_t len);
+
+/// Return the index of a regex in `any` that matches `text`, or `-1` if none
+/// of them match.
+///
+/// This updates the statistics used to order the regexes, so a group must not
+/// be used by more than one thread at a time.
+intptr_t regex_any_match(AnyOf<DenseDFA<Vec<uintptr_t>, uintptr_t>> *any, const char *text);
+
+/// Free a group built by `regex_any_create`.
+void regex_any_free(AnyOf<DenseDFA<Vec<uintptr_t>, uintptr_t>> *any);
+
+/// Write a selection bitmap for a column of `rows` strings stored as Arrow
+/// style `int32` offsets and a values buffer, where bit `i` (least
+/// significant bit first) is set if and only if row `i` matches `re`.
+///
+/// `offsets` must have `rows + 1` entries and `bitmap` must have room for
+/// one bit per row. `values` and `bitmap` may be null when they would be
+/// empty. When `threads` is greater than 1, ranges of rows are searched on
+/// up to that many threads.
+void regex_select_rows(const Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *re,
+                       const int32_t *offsets,
+                       uintptr_t rows,
+                       const uint8_t *values,
+                       uintptr_t values_len,
+                       uint8_t *bitmap,
+                       uintptr_t threads);
+
+/// Write the number of matches of `re` in each row of a column of `rows`
+/// strings stored as Arrow style `int32` offsets and a values buffer.
+///
+/// `offsets` must have `rows + 1` entries and `counts` must have `rows`
+/// entries. `values` and `counts` may be null when they would be empty.
+/// When `threads` is greater than 1, ranges of rows are searched on up to
+/// that many threads.
+void regex_count_rows(const Regex<DenseDFA<Vec<uintptr_t>, uintptr_t>> *re,
+                      const int32_t *offsets,
+                      uintptr_t rows,
+                      const uint8_t *values,
+                      uintptr_t values_len,
+                      uint32_t *counts,
+                      uintptr_t threads);
+
+/// Build a regex whose DFAs are built on a background thread, and which
+/// simulates the pattern's NFA to answer searches until they are ready.
+///
+/// When `callback` is not null, it is called from the background thread with
+/// `user_data` and whether the DFAs were built, once the build has finished.
+/// If no thread can be spawned, the DFAs are built, and `callback` is called,
+/// on the calling thread before this returns. This returns null if the
+/// pattern is invalid.
+AsyncRegex *regex_create_async(const char *pattern,
+                               void (*callback)(void*, bool),
+                               void *user_data);
+
+/// Count the matches of `re` in `text`, using its DFAs if they are ready.
+uintptr_t regex_async_match(const AsyncRegex *re, const char *text);
+
+/// Return whether the DFAs of `re` have been built.
+bool regex_async_is_ready(const AsyncRegex *re);
+
+/// Free a regex built by `regex_create_async`.
+///
+/// This waits for the background build to finish, so the completion callback
+/// is never called after this returns.
+void regex_async_free(AsyncRegex *re);
+
 } // extern "C"
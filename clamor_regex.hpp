@@ -0,0 +1,366 @@
+// A C++ wrapper around the C API declared in clamor_regex.h.
+//
+// `clamor::Regex` owns a regex built by `regex_build` and frees it when it
+// is destroyed. It can be moved but not copied. Building a regex returns a
+// `clamor::Expected`, which holds either the regex or the error that
+// prevented building it, so nothing here throws.
+//
+// Iterating over matches with `Regex::find_iter` fetches them from the Rust
+// library in batches, which are stored in a fixed buffer inside the range it
+// returns. This makes one call across the FFI boundary per batch rather than
+// one per match:
+//
+//     auto re = clamor::Regex::build("[0-9]+");
+//     if (!re) {
+//       std::cerr << re.error().message() << "\n";
+//       return;
+//     }
+//     for (clamor::Match m : re->find_iter("a1 b22 c333")) {
+//       std::cout << m.start << ".." << m.end << "\n";
+//     }
+//
+// Searches accept a `std::string_view` and, when compiled as C++20, a
+// `std::span<const std::byte>`. This requires C++17.
+
+#ifndef CLAMOR_REGEX_HPP
+#define CLAMOR_REGEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#endif
+
+#include "clamor_regex.h"
+
+namespace clamor {
+
+/// The regex type of the C API.
+using RawRegex = ::Regex<::DenseDFA<::Vec<uintptr_t>, uintptr_t>>;
+
+/// Why a regex couldn't be built.
+class Error {
+ public:
+  explicit Error(std::string message) : message_(std::move(message)) {}
+
+  /// A description of the error, suitable for showing to end users.
+  const std::string& message() const noexcept { return message_; }
+
+ private:
+  std::string message_;
+};
+
+/// Either a value or the error that prevented producing it, like C++23's
+/// `std::expected<T, Error>`.
+///
+/// Accessing the value of an `Expected` holding an error, or the error of an
+/// `Expected` holding a value, is undefined.
+template <typename T>
+class Expected {
+ public:
+  Expected(T value) : ok_(true) { new (&value_) T(std::move(value)); }
+  Expected(Error error) : ok_(false) { new (&error_) Error(std::move(error)); }
+
+  Expected(Expected&& other) : ok_(other.ok_) {
+    if (ok_) {
+      new (&value_) T(std::move(other.value_));
+    } else {
+      new (&error_) Error(std::move(other.error_));
+    }
+  }
+
+  Expected& operator=(Expected&& other) {
+    if (this != &other) {
+      this->~Expected();
+      new (this) Expected(std::move(other));
+    }
+    return *this;
+  }
+
+  ~Expected() {
+    if (ok_) {
+      value_.~T();
+    } else {
+      error_.~Error();
+    }
+  }
+
+  bool has_value() const noexcept { return ok_; }
+  explicit operator bool() const noexcept { return ok_; }
+
+  T& value() & noexcept { return value_; }
+  const T& value() const& noexcept { return value_; }
+  T&& value() && noexcept { return std::move(value_); }
+
+  T& operator*() & noexcept { return value_; }
+  const T& operator*() const& noexcept { return value_; }
+  T&& operator*() && noexcept { return std::move(value_); }
+  T* operator->() noexcept { return &value_; }
+  const T* operator->() const noexcept { return &value_; }
+
+  const Error& error() const noexcept { return error_; }
+
+ private:
+  bool ok_;
+  union {
+    T value_;
+    Error error_;
+  };
+};
+
+/// Options for building a regex. Each corresponds to the `RegexBuilder`
+/// option of the same name.
+class Options {
+ public:
+  Options() noexcept : raw_(regex_options_default()) {}
+
+  Options& anchored(bool yes) noexcept {
+    raw_.anchored = yes;
+    return *this;
+  }
+
+  Options& case_insensitive(bool yes) noexcept {
+    raw_.case_insensitive = yes;
+    return *this;
+  }
+
+  Options& ignore_whitespace(bool yes) noexcept {
+    raw_.ignore_whitespace = yes;
+    return *this;
+  }
+
+  Options& dot_matches_new_line(bool yes) noexcept {
+    raw_.dot_matches_new_line = yes;
+    return *this;
+  }
+
+  Options& swap_greed(bool yes) noexcept {
+    raw_.swap_greed = yes;
+    return *this;
+  }
+
+  Options& unicode(bool yes) noexcept {
+    raw_.unicode = yes;
+    return *this;
+  }
+
+  Options& minimize(bool yes) noexcept {
+    raw_.minimize = yes;
+    return *this;
+  }
+
+  Options& reverse_unanchored(bool yes) noexcept {
+    raw_.reverse_unanchored = yes;
+    return *this;
+  }
+
+  Options& parallel(bool yes) noexcept {
+    raw_.parallel = yes;
+    return *this;
+  }
+
+  const RegexOptions& raw() const noexcept { return raw_; }
+
+ private:
+  RegexOptions raw_;
+};
+
+/// The bounds of a match. `start` is inclusive and `end` is exclusive.
+struct Match {
+  size_t start;
+  size_t end;
+
+  size_t size() const noexcept { return end - start; }
+  bool empty() const noexcept { return start == end; }
+
+  /// Returns the matched part of `text`, which must be the text that was
+  /// searched.
+  std::string_view in(std::string_view text) const noexcept {
+    return text.substr(start, end - start);
+  }
+};
+
+/// A range over all non-overlapping leftmost first matches in a text, like
+/// `Regex::find_iter` in Rust.
+///
+/// This is a single pass range, and the regex and the text must outlive it.
+/// Matches are fetched `BatchSize` at a time.
+template <size_t BatchSize = 64>
+class Matches {
+  static_assert(BatchSize > 0, "BatchSize must be positive");
+
+ public:
+  /// Marks the end of the range.
+  struct sentinel {};
+
+  class iterator {
+   public:
+    using value_type = Match;
+
+    explicit iterator(Matches* m) noexcept : m_(m) {}
+
+    Match operator*() const noexcept {
+      return Match{m_->starts_[m_->pos_], m_->ends_[m_->pos_]};
+    }
+
+    iterator& operator++() noexcept {
+      m_->advance();
+      return *this;
+    }
+
+    bool operator==(sentinel) const noexcept { return m_->done(); }
+    bool operator!=(sentinel) const noexcept { return !m_->done(); }
+
+   private:
+    Matches* m_;
+  };
+
+  Matches(const RawRegex* re, const uint8_t* text, size_t len) noexcept
+      : re_(re), text_(text), len_(len), cursor_{0, SIZE_MAX}, count_(0),
+        pos_(0), fetched_(false) {}
+
+  iterator begin() noexcept {
+    if (!fetched_) {
+      fetch();
+    }
+    return iterator(this);
+  }
+
+  sentinel end() const noexcept { return sentinel(); }
+
+ private:
+  void fetch() noexcept {
+    count_ = regex_find_batch(re_, text_, len_, &cursor_, BatchSize, starts_,
+                              ends_);
+    pos_ = 0;
+    fetched_ = true;
+  }
+
+  void advance() noexcept {
+    // A batch that isn't full means the search is over, so only a full one
+    // is followed by another call.
+    if (++pos_ == count_ && count_ == BatchSize) {
+      fetch();
+    }
+  }
+
+  bool done() const noexcept { return pos_ == count_; }
+
+  const RawRegex* re_;
+  const uint8_t* text_;
+  size_t len_;
+  RegexCursor cursor_;
+  size_t count_;
+  size_t pos_;
+  bool fetched_;
+  uintptr_t starts_[BatchSize];
+  uintptr_t ends_[BatchSize];
+};
+
+/// A regex built with the Rust library, which frees it when destroyed.
+class Regex {
+ public:
+  /// Build a regex with the default options.
+  static Expected<Regex> build(std::string_view pattern) {
+    return build(pattern, Options());
+  }
+
+  /// Build a regex with the given options.
+  static Expected<Regex> build(std::string_view pattern,
+                               const Options& options) {
+    char* err = nullptr;
+    RawRegex* raw =
+        regex_build(reinterpret_cast<const uint8_t*>(pattern.data()),
+                    pattern.size(), &options.raw(), &err);
+    if (raw == nullptr) {
+      Error error(err != nullptr ? err : "failed to build regex");
+      regex_error_free(err);
+      return error;
+    }
+    return Regex(raw);
+  }
+
+  Regex(Regex&& other) noexcept : raw_(other.raw_) { other.raw_ = nullptr; }
+
+  Regex& operator=(Regex&& other) noexcept {
+    std::swap(raw_, other.raw_);
+    return *this;
+  }
+
+  Regex(const Regex&) = delete;
+  Regex& operator=(const Regex&) = delete;
+
+  ~Regex() { regex_free(raw_); }
+
+  /// Returns the underlying regex, for use with the C API. It remains owned
+  /// by this `Regex`.
+  RawRegex* raw() const noexcept { return raw_; }
+
+  /// Returns true if and only if this regex matches anywhere in `text`.
+  bool is_match(std::string_view text) const noexcept {
+    return regex_is_match(raw_, bytes(text), text.size());
+  }
+
+  /// Returns the leftmost first match in `text`, if any.
+  std::optional<Match> find(std::string_view text) const noexcept {
+    return find_raw(bytes(text), text.size());
+  }
+
+  /// Returns a range over all non-overlapping leftmost first matches in
+  /// `text`.
+  template <size_t BatchSize = 64>
+  Matches<BatchSize> find_iter(std::string_view text) const noexcept {
+    return Matches<BatchSize>(raw_, bytes(text), text.size());
+  }
+
+#ifdef __cpp_lib_span
+  bool is_match(std::span<const std::byte> text) const noexcept {
+    return regex_is_match(raw_, bytes(text), text.size());
+  }
+
+  std::optional<Match> find(std::span<const std::byte> text) const noexcept {
+    return find_raw(bytes(text), text.size());
+  }
+
+  template <size_t BatchSize = 64>
+  Matches<BatchSize> find_iter(
+      std::span<const std::byte> text) const noexcept {
+    return Matches<BatchSize>(raw_, bytes(text), text.size());
+  }
+#endif
+
+ private:
+  explicit Regex(RawRegex* raw) noexcept : raw_(raw) {}
+
+  static const uint8_t* bytes(std::string_view text) noexcept {
+    return reinterpret_cast<const uint8_t*>(text.data());
+  }
+
+#ifdef __cpp_lib_span
+  static const uint8_t* bytes(std::span<const std::byte> text) noexcept {
+    return reinterpret_cast<const uint8_t*>(text.data());
+  }
+#endif
+
+  std::optional<Match> find_raw(const uint8_t* text,
+                                size_t len) const noexcept {
+    RegexCursor cursor{0, SIZE_MAX};
+    uintptr_t start, end;
+    if (regex_find_batch(raw_, text, len, &cursor, 1, &start, &end) == 0) {
+      return std::nullopt;
+    }
+    return Match{start, end};
+  }
+
+  RawRegex* raw_;
+};
+
+}  // namespace clamor
+
+#endif  // CLAMOR_REGEX_HPP
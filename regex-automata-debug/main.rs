@@ -1,12 +1,15 @@
+use std::fmt;
 use std::fs;
 use std::io::{self, Write};
 use std::path::PathBuf;
 use std::time::{Duration, Instant};
 
 use anyhow::Result;
-use regex_automata::{dense, nfa, Regex, RegexBuilder, DFA};
+use regex_automata::{dense, nfa, Regex, RegexBuilder, StateID, DFA};
 use regex_syntax as syntax;
 
+mod perf;
+
 fn main() -> Result<()> {
     Command::parse().and_then(|c| c.run())
 }
@@ -22,6 +25,8 @@ enum CommandKind {
     Debug { pattern: String, quiet: bool },
     DebugNFA { pattern: String, quiet: bool },
     Find { pattern: String, path: PathBuf },
+    Bench { patterns: Vec<String>, path: PathBuf, iters: usize },
+    Trace { pattern: String, path: PathBuf, dot: bool },
     Nothing,
 }
 
@@ -38,6 +43,38 @@ struct Stats {
     memory: usize,
 }
 
+/// A single point in the configuration space swept by the `bench` command.
+#[derive(Clone, Copy, Debug)]
+struct BenchConfig {
+    sparse: bool,
+    width: Width,
+    premultiply: bool,
+    classes: bool,
+    minimize: bool,
+}
+
+/// The state identifier representation used by a benchmarked DFA.
+#[derive(Clone, Copy, Debug)]
+enum Width {
+    U16,
+    U32,
+    Usize,
+}
+
+#[derive(Debug, Default)]
+struct BenchResult {
+    compile: Duration,
+    memory: usize,
+    states: usize,
+    matches: usize,
+    /// The fastest of all search iterations.
+    search: Duration,
+    /// Hardware counters for a single search, averaged over all iterations.
+    /// This is only present when `--perf` is given and the counters could
+    /// be opened.
+    counters: Option<perf::Sample>,
+}
+
 impl Command {
     fn parse() -> Result<Command> {
         match app().get_matches().subcommand() {
@@ -65,6 +102,44 @@ impl Command {
                 let path = PathBuf::from(m.value_of_os("path").unwrap());
                 Ok(Command { kind: CommandKind::Find { pattern, path }, args })
             }
+            ("bench", Some(m)) => {
+                let args = Common::new(m);
+                let contents =
+                    fs::read_to_string(m.value_of_os("patterns").unwrap())?;
+                let patterns = contents
+                    .lines()
+                    .filter(|line| !line.is_empty())
+                    .map(|line| line.to_string())
+                    .collect();
+                let path = PathBuf::from(m.value_of_os("path").unwrap());
+                let iters = match m.value_of("iters") {
+                    None => 3,
+                    Some(n) => n.parse()?,
+                };
+                if iters == 0 {
+                    anyhow::bail!("--iters must be at least 1");
+                }
+                Ok(Command {
+                    kind: CommandKind::Bench { patterns, path, iters },
+                    args,
+                })
+            }
+            ("trace", Some(m)) => {
+                let args = Common::new(m);
+                let pattern = pattern_from_matches(m)?;
+                let path = PathBuf::from(m.value_of_os("path").unwrap());
+                let dot = match m.value_of("format") {
+                    None | Some("json") => false,
+                    Some("dot") => true,
+                    Some(unknown) => {
+                        anyhow::bail!("unrecognized trace format: {}", unknown)
+                    }
+                };
+                Ok(Command {
+                    kind: CommandKind::Trace { pattern, path, dot },
+                    args,
+                })
+            }
             ("", _) => {
                 app().print_help()?;
                 println!("");
@@ -84,6 +159,8 @@ impl Command {
             CommandKind::Debug { .. } => self.run_debug(),
             CommandKind::DebugNFA { .. } => self.run_debug_nfa(),
             CommandKind::Find { .. } => self.run_find(),
+            CommandKind::Bench { .. } => self.run_bench(),
+            CommandKind::Trace { .. } => self.run_trace(),
             CommandKind::Nothing => Ok(()),
         }
     }
@@ -139,18 +216,199 @@ impl Command {
         let read_time = Instant::now().duration_since(start);
         writeln!(stdout, "   read time: {:?}", read_time)?;
 
+        let counters = self.counters(&mut stdout)?;
         let start = Instant::now();
-        let matches = finder(&data);
+        let (matches, sample) = match counters {
+            None => (finder(&data), None),
+            Some(ref counters) => {
+                let (matches, sample) = counters.measure(|| finder(&data));
+                (matches, Some(sample))
+            }
+        };
         let match_time = Instant::now().duration_since(start);
         writeln!(stdout, "  match time: {:?}", match_time)?;
 
         writeln!(stdout, " match count: {}", matches)?;
+        if let Some(sample) = sample {
+            writeln!(stdout, "    counters: {}", sample)?;
+        }
+        Ok(())
+    }
+
+    fn run_bench(&self) -> Result<()> {
+        let (patterns, iters) = match self.kind {
+            CommandKind::Bench { ref patterns, iters, .. } => {
+                (patterns, iters)
+            }
+            _ => unreachable!(),
+        };
+        let mut stdout = io::stdout();
+
+        let data = self.data()?;
+        let counters = self.counters(&mut stdout)?;
+        writeln!(stdout, "corpus size: {}", data.len())?;
+        writeln!(stdout, " iterations: {}", iters)?;
+        for pattern in patterns {
+            writeln!(stdout, "")?;
+            writeln!(stdout, "pattern: {}", pattern)?;
+            writeln!(
+                stdout,
+                "{:<36} {:>12} {:>10} {:>8} {:>8} {:>8}",
+                "config", "compile", "memory", "states", "GB/s", "matches",
+            )?;
+            for config in BenchConfig::all() {
+                let c = counters.as_ref();
+                let result = match config.width {
+                    Width::U16 => {
+                        self.bench::<u16>(pattern, &config, &data, c)
+                    }
+                    Width::U32 => {
+                        self.bench::<u32>(pattern, &config, &data, c)
+                    }
+                    Width::Usize => {
+                        self.bench::<usize>(pattern, &config, &data, c)
+                    }
+                };
+                let r = match result {
+                    Ok(r) => r,
+                    Err(err) => {
+                        writeln!(stdout, "{:<36} error: {}", config, err)?;
+                        continue;
+                    }
+                };
+                let gbps = (data.len() as f64)
+                    / r.search.as_secs_f64()
+                    / (1 << 30) as f64;
+                writeln!(
+                    stdout,
+                    "{:<36} {:>12?} {:>10} {:>8} {:>8.3} {:>8}",
+                    config, r.compile, r.memory, r.states, gbps, r.matches,
+                )?;
+                if let Some(sample) = r.counters {
+                    writeln!(stdout, "    {}", sample)?;
+                }
+            }
+        }
+        Ok(())
+    }
+
+    #[cfg(feature = "trace")]
+    fn run_trace(&self) -> Result<()> {
+        use regex_automata::Trace;
+
+        let dot = match self.kind {
+            CommandKind::Trace { dot, .. } => dot,
+            _ => unreachable!(),
+        };
+        let mut stdout = io::stdout();
+        let mut stderr = io::stderr();
+
+        let data = self.data()?;
+        let dfa = self.dense_builder().build(self.pattern())?;
+        let (matches, trace) = if self.args.sparse {
+            let sdfa = dfa.to_sparse()?;
+            Trace::record(|| count_dfa_matches(&sdfa, &data))
+        } else {
+            Trace::record(|| count_dfa_matches(&dfa, &data))
+        };
+        writeln!(stderr, "   match count: {}", matches)?;
+        writeln!(stderr, "    state count: {}", dfa.state_count())?;
+        writeln!(stderr, " visited states: {}", trace.states().len())?;
+        if dot {
+            write!(stdout, "{}", trace.to_dot())?;
+        } else {
+            write!(stdout, "{}", trace.to_json())?;
+        }
         Ok(())
     }
 
+    #[cfg(not(feature = "trace"))]
+    fn run_trace(&self) -> Result<()> {
+        anyhow::bail!(
+            "tracing is not available, rebuild with '--features trace'"
+        )
+    }
+
+    fn bench<S: StateID + 'static>(
+        &self,
+        pattern: &str,
+        config: &BenchConfig,
+        data: &[u8],
+        counters: Option<&perf::Counters>,
+    ) -> Result<BenchResult> {
+        let iters = match self.kind {
+            CommandKind::Bench { iters, .. } => iters,
+            _ => unreachable!(),
+        };
+        let mut builder = self.regex_builder();
+        builder
+            .minimize(config.minimize)
+            .premultiply(config.premultiply)
+            .byte_classes(config.classes);
+
+        let mut result = BenchResult::default();
+        let start = Instant::now();
+        let finder = if config.sparse {
+            let re = builder.build_with_size_sparse::<S>(pattern)?;
+            result.memory =
+                re.forward().memory_usage() + re.reverse().memory_usage();
+            result.states =
+                re.forward().state_count() + re.reverse().state_count();
+            counter(re)
+        } else {
+            let re = builder.build_with_size::<S>(pattern)?;
+            result.memory =
+                re.forward().memory_usage() + re.reverse().memory_usage();
+            result.states =
+                re.forward().state_count() + re.reverse().state_count();
+            counter(re)
+        };
+        result.compile = Instant::now().duration_since(start);
+
+        let mut run = || {
+            for i in 0..iters {
+                let start = Instant::now();
+                result.matches = finder(data);
+                let elapsed = Instant::now().duration_since(start);
+                if i == 0 || elapsed < result.search {
+                    result.search = elapsed;
+                }
+            }
+        };
+        let sample = counters.map(|c| c.measure(&mut run).1);
+        if sample.is_none() {
+            run();
+        }
+        result.counters = sample.map(|s| s.per(iters as u64));
+        Ok(result)
+    }
+
+    /// Open hardware performance counters if `--perf` was given. If they
+    /// could not be opened, a note is written and searching continues
+    /// without them.
+    fn counters<W: Write>(
+        &self,
+        mut wtr: W,
+    ) -> Result<Option<perf::Counters>> {
+        if !self.args.perf {
+            return Ok(None);
+        }
+        let counters = perf::Counters::new();
+        if counters.is_none() {
+            writeln!(
+                wtr,
+                "note: hardware counters unavailable \
+                 (not Linux, or perf_event_paranoid is too restrictive)",
+            )?;
+        }
+        Ok(counters)
+    }
+
     fn data(&self) -> Result<Vec<u8>> {
         let path = match self.kind {
             CommandKind::Find { ref path, .. } => path,
+            CommandKind::Bench { ref path, .. } => path,
+            CommandKind::Trace { ref path, .. } => path,
             _ => unreachable!(),
         };
         Ok(fs::read(path)?)
@@ -161,6 +419,7 @@ impl Command {
             CommandKind::Debug { ref pattern, .. } => pattern,
             CommandKind::DebugNFA { ref pattern, .. } => pattern,
             CommandKind::Find { ref pattern, .. } => pattern,
+            CommandKind::Trace { ref pattern, .. } => pattern,
             _ => unreachable!(),
         }
     }
@@ -281,6 +540,7 @@ struct Common {
     reverse: bool,
     longest_match: bool,
     shrink_nfa: bool,
+    perf: bool,
 }
 
 impl Common {
@@ -297,14 +557,84 @@ impl Common {
             reverse: m.is_present("reverse"),
             longest_match: m.is_present("longest-match"),
             shrink_nfa: m.is_present("shrink-nfa"),
+            perf: m.is_present("perf"),
         }
     }
 }
 
+impl BenchConfig {
+    /// Return every configuration worth benchmarking. Premultiplication has
+    /// no effect on sparse DFAs, so it is only varied for dense DFAs.
+    fn all() -> Vec<BenchConfig> {
+        let mut configs = vec![];
+        for &sparse in &[false, true] {
+            for &width in &[Width::U16, Width::U32, Width::Usize] {
+                for &premultiply in &[false, true] {
+                    if sparse && premultiply {
+                        continue;
+                    }
+                    for &classes in &[false, true] {
+                        for &minimize in &[false, true] {
+                            configs.push(BenchConfig {
+                                sparse,
+                                width,
+                                premultiply,
+                                classes,
+                                minimize,
+                            });
+                        }
+                    }
+                }
+            }
+        }
+        configs
+    }
+}
+
+impl fmt::Display for BenchConfig {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        let kind = if self.sparse { "sparse" } else { "dense" };
+        let width = match self.width {
+            Width::U16 => "u16",
+            Width::U32 => "u32",
+            Width::Usize => "usize",
+        };
+        let mut label = format!("{}/{}", kind, width);
+        if self.premultiply {
+            label.push_str("/premultiply");
+        }
+        if self.classes {
+            label.push_str("/classes");
+        }
+        if self.minimize {
+            label.push_str("/minimize");
+        }
+        // Pad the rendered label, so that width specifiers in callers work.
+        f.pad(&label)
+    }
+}
+
 fn counter<D: DFA + 'static>(re: Regex<D>) -> Box<dyn Fn(&[u8]) -> usize> {
     Box::new(move |bytes| re.find_iter(bytes).count())
 }
 
+/// Count the matches of a single DFA by repeatedly searching from the end of
+/// the previous match. Unlike `counter`, this does not use a reverse DFA, so
+/// that only the given DFA's states show up in a trace.
+#[cfg(feature = "trace")]
+fn count_dfa_matches<D: DFA>(dfa: &D, bytes: &[u8]) -> usize {
+    let (mut count, mut at) = (0, 0);
+    while at <= bytes.len() {
+        let end = match dfa.find_at(bytes, at) {
+            None => break,
+            Some(end) => end,
+        };
+        count += 1;
+        at = if end == at { end + 1 } else { end };
+    }
+    count
+}
+
 fn pattern_from_matches(m: &clap::ArgMatches) -> Result<String> {
     if !m.is_present("file") {
         Ok(m.value_of("pattern").unwrap().to_string())
@@ -350,7 +680,32 @@ fn app() -> clap::App<'static, 'static> {
     let cmd_find = cmd("find")
         .about("Search in file with automata.")
         .arg(pos("pattern").required(true))
-        .arg(pos("path").required(true));
+        .arg(pos("path").required(true))
+        .arg(flag("perf"));
+    let cmd_trace = cmd("trace")
+        .about(
+            "Search in file with a single DFA and write its state and \
+             transition visit counts as JSON or DOT. This requires building \
+             with '--features trace'.",
+        )
+        .arg(pos("pattern").required(true))
+        .arg(pos("path").required(true))
+        .arg(
+            flag("format").takes_value(true).possible_values(&["json", "dot"]),
+        );
+    let cmd_bench = cmd("bench")
+        .about(
+            "Benchmark every DFA configuration for each pattern in a file \
+             (one per line) against a corpus.",
+        )
+        .arg(pos("patterns").required(true))
+        .arg(pos("path").required(true))
+        .arg(flag("iters").short("n").takes_value(true))
+        .arg(flag("perf"))
+        .arg(flag("anchored").short("a"))
+        .arg(flag("case-insensitive").short("i"))
+        .arg(flag("no-unicode"))
+        .arg(flag("no-utf8").short("u"));
 
     clap::App::new("Search using regex-automata")
         .author(clap::crate_authors!())
@@ -359,4 +714,6 @@ fn app() -> clap::App<'static, 'static> {
         .subcommand(common(cmd_debug))
         .subcommand(common(cmd_debug_nfa))
         .subcommand(common(cmd_find))
+        .subcommand(cmd_bench)
+        .subcommand(common(cmd_trace))
 }
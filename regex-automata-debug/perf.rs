@@ -0,0 +1,304 @@
+// A small wrapper around Linux's perf_event_open(2) for sampling hardware
+// counters around a search loop. Each event is opened independently (rather
+// than as a group) so that events the kernel or CPU refuses to count (which
+// is common inside virtual machines) are simply reported as unavailable
+// instead of disabling every counter.
+//
+// On platforms other than Linux, `Counters::new` always returns `None`.
+
+use std::fmt;
+
+/// The hardware events that we sample.
+#[derive(Clone, Copy, Debug)]
+pub enum Event {
+    Cycles,
+    Instructions,
+    L1DMisses,
+    LLCMisses,
+    DTLBMisses,
+    BranchMisses,
+}
+
+const EVENTS: &[Event] = &[
+    Event::Cycles,
+    Event::Instructions,
+    Event::L1DMisses,
+    Event::LLCMisses,
+    Event::DTLBMisses,
+    Event::BranchMisses,
+];
+
+/// A snapshot of counter values. An event is `None` when it could not be
+/// opened on this machine.
+#[derive(Clone, Debug, Default)]
+pub struct Sample {
+    pub cycles: Option<u64>,
+    pub instructions: Option<u64>,
+    pub l1d_misses: Option<u64>,
+    pub llc_misses: Option<u64>,
+    pub dtlb_misses: Option<u64>,
+    pub branch_misses: Option<u64>,
+}
+
+impl Sample {
+    /// Instructions retired per cycle, if both events were counted.
+    pub fn ipc(&self) -> Option<f64> {
+        match (self.instructions, self.cycles) {
+            (Some(i), Some(c)) if c > 0 => Some(i as f64 / c as f64),
+            _ => None,
+        }
+    }
+
+    /// Divide every counter by `n`. This is used to report counts per
+    /// search when a search is repeated several times.
+    pub fn per(&self, n: u64) -> Sample {
+        let div = |v: Option<u64>| v.map(|v| v / n);
+        Sample {
+            cycles: div(self.cycles),
+            instructions: div(self.instructions),
+            l1d_misses: div(self.l1d_misses),
+            llc_misses: div(self.llc_misses),
+            dtlb_misses: div(self.dtlb_misses),
+            branch_misses: div(self.branch_misses),
+        }
+    }
+
+    fn set(&mut self, event: Event, value: u64) {
+        let slot = match event {
+            Event::Cycles => &mut self.cycles,
+            Event::Instructions => &mut self.instructions,
+            Event::L1DMisses => &mut self.l1d_misses,
+            Event::LLCMisses => &mut self.llc_misses,
+            Event::DTLBMisses => &mut self.dtlb_misses,
+            Event::BranchMisses => &mut self.branch_misses,
+        };
+        *slot = Some(value);
+    }
+}
+
+impl fmt::Display for Sample {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        fn show(v: Option<u64>) -> String {
+            v.map(|v| v.to_string()).unwrap_or("n/a".to_string())
+        }
+        let ipc = self.ipc().map(|v| format!("{:.2}", v));
+        write!(
+            f,
+            "L1d-miss: {}, LLC-miss: {}, dTLB-miss: {}, \
+             branch-miss: {}, IPC: {}",
+            show(self.l1d_misses),
+            show(self.llc_misses),
+            show(self.dtlb_misses),
+            show(self.branch_misses),
+            ipc.unwrap_or("n/a".to_string()),
+        )
+    }
+}
+
+/// A set of open hardware counters for the current thread.
+#[derive(Debug)]
+pub struct Counters {
+    fds: Vec<(Event, i32)>,
+}
+
+impl Counters {
+    /// Open every supported counter for the calling thread. This returns
+    /// `None` if no counter at all could be opened, e.g., because
+    /// `perf_event_paranoid` forbids it or this isn't Linux.
+    pub fn new() -> Option<Counters> {
+        let fds: Vec<(Event, i32)> = EVENTS
+            .iter()
+            .filter_map(|&event| sys::open(event).map(|fd| (event, fd)))
+            .collect();
+        if fds.is_empty() {
+            None
+        } else {
+            Some(Counters { fds })
+        }
+    }
+
+    /// Run `f` with all counters enabled and return the counts accumulated
+    /// while it ran along with its result.
+    pub fn measure<T, F: FnOnce() -> T>(&self, f: F) -> (T, Sample) {
+        for &(_, fd) in &self.fds {
+            sys::reset(fd);
+            sys::enable(fd);
+        }
+        let result = f();
+        for &(_, fd) in &self.fds {
+            sys::disable(fd);
+        }
+        let mut sample = Sample::default();
+        for &(event, fd) in &self.fds {
+            if let Some(value) = sys::read(fd) {
+                sample.set(event, value);
+            }
+        }
+        (result, sample)
+    }
+}
+
+impl Drop for Counters {
+    fn drop(&mut self) {
+        for &(_, fd) in &self.fds {
+            sys::close(fd);
+        }
+    }
+}
+
+#[cfg(target_os = "linux")]
+mod sys {
+    use std::mem::size_of;
+
+    use super::Event;
+
+    const PERF_TYPE_HARDWARE: u32 = 0;
+    const PERF_TYPE_HW_CACHE: u32 = 3;
+
+    const PERF_COUNT_HW_CPU_CYCLES: u64 = 0;
+    const PERF_COUNT_HW_INSTRUCTIONS: u64 = 1;
+    const PERF_COUNT_HW_BRANCH_MISSES: u64 = 5;
+
+    const PERF_COUNT_HW_CACHE_L1D: u64 = 0;
+    const PERF_COUNT_HW_CACHE_LL: u64 = 2;
+    const PERF_COUNT_HW_CACHE_DTLB: u64 = 3;
+    const PERF_COUNT_HW_CACHE_OP_READ: u64 = 0;
+    const PERF_COUNT_HW_CACHE_RESULT_MISS: u64 = 1;
+
+    const FLAG_DISABLED: u64 = 1 << 0;
+    const FLAG_EXCLUDE_KERNEL: u64 = 1 << 5;
+    const FLAG_EXCLUDE_HV: u64 = 1 << 6;
+
+    // _IO('$', n)
+    const PERF_EVENT_IOC_ENABLE: libc::c_ulong = 0x2400;
+    const PERF_EVENT_IOC_DISABLE: libc::c_ulong = 0x2401;
+    const PERF_EVENT_IOC_RESET: libc::c_ulong = 0x2403;
+
+    /// The first published version of `struct perf_event_attr`
+    /// (PERF_ATTR_SIZE_VER0). The kernel accepts any known size, and this
+    /// prefix contains every field we need.
+    #[repr(C)]
+    #[derive(Default)]
+    struct Attr {
+        kind: u32,
+        size: u32,
+        config: u64,
+        sample_period: u64,
+        sample_type: u64,
+        read_format: u64,
+        flags: u64,
+        wakeup_events: u32,
+        bp_type: u32,
+        config1: u64,
+    }
+
+    fn cache(id: u64) -> u64 {
+        id | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+    }
+
+    pub fn open(event: Event) -> Option<i32> {
+        let (kind, config) = match event {
+            Event::Cycles => (PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES),
+            Event::Instructions => {
+                (PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS)
+            }
+            Event::BranchMisses => {
+                (PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES)
+            }
+            Event::L1DMisses => {
+                (PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_L1D))
+            }
+            Event::LLCMisses => {
+                (PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_LL))
+            }
+            Event::DTLBMisses => {
+                (PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_DTLB))
+            }
+        };
+        let attr = Attr {
+            kind,
+            size: size_of::<Attr>() as u32,
+            config,
+            flags: FLAG_DISABLED | FLAG_EXCLUDE_KERNEL | FLAG_EXCLUDE_HV,
+            ..Attr::default()
+        };
+        // pid = 0 and cpu = -1 measures the calling thread on any CPU.
+        let fd = unsafe {
+            libc::syscall(
+                libc::SYS_perf_event_open,
+                &attr as *const Attr,
+                0 as libc::pid_t,
+                -1 as libc::c_int,
+                -1 as libc::c_int,
+                0 as libc::c_ulong,
+            )
+        };
+        if fd < 0 {
+            None
+        } else {
+            Some(fd as i32)
+        }
+    }
+
+    pub fn enable(fd: i32) {
+        unsafe {
+            libc::ioctl(fd, PERF_EVENT_IOC_ENABLE as _, 0);
+        }
+    }
+
+    pub fn disable(fd: i32) {
+        unsafe {
+            libc::ioctl(fd, PERF_EVENT_IOC_DISABLE as _, 0);
+        }
+    }
+
+    pub fn reset(fd: i32) {
+        unsafe {
+            libc::ioctl(fd, PERF_EVENT_IOC_RESET as _, 0);
+        }
+    }
+
+    pub fn read(fd: i32) -> Option<u64> {
+        let mut value: u64 = 0;
+        let n = unsafe {
+            libc::read(
+                fd,
+                &mut value as *mut u64 as *mut libc::c_void,
+                size_of::<u64>(),
+            )
+        };
+        if n == size_of::<u64>() as isize {
+            Some(value)
+        } else {
+            None
+        }
+    }
+
+    pub fn close(fd: i32) {
+        unsafe {
+            libc::close(fd);
+        }
+    }
+}
+
+#[cfg(not(target_os = "linux"))]
+mod sys {
+    use super::Event;
+
+    pub fn open(_: Event) -> Option<i32> {
+        None
+    }
+
+    pub fn enable(_: i32) {}
+
+    pub fn disable(_: i32) {}
+
+    pub fn reset(_: i32) {}
+
+    pub fn read(_: i32) -> Option<u64> {
+        None
+    }
+
+    pub fn close(_: i32) {}
+}
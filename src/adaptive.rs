@@ -0,0 +1,611 @@
+use std::time::{Duration, Instant};
+
+use byte_set::ByteSet;
+use dense::{self, DenseDFA};
+use dfa::DFA;
+use error::{Error, Result};
+use nfa::{PikeVM, NFA};
+use sparse::SparseDFA;
+
+/// The number of searches between two reconsiderations of the strategy of
+/// an `AdaptiveRegex`. The strategy is fixed during the first window.
+const WINDOW: u64 = 256;
+
+/// A regex that picks how to search based on the haystacks it searches.
+///
+/// A [`Regex`](struct.Regex.html) fixes its representation when it is
+/// built, yet the best representation depends on how the regex is used. An
+/// `AdaptiveRegex` measures the time its forward searches take and the bytes
+/// they scan and skip, and changes its strategy without any involvement from
+/// the caller:
+///
+/// * Its forward DFA starts out as a compact sparse DFA. The time taken to
+/// build the equivalent dense DFA is recorded. Once the time spent searching
+/// with the sparse DFA exceeds that, the dense DFA is built again from the
+/// pattern's NFA and used for all subsequent searches, since it is faster to
+/// search but uses more memory. Regexes that are rarely used never keep a
+/// dense DFA.
+/// * While its forward DFA is in its start state, it skips ahead to the next
+/// byte that leads out of the start state, without following transitions.
+/// It records how many bytes this skips. When fewer than a quarter of the
+/// bytes scanned in a window are skipped, the skip loop is mostly overhead
+/// and is disabled.
+/// * Its reverse DFA, which is only needed to find the start of a match, is
+/// built the first time a search has to find one. Regexes that are only
+/// used to detect matches, or that never match, never build it. If it
+/// cannot be built, the start of each match is found by simulating the
+/// pattern's NFA instead.
+///
+/// Whatever the strategy, the results are always the same as the results of
+/// the corresponding `Regex` built via
+/// [`RegexBuilder::build`](struct.RegexBuilder.html#method.build).
+///
+/// Searching updates the statistics of this regex, and therefore requires a
+/// mutable borrow. Threads that share a pattern should each use their own
+/// clone of an `AdaptiveRegex`.
+///
+/// # Example
+///
+/// ```
+/// use regex_automata::RegexBuilder;
+///
+/// # fn example() -> Result<(), regex_automata::Error> {
+/// let mut re = RegexBuilder::new().build_adaptive(r"[0-9]+")?;
+/// assert!(!re.is_dense());
+/// assert!(re.is_match(b"foo123"));
+/// assert!(!re.has_reverse());
+/// assert_eq!(Some((3, 6)), re.find(b"foo123"));
+/// assert!(re.has_reverse());
+/// # Ok(()) }; example().unwrap()
+/// ```
+#[derive(Clone, Debug)]
+pub struct AdaptiveRegex {
+    pattern: String,
+    builder: dense::Builder,
+    nfa: NFA,
+    forward: Forward,
+    /// The error that prevented building the dense forward DFA, if building
+    /// it failed.
+    dense_error: Option<Error>,
+    reverse: Option<Reverse>,
+    /// The bytes that lead the forward DFA out of its start state, when
+    /// skipping the others is enabled.
+    skip: Option<ByteSet>,
+    /// The time it took to build the dense forward DFA.
+    build_time: Duration,
+    /// The time spent searching with the sparse forward DFA.
+    sparse_time: Duration,
+    searches: u64,
+    window: Window,
+}
+
+/// The representation of the forward DFA of an `AdaptiveRegex`.
+#[derive(Clone, Debug)]
+enum Forward {
+    Sparse(SparseDFA<Vec<u8>, usize>),
+    Dense(DenseDFA<Vec<usize>, usize>),
+}
+
+/// What an `AdaptiveRegex` uses to find the start of a match.
+#[derive(Clone, Debug)]
+enum Reverse {
+    /// The reverse DFA for the pattern.
+    DFA(DenseDFA<Vec<usize>, usize>),
+    /// The pattern's NFA, which is simulated because building its reverse
+    /// DFA failed with the given error.
+    NFA(PikeVM, Error),
+}
+
+/// What was measured by the searches in the current window.
+#[derive(Clone, Debug, Default)]
+struct Window {
+    /// The number of bytes that searches moved past, including skipped ones.
+    scanned: u64,
+    /// The number of bytes that searches skipped in the start state.
+    skipped: u64,
+}
+
+impl AdaptiveRegex {
+    pub(crate) fn new(
+        pattern: &str,
+        builder: dense::Builder,
+    ) -> Result<AdaptiveRegex> {
+        let started = Instant::now();
+        let nfa = builder.build_nfa(pattern)?;
+        let dense = builder.build_from_nfa(&nfa)?;
+        let build_time = started.elapsed();
+        Ok(AdaptiveRegex {
+            pattern: pattern.to_string(),
+            forward: Forward::Sparse(dense.to_sparse()?),
+            skip: start_skip(&dense),
+            builder,
+            nfa,
+            dense_error: None,
+            reverse: None,
+            build_time,
+            sparse_time: Duration::from_secs(0),
+            searches: 0,
+            window: Window::default(),
+        })
+    }
+
+    /// Returns true if and only if the given bytes match.
+    ///
+    /// This behaves like [`Regex::is_match`](struct.Regex.html#method.is_match).
+    pub fn is_match(&mut self, input: &[u8]) -> bool {
+        self.is_match_at(input, 0)
+    }
+
+    /// Returns the first position at which a match is found.
+    ///
+    /// This behaves like
+    /// [`Regex::shortest_match`](struct.Regex.html#method.shortest_match).
+    pub fn shortest_match(&mut self, input: &[u8]) -> Option<usize> {
+        self.shortest_match_at(input, 0)
+    }
+
+    /// Returns the start and end offset of the leftmost first match.
+    ///
+    /// This behaves like [`Regex::find`](struct.Regex.html#method.find).
+    pub fn find(&mut self, input: &[u8]) -> Option<(usize, usize)> {
+        self.find_at(input, 0)
+    }
+
+    /// Returns the same as `is_match`, but starts the search at the given
+    /// offset.
+    pub fn is_match_at(&mut self, input: &[u8], start: usize) -> bool {
+        self.shortest_match_at(input, start).is_some()
+    }
+
+    /// Returns the same as `shortest_match`, but starts the search at the
+    /// given offset.
+    pub fn shortest_match_at(
+        &mut self,
+        input: &[u8],
+        start: usize,
+    ) -> Option<usize> {
+        self.search_forward(input, start, true)
+    }
+
+    /// Returns the same as `find`, but starts the search at the given
+    /// offset.
+    pub fn find_at(
+        &mut self,
+        input: &[u8],
+        start: usize,
+    ) -> Option<(usize, usize)> {
+        let end = match self.search_forward(input, start, false) {
+            None => return None,
+            Some(end) => end,
+        };
+        // When the forward DFA is anchored, every match begins where the
+        // search does, so there is no need for a reverse DFA.
+        if self.forward_is_anchored() {
+            return Some((start, end));
+        }
+        let s = match *self.reverse() {
+            Reverse::DFA(ref dfa) => dfa
+                .rfind(&input[start..end])
+                .map(|i| start + i)
+                .expect("reverse search must match if forward search does"),
+            Reverse::NFA(ref pikevm, _) => pikevm
+                .find_at(input, start, false)
+                .map(|m| m.0)
+                .expect("NFA search must match if forward search does"),
+        };
+        Some((s, end))
+    }
+
+    /// Returns an iterator over all non-overlapping leftmost first matches
+    /// in the given bytes.
+    ///
+    /// This behaves like
+    /// [`Regex::find_iter`](struct.Regex.html#method.find_iter).
+    pub fn find_iter<'r, 't>(
+        &'r mut self,
+        input: &'t [u8],
+    ) -> AdaptiveMatches<'r, 't> {
+        AdaptiveMatches {
+            re: self,
+            text: input,
+            last_end: 0,
+            last_match: None,
+        }
+    }
+
+    /// Returns true if and only if the forward DFA has been switched to its
+    /// dense representation.
+    pub fn is_dense(&self) -> bool {
+        match self.forward {
+            Forward::Sparse(_) => false,
+            Forward::Dense(_) => true,
+        }
+    }
+
+    /// Switch the forward DFA to its dense representation now, instead of
+    /// waiting for the time spent searching to justify it.
+    ///
+    /// This returns the error that prevented building the dense DFA, if
+    /// any, in which case searches keep using the sparse DFA. Since the
+    /// pattern is checked when this regex is built, this can only fail if
+    /// the DFA is too big.
+    pub fn build_dense(&mut self) -> Result<()> {
+        if let Some(ref err) = self.dense_error {
+            return Err(err.clone());
+        }
+        if !self.is_dense() {
+            match self.builder.build_from_nfa(&self.nfa) {
+                Ok(dense) => self.forward = Forward::Dense(dense),
+                Err(err) => {
+                    self.dense_error = Some(err.clone());
+                    return Err(err);
+                }
+            }
+        }
+        Ok(())
+    }
+
+    /// Returns true if and only if searches skip over bytes that leave the
+    /// forward DFA in its start state.
+    pub fn has_skip(&self) -> bool {
+        self.skip.is_some()
+    }
+
+    /// Returns true if and only if the reverse DFA has been built.
+    pub fn has_reverse(&self) -> bool {
+        match self.reverse {
+            Some(Reverse::DFA(_)) => true,
+            Some(Reverse::NFA(..)) | None => false,
+        }
+    }
+
+    /// Build the reverse DFA for this regex, if it hasn't been built yet.
+    ///
+    /// This returns the error that prevented building it, if any, in which
+    /// case searches find the start of each match by simulating the
+    /// pattern's NFA instead. Since the pattern is checked when this regex
+    /// is built, this can only fail if the DFA is too big.
+    pub fn build_reverse(&mut self) -> Result<()> {
+        match *self.reverse() {
+            Reverse::DFA(_) => Ok(()),
+            Reverse::NFA(_, ref err) => Err(err.clone()),
+        }
+    }
+
+    /// Returns the memory usage, in bytes, of the DFAs currently held by
+    /// this regex.
+    pub fn memory_usage(&self) -> usize {
+        let forward = match self.forward {
+            Forward::Sparse(ref dfa) => dfa.memory_usage(),
+            Forward::Dense(ref dfa) => dfa.memory_usage(),
+        };
+        let reverse = match self.reverse {
+            Some(Reverse::DFA(ref dfa)) => dfa.memory_usage(),
+            Some(Reverse::NFA(..)) | None => 0,
+        };
+        forward + reverse
+    }
+
+    fn forward_is_anchored(&self) -> bool {
+        match self.forward {
+            Forward::Sparse(ref dfa) => dfa.is_anchored(),
+            Forward::Dense(ref dfa) => dfa.is_anchored(),
+        }
+    }
+
+    /// Run the forward DFA with the current strategy, and record what the
+    /// search measured.
+    fn search_forward(
+        &mut self,
+        input: &[u8],
+        start: usize,
+        earliest: bool,
+    ) -> Option<usize> {
+        self.searches += 1;
+        if self.searches % WINDOW == 0 {
+            self.adapt();
+        }
+        let skip = self.skip.as_ref();
+        let window = &mut self.window;
+        match self.forward {
+            Forward::Dense(ref dfa) => match *dfa {
+                DenseDFA::Standard(ref r) => {
+                    search(r, skip, input, start, earliest, window)
+                }
+                DenseDFA::ByteClass(ref r) => {
+                    search(r, skip, input, start, earliest, window)
+                }
+                DenseDFA::Premultiplied(ref r) => {
+                    search(r, skip, input, start, earliest, window)
+                }
+                DenseDFA::PremultipliedByteClass(ref r) => {
+                    search(r, skip, input, start, earliest, window)
+                }
+                DenseDFA::__Nonexhaustive => unreachable!(),
+            },
+            Forward::Sparse(ref dfa) => {
+                let started = Instant::now();
+                let end = match *dfa {
+                    SparseDFA::Standard(ref r) => {
+                        search(r, skip, input, start, earliest, window)
+                    }
+                    SparseDFA::ByteClass(ref r) => {
+                        search(r, skip, input, start, earliest, window)
+                    }
+                    SparseDFA::__Nonexhaustive => unreachable!(),
+                };
+                self.sparse_time += started.elapsed();
+                end
+            }
+        }
+    }
+
+    /// Reconsider the strategy based on what was measured so far, and start
+    /// a new window.
+    fn adapt(&mut self) {
+        if self.skip.is_some() && self.window.skipped * 4 < self.window.scanned
+        {
+            self.skip = None;
+        }
+        self.window = Window::default();
+        if !self.is_dense()
+            && self.dense_error.is_none()
+            && self.sparse_time >= self.build_time
+        {
+            // On failure, the error is kept for `build_dense`, and searches
+            // keep using the sparse DFA.
+            let _ = self.build_dense();
+        }
+    }
+
+    /// Returns what finds the start of a match, building the reverse DFA if
+    /// it hasn't been built yet.
+    fn reverse(&mut self) -> &Reverse {
+        if self.reverse.is_none() {
+            let mut builder = self.builder.clone();
+            builder.anchored(true).reverse(true).longest_match(true);
+            let built = match builder.build(&self.pattern) {
+                Ok(dfa) => Reverse::DFA(dfa),
+                Err(err) => Reverse::NFA(PikeVM::new(self.nfa.clone()), err),
+            };
+            self.reverse = Some(built);
+        }
+        self.reverse.as_ref().unwrap()
+    }
+}
+
+/// An iterator over all non-overlapping matches of an
+/// [`AdaptiveRegex`](struct.AdaptiveRegex.html).
+///
+/// The iterator yields a `(usize, usize)` value until no more matches could be
+/// found, in the same way as [`Matches`](struct.Matches.html).
+#[derive(Debug)]
+pub struct AdaptiveMatches<'r, 't> {
+    re: &'r mut AdaptiveRegex,
+    text: &'t [u8],
+    last_end: usize,
+    last_match: Option<usize>,
+}
+
+impl<'r, 't> Iterator for AdaptiveMatches<'r, 't> {
+    type Item = (usize, usize);
+
+    fn next(&mut self) -> Option<(usize, usize)> {
+        if self.last_end > self.text.len() {
+            return None;
+        }
+        let (s, e) = match self.re.find_at(self.text, self.last_end) {
+            None => return None,
+            Some((s, e)) => (s, e),
+        };
+        if s == e {
+            // See the corresponding comment in `Matches`.
+            self.last_end = e + 1;
+            if Some(e) == self.last_match {
+                return self.next();
+            }
+        } else {
+            self.last_end = e;
+        }
+        self.last_match = Some(e);
+        Some((s, e))
+    }
+}
+
+/// Return the set of bytes that lead the given DFA out of its start state,
+/// or `None` if no byte can be skipped.
+fn start_skip<D: DFA>(dfa: &D) -> Option<ByteSet> {
+    let start = dfa.start_state();
+    if dfa.is_match_or_dead_state(start) {
+        return None;
+    }
+    let mut set = ByteSet::empty();
+    for b in 0..256 {
+        if dfa.next_state(start, b as u8) != start {
+            set.add(b as u8);
+        }
+    }
+    if set.is_full() {
+        None
+    } else {
+        Some(set)
+    }
+}
+
+/// Run a forward search, stopping at the first match if `earliest` is set,
+/// or otherwise at the end of the leftmost first match.
+///
+/// Whenever the DFA is in its start state and `skip` is given, bytes not in
+/// `skip` are passed over without following their transitions, since they
+/// lead back to the start state anyway.
+fn search<D: DFA>(
+    dfa: &D,
+    skip: Option<&ByteSet>,
+    bytes: &[u8],
+    start: usize,
+    earliest: bool,
+    window: &mut Window,
+) -> Option<usize> {
+    if dfa.is_anchored() && start > 0 {
+        return None;
+    }
+    let start_state = dfa.start_state();
+    let mut state = start_state;
+    let mut last_match = if dfa.is_dead_state(state) {
+        return None;
+    } else if dfa.is_match_state(state) {
+        Some(start)
+    } else {
+        None
+    };
+    if earliest && last_match.is_some() {
+        return last_match;
+    }
+    let mut at = start;
+    while at < bytes.len() {
+        if state == start_state {
+            if let Some(skip) = skip {
+                let from = at;
+                while at < bytes.len() && !skip.contains(bytes[at]) {
+                    at += 1;
+                }
+                window.skipped += (at - from) as u64;
+                if at == bytes.len() {
+                    break;
+                }
+            }
+        }
+        state = unsafe { dfa.next_state_unchecked(state, bytes[at]) };
+        at += 1;
+        if dfa.is_match_or_dead_state(state) {
+            if dfa.is_dead_state(state) {
+                break;
+            }
+            last_match = Some(at);
+            if earliest {
+                break;
+            }
+        }
+    }
+    window.scanned += (at - start) as u64;
+    last_match
+}
+
+#[cfg(test)]
+mod tests {
+    use std::time::Duration;
+
+    use super::{Reverse, WINDOW};
+    use error::Error;
+    use nfa::PikeVM;
+    use regex::RegexBuilder;
+
+    #[test]
+    fn same_as_regex_as_strategy_changes() {
+        let haystacks: &[&[u8]] = &[
+            b"",
+            b"foo 123 bar",
+            "a☃b ☃☃ zz".as_bytes(),
+            b"xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx1",
+        ];
+        for &pattern in &[r"[0-9]+", r"\w+", r"☃+|z", r"", r"x*1"] {
+            for &anchored in &[false, true] {
+                let mut builder = RegexBuilder::new();
+                builder.anchored(anchored);
+                let re = builder.build(pattern).unwrap();
+                let mut adaptive = builder.build_adaptive(pattern).unwrap();
+                // Make the regex switch to a dense DFA at the end of its
+                // first window.
+                adaptive.build_time = Duration::from_secs(0);
+                for i in 0..2 * WINDOW as usize {
+                    let haystack = haystacks[i % haystacks.len()];
+                    let expected: Vec<_> = re.find_iter(haystack).collect();
+                    let got: Vec<_> = adaptive.find_iter(haystack).collect();
+                    assert_eq!(
+                        expected, got,
+                        "{:?} on {:?}",
+                        pattern, haystack
+                    );
+                    assert_eq!(
+                        re.shortest_match(haystack),
+                        adaptive.shortest_match(haystack)
+                    );
+                }
+                assert!(adaptive.is_dense());
+            }
+        }
+    }
+
+    #[test]
+    fn skip_is_disabled_when_it_rarely_skips() {
+        let mut re = RegexBuilder::new().build_adaptive(r"[0-9]+x").unwrap();
+        assert!(re.has_skip());
+        for _ in 0..WINDOW {
+            assert!(!re.is_match(b"1212121212121212"));
+        }
+        assert!(!re.has_skip());
+
+        let mut re = RegexBuilder::new().build_adaptive(r"[0-9]+x").unwrap();
+        for _ in 0..WINDOW {
+            assert!(re.is_match(b"abcdefghijklmnopqrstuvwxyz 1x"));
+        }
+        assert!(re.has_skip());
+    }
+
+    #[test]
+    fn reverse_is_built_lazily() {
+        let mut re = RegexBuilder::new().build_adaptive(r"[a-z]+").unwrap();
+        assert!(re.is_match(b"abc"));
+        assert_eq!(None, re.find(b"123"));
+        assert!(!re.has_reverse());
+        assert_eq!(Some((3, 6)), re.find(b"123abc"));
+        assert!(re.has_reverse());
+        assert!(re.build_reverse().is_ok());
+    }
+
+    #[test]
+    fn falls_back_to_nfa() {
+        let builder = RegexBuilder::new();
+        let re = builder.build(r"[a-z]+|☃").unwrap();
+        let mut adaptive = builder.build_adaptive(r"[a-z]+|☃").unwrap();
+        // Pretend that the reverse DFA was too big to build.
+        let pikevm = PikeVM::new(adaptive.nfa.clone());
+        let err = Error::state_id_overflow(0);
+        adaptive.reverse = Some(Reverse::NFA(pikevm, err));
+
+        assert!(adaptive.build_reverse().is_err());
+        assert!(!adaptive.has_reverse());
+        let haystack = "12 abc ☃☃ x".as_bytes();
+        let expected: Vec<_> = re.find_iter(haystack).collect();
+        let got: Vec<_> = adaptive.find_iter(haystack).collect();
+        assert_eq!(expected, got);
+    }
+
+    #[test]
+    fn dense_is_built_on_demand() {
+        let mut re = RegexBuilder::new().build_adaptive(r"[0-9]+").unwrap();
+        let sparse = re.memory_usage();
+        assert!(!re.is_dense());
+        assert!(re.build_dense().is_ok());
+        assert!(re.is_dense());
+        assert!(re.memory_usage() > sparse);
+        assert_eq!(Some((3, 6)), re.find(b"foo123"));
+
+        // Pretend that the dense DFA was too big to build.
+        let mut re = RegexBuilder::new().build_adaptive(r"[0-9]+").unwrap();
+        re.dense_error = Some(Error::state_id_overflow(0));
+        re.build_time = Duration::from_secs(0);
+        for _ in 0..WINDOW {
+            assert!(re.is_match(b"foo123"));
+        }
+        assert!(re.build_dense().is_err());
+        assert!(!re.is_dense());
+    }
+
+    #[test]
+    fn shortest_match_in_start_state() {
+        let mut re = RegexBuilder::new().build_adaptive(r"a*").unwrap();
+        assert_eq!(Some(0), re.shortest_match(b"aaa"));
+        assert_eq!(Some((0, 3)), re.find(b"aaa"));
+    }
+}
@@ -0,0 +1,237 @@
+use byte_set::ByteSet;
+use dense::DenseDFA;
+use dfa::DFA;
+use regex::Regex;
+
+/// The number of searches between two reorderings of the regexes in an
+/// `AnyOf`.
+const REORDER_INTERVAL: u64 = 1024;
+
+/// A group of regexes that answers whether any of them match, trying the
+/// regexes most likely to match cheaply first.
+///
+/// Asking whether a haystack matches any of a large number of regexes by
+/// searching with each regex in a fixed order pays for every regex that
+/// precedes the first one that matches. An `AnyOf` reduces that cost in two
+/// ways:
+///
+/// * Before searching, it makes one pass over the haystack to record which
+/// bytes occur in it. This pass is shared by all regexes in the group. A
+/// regex is skipped without being searched when none of the bytes that can
+/// end one of its matches occur in the haystack.
+/// * It records how often each regex matches and how many bytes each search
+/// with it scans, and periodically reorders the regexes so that those with
+/// the highest rate of matches per byte scanned are tried first.
+///
+/// The search stops at the first regex that matches. Since the order of the
+/// regexes changes over time, which of several matching regexes is reported
+/// may change as well. Whether any regex matches never does.
+///
+/// Searching updates the statistics of this group, and therefore requires a
+/// mutable borrow. Threads that share a set of regexes should each use their
+/// own clone of an `AnyOf`, which also lets each adapt to its own haystacks.
+///
+/// # Example
+///
+/// ```
+/// use regex_automata::{AnyOf, Regex};
+///
+/// # fn example() -> Result<(), regex_automata::Error> {
+/// let mut any = AnyOf::new(vec![
+///     Regex::new("error: [0-9]+")?,
+///     Regex::new("warn(ing)?:")?,
+///     Regex::new("panicked at")?,
+/// ]);
+/// assert!(any.is_match(b"warning: low disk space"));
+/// assert_eq!(Some(2), any.match_index(b"thread 'main' panicked at"));
+/// assert!(!any.is_match(b"all good"));
+/// # Ok(()) }; example().unwrap()
+/// ```
+#[derive(Clone, Debug)]
+pub struct AnyOf<D: DFA = DenseDFA<Vec<usize>, usize>> {
+    regexes: Vec<Regex<D>>,
+    stats: Vec<Stats>,
+    /// The order in which regexes are tried, as indices into `regexes`.
+    order: Vec<usize>,
+    /// Whether any regex can be skipped based on the bytes in a haystack.
+    /// When none can, the pass over the haystack is skipped too.
+    prefilter: bool,
+    searches: u64,
+}
+
+/// What is known about one regex in an `AnyOf`.
+#[derive(Clone, Debug)]
+struct Stats {
+    /// The bytes that can end a match, or `None` if the regex can match the
+    /// empty string and therefore can't be skipped.
+    last_bytes: Option<ByteSet>,
+    /// The number of searches with this regex that found a match.
+    hits: u64,
+    /// The number of bytes scanned by searches with this regex.
+    scanned: u64,
+}
+
+impl<D: DFA> AnyOf<D> {
+    /// Create a group from the given regexes. Initially, the regexes are
+    /// tried in the order given.
+    pub fn new(regexes: Vec<Regex<D>>) -> AnyOf<D> {
+        let stats: Vec<Stats> = regexes
+            .iter()
+            .map(|re| Stats {
+                last_bytes: last_bytes(re),
+                hits: 0,
+                scanned: 0,
+            })
+            .collect();
+        let prefilter = stats.iter().any(|s| match s.last_bytes {
+            None => false,
+            Some(ref set) => !set.is_full(),
+        });
+        AnyOf {
+            order: (0..regexes.len()).collect(),
+            regexes,
+            stats,
+            prefilter,
+            searches: 0,
+        }
+    }
+
+    /// Return the regexes in this group, in the order they were given.
+    pub fn regexes(&self) -> &[Regex<D>] {
+        &self.regexes
+    }
+
+    /// Return the number of regexes in this group.
+    pub fn len(&self) -> usize {
+        self.regexes.len()
+    }
+
+    /// Returns true if and only if this group has no regexes.
+    pub fn is_empty(&self) -> bool {
+        self.regexes.is_empty()
+    }
+
+    /// Returns true if and only if any regex in this group matches the given
+    /// bytes.
+    pub fn is_match(&mut self, input: &[u8]) -> bool {
+        self.match_index(input).is_some()
+    }
+
+    /// Returns the index of a regex in this group that matches the given
+    /// bytes, or `None` if none of them match.
+    ///
+    /// Regexes are tried in the order that is currently expected to be the
+    /// cheapest, and the first one that matches is returned.
+    pub fn match_index(&mut self, input: &[u8]) -> Option<usize> {
+        self.searches += 1;
+        if self.searches % REORDER_INTERVAL == 0 {
+            self.reorder();
+        }
+        let present =
+            if self.prefilter { ByteSet::of(input) } else { ByteSet::full() };
+        for &i in &self.order {
+            let stats = &mut self.stats[i];
+            if let Some(ref last) = stats.last_bytes {
+                if !last.intersects(&present) {
+                    continue;
+                }
+            }
+            // The end of the shortest match is how far the search had to
+            // look. Searches that fail are assumed to scan everything, which
+            // is exact unless the regex's DFA gives up early.
+            match self.regexes[i].shortest_match(input) {
+                Some(end) => {
+                    stats.hits += 1;
+                    stats.scanned += end as u64;
+                    return Some(i);
+                }
+                None => stats.scanned += input.len() as u64,
+            }
+        }
+        None
+    }
+
+    /// Sort the regexes by their rate of matches per byte scanned, and decay
+    /// their statistics so that the order follows changes in the haystacks
+    /// being searched.
+    fn reorder(&mut self) {
+        let stats = &self.stats;
+        // Regexes that haven't been searched in a while decay towards the
+        // best possible rate, so that they are eventually measured again.
+        let rate = |i: usize| {
+            (stats[i].hits as f64 + 1.0) / (stats[i].scanned as f64 + 1.0)
+        };
+        self.order.sort_by(|&a, &b| rate(b).partial_cmp(&rate(a)).unwrap());
+        for stats in &mut self.stats {
+            stats.hits /= 2;
+            stats.scanned /= 2;
+        }
+    }
+}
+
+/// Return the set of bytes that can end a non-empty match of the given
+/// regex, or `None` if the regex can match the empty string.
+///
+/// The reverse DFA reads a match starting from its last byte, so every byte
+/// that doesn't lead its start state to the dead state can end a match.
+fn last_bytes<D: DFA>(re: &Regex<D>) -> Option<ByteSet> {
+    let (fwd, rev) = (re.forward(), re.reverse());
+    if fwd.is_match_state(fwd.start_state())
+        || rev.is_match_state(rev.start_state())
+    {
+        return None;
+    }
+    let start = rev.start_state();
+    let mut set = ByteSet::empty();
+    for b in 0..256 {
+        if !rev.is_dead_state(rev.next_state(start, b as u8)) {
+            set.add(b as u8);
+        }
+    }
+    Some(set)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{AnyOf, REORDER_INTERVAL};
+    use regex::Regex;
+
+    #[test]
+    fn same_as_trying_each_regex() {
+        let patterns = &[r"[0-9]{3}", r"foo|bar", r"x*", r"☃+", r"q+z"];
+        let haystacks: &[&[u8]] =
+            &[b"", b"abc", b"a 123", b"bar", "☃".as_bytes(), b"qz", b"q"];
+        for skip in 0..patterns.len() {
+            let regexes: Vec<Regex> = patterns
+                .iter()
+                .enumerate()
+                .filter(|&(i, _)| i != skip)
+                .map(|(_, p)| Regex::new(p).unwrap())
+                .collect();
+            let mut any = AnyOf::new(regexes.clone());
+            for _ in 0..3 {
+                for &haystack in haystacks {
+                    let expected =
+                        regexes.iter().any(|r| r.is_match(haystack));
+                    assert_eq!(expected, any.is_match(haystack));
+                    if let Some(i) = any.match_index(haystack) {
+                        assert!(regexes[i].is_match(haystack));
+                    }
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn frequent_cheap_matches_move_first() {
+        let mut any = AnyOf::new(vec![
+            Regex::new("never").unwrap(),
+            Regex::new("a").unwrap(),
+        ]);
+        for _ in 0..REORDER_INTERVAL + 1 {
+            assert_eq!(Some(1), any.match_index(b"a b c r"));
+        }
+        assert_eq!(vec![1, 0], any.order);
+        assert_eq!(Some(0), any.match_index(b"never"));
+    }
+}
@@ -0,0 +1,284 @@
+use std::ptr;
+use std::sync::atomic::{AtomicPtr, Ordering};
+use std::sync::{Arc, Mutex};
+use std::thread;
+
+use error::Result;
+use nfa::{PikeVM, NFA};
+use parallel;
+use regex::{Regex, RegexBuilder};
+
+/// A regex whose DFAs are built on a background thread, and which searches
+/// by simulating its NFA until they are ready.
+///
+/// Building the DFAs for a regex can take a long time, especially for big
+/// Unicode-aware patterns or when minimization is enabled. Its NFA, on the
+/// other hand, is cheap to build. An `AsyncRegex` is returned as soon as
+/// the NFA is built, and answers searches by simulating the NFA directly
+/// while the DFAs are built on another thread. Once they are built, every
+/// subsequent search, including searches from other threads, uses them
+/// instead. Simulating an NFA is much slower than searching with a DFA, but
+/// a search never has to wait for the DFAs.
+///
+/// Either way, an `AsyncRegex` always reports the same results as the
+/// corresponding [`Regex`](struct.Regex.html) built via
+/// [`RegexBuilder::build`](struct.RegexBuilder.html#method.build).
+///
+/// An `AsyncRegex` is built with
+/// [`RegexBuilder::build_async`](struct.RegexBuilder.html#method.build_async)
+/// or
+/// [`RegexBuilder::build_async_with`](struct.RegexBuilder.html#method.build_async_with).
+///
+/// # Example
+///
+/// ```
+/// use regex_automata::RegexBuilder;
+///
+/// # fn example() -> Result<(), regex_automata::Error> {
+/// let re = RegexBuilder::new().build_async(r"[0-9]+")?;
+/// // This is answered by either the NFA or the DFAs, depending on whether
+/// // they have been built yet.
+/// assert_eq!(Some((3, 6)), re.find(b"foo123"));
+///
+/// re.wait();
+/// assert!(re.is_ready());
+/// assert_eq!(Some((3, 6)), re.find(b"foo123"));
+/// # Ok(()) }; example().unwrap()
+/// ```
+#[derive(Debug)]
+pub struct AsyncRegex {
+    pikevm: PikeVM,
+    built: Arc<Built>,
+    thread: Mutex<Option<thread::JoinHandle<()>>>,
+}
+
+/// The regex built by the background thread. It is set at most once, after
+/// which it never changes until it is freed along with this value.
+#[derive(Debug)]
+struct Built {
+    regex: AtomicPtr<Regex>,
+}
+
+impl Drop for Built {
+    fn drop(&mut self) {
+        let regex = *self.regex.get_mut();
+        if !regex.is_null() {
+            unsafe {
+                drop(Box::from_raw(regex));
+            }
+        }
+    }
+}
+
+impl AsyncRegex {
+    /// Start building the given pattern's DFAs on a new thread, and call
+    /// `done` from that thread once that finishes. If no thread can be
+    /// spawned, both happen on the current thread before this returns.
+    ///
+    /// The pattern's NFA must already be built with the same configuration,
+    /// so that the background build can only fail if the DFAs are too big.
+    pub(crate) fn new<F>(
+        pattern: &str,
+        builder: RegexBuilder,
+        nfa: NFA,
+        done: F,
+    ) -> AsyncRegex
+    where
+        F: FnOnce(Result<()>) + Send + 'static,
+    {
+        let built = Arc::new(Built { regex: AtomicPtr::new(ptr::null_mut()) });
+        let (pattern, shared) = (pattern.to_string(), built.clone());
+        // If no thread can be spawned, the DFAs are built before this
+        // returns, which is slow but gives the same results.
+        let thread = parallel::spawn(move || {
+            let result = builder.build(&pattern).map(|re| {
+                let re = Box::into_raw(Box::new(re));
+                shared.regex.store(re, Ordering::Release);
+            });
+            done(result);
+        });
+        AsyncRegex {
+            pikevm: PikeVM::new(nfa),
+            built,
+            thread: Mutex::new(thread),
+        }
+    }
+
+    /// Returns true if and only if the given bytes match.
+    ///
+    /// This behaves like [`Regex::is_match`](struct.Regex.html#method.is_match).
+    pub fn is_match(&self, input: &[u8]) -> bool {
+        self.is_match_at(input, 0)
+    }
+
+    /// Returns the first position at which a match is found.
+    ///
+    /// This behaves like
+    /// [`Regex::shortest_match`](struct.Regex.html#method.shortest_match).
+    pub fn shortest_match(&self, input: &[u8]) -> Option<usize> {
+        self.shortest_match_at(input, 0)
+    }
+
+    /// Returns the start and end offset of the leftmost first match.
+    ///
+    /// This behaves like [`Regex::find`](struct.Regex.html#method.find).
+    pub fn find(&self, input: &[u8]) -> Option<(usize, usize)> {
+        self.find_at(input, 0)
+    }
+
+    /// Returns the same as `is_match`, but starts the search at the given
+    /// offset.
+    pub fn is_match_at(&self, input: &[u8], start: usize) -> bool {
+        self.shortest_match_at(input, start).is_some()
+    }
+
+    /// Returns the same as `shortest_match`, but starts the search at the
+    /// given offset.
+    pub fn shortest_match_at(
+        &self,
+        input: &[u8],
+        start: usize,
+    ) -> Option<usize> {
+        match self.regex() {
+            Some(re) => re.shortest_match_at(input, start),
+            None => self.pikevm.find_at(input, start, true).map(|m| m.1),
+        }
+    }
+
+    /// Returns the same as `find`, but starts the search at the given
+    /// offset.
+    pub fn find_at(
+        &self,
+        input: &[u8],
+        start: usize,
+    ) -> Option<(usize, usize)> {
+        match self.regex() {
+            Some(re) => re.find_at(input, start),
+            None => self.pikevm.find_at(input, start, false),
+        }
+    }
+
+    /// Returns an iterator over all non-overlapping leftmost first matches
+    /// in the given bytes.
+    ///
+    /// This behaves like
+    /// [`Regex::find_iter`](struct.Regex.html#method.find_iter).
+    pub fn find_iter<'r, 't>(
+        &'r self,
+        input: &'t [u8],
+    ) -> AsyncMatches<'r, 't> {
+        AsyncMatches { re: self, text: input, last_end: 0, last_match: None }
+    }
+
+    /// Returns true if and only if the DFAs for this regex have been built,
+    /// and are used by all searches from now on.
+    pub fn is_ready(&self) -> bool {
+        self.regex().is_some()
+    }
+
+    /// Block until the background build has finished.
+    ///
+    /// Once this returns, `is_ready` is true unless the DFAs could not be
+    /// built, in which case this regex keeps simulating its NFA.
+    pub fn wait(&self) {
+        let thread = self.thread.lock().unwrap().take();
+        if let Some(thread) = thread {
+            // A panic in the build thread, including one raised by the
+            // completion callback, leaves this regex on its NFA.
+            let _ = thread.join();
+        }
+    }
+
+    /// Returns the regex built by the background thread, if it is ready.
+    fn regex(&self) -> Option<&Regex> {
+        let re = self.built.regex.load(Ordering::Acquire);
+        // The regex is never replaced once set, and is only freed when
+        // `built` is dropped, which can't happen while `self` is borrowed.
+        unsafe { re.as_ref() }
+    }
+}
+
+/// An iterator over all non-overlapping matches of an
+/// [`AsyncRegex`](struct.AsyncRegex.html).
+///
+/// The iterator yields a `(usize, usize)` value until no more matches could be
+/// found, in the same way as [`Matches`](struct.Matches.html).
+#[derive(Clone, Debug)]
+pub struct AsyncMatches<'r, 't> {
+    re: &'r AsyncRegex,
+    text: &'t [u8],
+    last_end: usize,
+    last_match: Option<usize>,
+}
+
+impl<'r, 't> Iterator for AsyncMatches<'r, 't> {
+    type Item = (usize, usize);
+
+    fn next(&mut self) -> Option<(usize, usize)> {
+        if self.last_end > self.text.len() {
+            return None;
+        }
+        let (s, e) = match self.re.find_at(self.text, self.last_end) {
+            None => return None,
+            Some((s, e)) => (s, e),
+        };
+        if s == e {
+            // See the corresponding comment in `Matches`.
+            self.last_end = e + 1;
+            if Some(e) == self.last_match {
+                return self.next();
+            }
+        } else {
+            self.last_end = e;
+        }
+        self.last_match = Some(e);
+        Some((s, e))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::sync::mpsc;
+
+    use regex::RegexBuilder;
+
+    #[test]
+    fn same_before_and_after_ready() {
+        let haystacks: &[&[u8]] =
+            &[b"", b"foo 123", "a☃b ☃☃".as_bytes(), b"zzz"];
+        for &pattern in &[r"[0-9]+", r"\w+", r"☃+|z", r""] {
+            let re = RegexBuilder::new().build(pattern).unwrap();
+            let lazy = RegexBuilder::new().build_async(pattern).unwrap();
+            let before: Vec<Vec<_>> = haystacks
+                .iter()
+                .map(|h| lazy.find_iter(h).collect())
+                .collect();
+            lazy.wait();
+            assert!(lazy.is_ready());
+            for (i, &haystack) in haystacks.iter().enumerate() {
+                let expected: Vec<_> = re.find_iter(haystack).collect();
+                let after: Vec<_> = lazy.find_iter(haystack).collect();
+                assert_eq!(expected, after);
+                assert_eq!(expected, before[i]);
+            }
+        }
+    }
+
+    #[test]
+    fn calls_back_when_built() {
+        let (send, recv) = mpsc::channel();
+        let re = RegexBuilder::new()
+            .build_async_with(r"\w+@\w+", move |result| {
+                send.send(result.is_ok()).unwrap();
+            })
+            .unwrap();
+        assert!(recv.recv().unwrap());
+        assert!(re.is_ready());
+        assert!(re.is_match(b"me@example"));
+    }
+
+    #[test]
+    fn syntax_errors_are_reported() {
+        assert!(RegexBuilder::new().build_async(r"(").is_err());
+    }
+}
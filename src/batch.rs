@@ -0,0 +1,400 @@
+use std::cmp;
+use std::slice;
+
+use dense::DenseDFA;
+use dfa::{find_from, DFA};
+use parallel::scoped;
+use regex::Regex;
+use state_id::StateID;
+
+/// An offset into the values buffer of a column of strings.
+///
+/// Columns in the layout used by Apache Arrow store all of their strings
+/// back to back in a single values buffer, along with an offsets buffer with
+/// one more entry than there are rows. Row `i` is the slice of the values
+/// buffer between offsets `i` and `i + 1`. Arrow uses `i32` offsets for its
+/// regular string and binary types, and `i64` offsets for their large
+/// counterparts.
+pub trait RowOffset: Copy {
+    /// Convert this offset to a `usize`.
+    ///
+    /// This panics if the offset is negative.
+    fn to_usize(self) -> usize;
+}
+
+impl RowOffset for i32 {
+    fn to_usize(self) -> usize {
+        assert!(self >= 0, "negative row offset");
+        self as usize
+    }
+}
+
+impl RowOffset for i64 {
+    fn to_usize(self) -> usize {
+        assert!(self >= 0, "negative row offset");
+        self as usize
+    }
+}
+
+impl RowOffset for u32 {
+    fn to_usize(self) -> usize {
+        self as usize
+    }
+}
+
+impl RowOffset for u64 {
+    fn to_usize(self) -> usize {
+        self as usize
+    }
+}
+
+impl RowOffset for usize {
+    fn to_usize(self) -> usize {
+        self
+    }
+}
+
+/// Routines for searching every row of a column of strings.
+///
+/// The column is given as an offsets buffer and a values buffer, as
+/// described by [`RowOffset`](trait.RowOffset.html). Searching a column at
+/// once avoids calling into the regex once per row, which matters most when
+/// rows are short and the regex is called through a foreign function
+/// interface. Work that doesn't depend on the row, such as picking the DFA
+/// variant and looking up its start state, is done once per column.
+///
+/// Each routine has a parallel counterpart that splits the rows into
+/// contiguous ranges and searches each range on its own thread.
+impl<T: AsRef<[S]>, S: StateID> Regex<DenseDFA<T, S>> {
+    /// Write a selection bitmap for the given column, where a row's bit is
+    /// set if and only if `is_match` is true for that row.
+    ///
+    /// The bitmap uses the bit order of Arrow validity bitmaps: the bit for
+    /// row `i` is bit `i % 8` of byte `i / 8`, counting from the least
+    /// significant bit. Bits following the last row are cleared.
+    ///
+    /// # Panics
+    ///
+    /// This panics if `offsets` is empty, if an offset is out of bounds for
+    /// `values`, or if `bitmap` has fewer than one byte per 8 rows.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::Regex;
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let re = Regex::new("[0-9]+")?;
+    /// let values = b"abc12x9yz";
+    /// let offsets: &[i32] = &[0, 3, 5, 6, 7, 9];
+    /// let mut bitmap = [0u8; 1];
+    /// re.select_rows(offsets, values, &mut bitmap);
+    /// assert_eq!(0b01010, bitmap[0]);
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn select_rows<O: RowOffset>(
+        &self,
+        offsets: &[O],
+        values: &[u8],
+        bitmap: &mut [u8],
+    ) {
+        let rows = row_count(offsets);
+        let bytes = (rows + 7) / 8;
+        assert!(bitmap.len() >= bytes, "selection bitmap is too small");
+        self.select_range(offsets, values, &mut bitmap[..bytes]);
+    }
+
+    /// Write the number of non-overlapping matches in each row of the given
+    /// column, as counted by `find_iter`.
+    ///
+    /// # Panics
+    ///
+    /// This panics if `offsets` is empty, if an offset is out of bounds for
+    /// `values`, or if `counts` has fewer entries than there are rows.
+    pub fn count_rows<O: RowOffset>(
+        &self,
+        offsets: &[O],
+        values: &[u8],
+        counts: &mut [u32],
+    ) {
+        let rows = row_count(offsets);
+        assert!(counts.len() >= rows, "counts buffer is too small");
+        self.count_range(offsets, values, &mut counts[..rows]);
+    }
+
+    /// Returns the same as `select_rows`, but searches ranges of rows on up
+    /// to `threads` threads.
+    pub fn select_rows_parallel<O: RowOffset + Sync>(
+        &self,
+        offsets: &[O],
+        values: &[u8],
+        bitmap: &mut [u8],
+        threads: usize,
+    ) where
+        T: Sync,
+        S: Sync,
+    {
+        let rows = row_count(offsets);
+        let bytes = (rows + 7) / 8;
+        assert!(bitmap.len() >= bytes, "selection bitmap is too small");
+        for_each_range(rows, 8, &mut bitmap[..bytes], threads, |r, out| {
+            self.select_range(&offsets[r.0..r.1 + 1], values, out)
+        });
+    }
+
+    /// Returns the same as `count_rows`, but searches ranges of rows on up
+    /// to `threads` threads.
+    pub fn count_rows_parallel<O: RowOffset + Sync>(
+        &self,
+        offsets: &[O],
+        values: &[u8],
+        counts: &mut [u32],
+        threads: usize,
+    ) where
+        T: Sync,
+        S: Sync,
+    {
+        let rows = row_count(offsets);
+        assert!(counts.len() >= rows, "counts buffer is too small");
+        for_each_range(rows, 1, &mut counts[..rows], threads, |r, out| {
+            self.count_range(&offsets[r.0..r.1 + 1], values, out)
+        });
+    }
+
+    fn select_range<O: RowOffset>(
+        &self,
+        offsets: &[O],
+        values: &[u8],
+        bitmap: &mut [u8],
+    ) {
+        match *self.forward() {
+            DenseDFA::Standard(ref r) => select(r, offsets, values, bitmap),
+            DenseDFA::ByteClass(ref r) => select(r, offsets, values, bitmap),
+            DenseDFA::Premultiplied(ref r) => {
+                select(r, offsets, values, bitmap)
+            }
+            DenseDFA::PremultipliedByteClass(ref r) => {
+                select(r, offsets, values, bitmap)
+            }
+            DenseDFA::__Nonexhaustive => unreachable!(),
+        }
+    }
+
+    fn count_range<O: RowOffset>(
+        &self,
+        offsets: &[O],
+        values: &[u8],
+        counts: &mut [u32],
+    ) {
+        match *self.forward() {
+            DenseDFA::Standard(ref r) => count(r, offsets, values, counts),
+            DenseDFA::ByteClass(ref r) => count(r, offsets, values, counts),
+            DenseDFA::Premultiplied(ref r) => {
+                count(r, offsets, values, counts)
+            }
+            DenseDFA::PremultipliedByteClass(ref r) => {
+                count(r, offsets, values, counts)
+            }
+            DenseDFA::__Nonexhaustive => unreachable!(),
+        }
+    }
+}
+
+/// Return the number of rows described by the given offsets.
+fn row_count<O: RowOffset>(offsets: &[O]) -> usize {
+    assert!(
+        !offsets.is_empty(),
+        "offsets must have one entry per row plus one"
+    );
+    offsets.len() - 1
+}
+
+/// Write the selection bitmap for the rows described by `offsets`.
+///
+/// Every row is searched from the same start state, so whether a row matches
+/// without reading any of it is decided once for all rows.
+#[inline(never)]
+fn select<D: DFA, O: RowOffset>(
+    dfa: &D,
+    offsets: &[O],
+    values: &[u8],
+    bitmap: &mut [u8],
+) {
+    let start = dfa.start_state();
+    let fill = if dfa.is_match_state(start) {
+        Some(true)
+    } else if dfa.is_dead_state(start) {
+        Some(false)
+    } else {
+        None
+    };
+    for b in bitmap.iter_mut() {
+        *b = 0;
+    }
+    for row in 0..offsets.len() - 1 {
+        let bytes =
+            &values[offsets[row].to_usize()..offsets[row + 1].to_usize()];
+        let is_match = match fill {
+            Some(is_match) => is_match,
+            None => {
+                let mut state = start;
+                let mut is_match = false;
+                for &b in bytes {
+                    state = unsafe { dfa.next_state_unchecked(state, b) };
+                    if dfa.is_match_or_dead_state(state) {
+                        is_match = dfa.is_match_state(state);
+                        break;
+                    }
+                }
+                is_match
+            }
+        };
+        if is_match {
+            bitmap[row / 8] |= 1 << (row % 8);
+        }
+    }
+}
+
+/// Write the number of matches `find_iter` yields in each of the rows
+/// described by `offsets`.
+///
+/// Only the forward DFA is run, from a start state looked up once for all
+/// rows. `find_iter` runs the reverse DFA to find where each match starts,
+/// but counting only needs to know which matches are empty, and since
+/// regexes here have no look-around assertions, a match is empty if and
+/// only if it ends where its search began.
+#[inline(never)]
+fn count<D: DFA, O: RowOffset>(
+    dfa: &D,
+    offsets: &[O],
+    values: &[u8],
+    counts: &mut [u32],
+) {
+    let start = dfa.start_state();
+    let anchored = dfa.is_anchored();
+    for (row, count) in counts.iter_mut().enumerate() {
+        let bytes =
+            &values[offsets[row].to_usize()..offsets[row + 1].to_usize()];
+        let (mut at, mut last_match, mut n) = (0, None, 0);
+        while at <= bytes.len() && (at == 0 || !anchored) {
+            let end = match find_from(dfa, start, bytes, at) {
+                None => break,
+                Some(end) => end,
+            };
+            if end == at {
+                // Like find_iter, skip an empty match immediately following
+                // a match.
+                at = end + 1;
+                if Some(end) == last_match {
+                    continue;
+                }
+            } else {
+                at = end;
+            }
+            last_match = Some(end);
+            n += 1;
+        }
+        *count = n;
+    }
+}
+
+/// Split `rows` into at most `threads` contiguous ranges, each starting at a
+/// multiple of `unit`, and call `f` on each range along with its part of
+/// `out`, which has one element per `unit` rows. All but one range is handled
+/// on a spawned thread, and every thread is joined before this returns.
+fn for_each_range<X: Send, F>(
+    rows: usize,
+    unit: usize,
+    out: &mut [X],
+    threads: usize,
+    f: F,
+) where
+    F: Fn((usize, usize), &mut [X]) + Sync,
+{
+    let threads = cmp::max(1, threads);
+    let per_range = cmp::max(1, (rows + threads - 1) / threads);
+    let per_range = (per_range + unit - 1) / unit * unit;
+    let ranges = cmp::max(1, (rows + per_range - 1) / per_range);
+    let (out_ptr, out_len) = (out.as_mut_ptr() as usize, out.len());
+    let job = |i: usize| {
+        let (start, end) =
+            (i * per_range, cmp::min((i + 1) * per_range, rows));
+        let (lo, hi) =
+            (start / unit, cmp::min((end + unit - 1) / unit, out_len));
+        // Ranges start at multiples of `unit`, so the parts of `out` given to
+        // each range are disjoint.
+        let out = unsafe {
+            slice::from_raw_parts_mut((out_ptr as *mut X).add(lo), hi - lo)
+        };
+        f((start, end), out);
+    };
+    scoped(ranges, &job);
+}
+
+#[cfg(test)]
+mod tests {
+    use regex::{Regex, RegexBuilder};
+
+    fn column(rows: &[&[u8]]) -> (Vec<i64>, Vec<u8>) {
+        let (mut offsets, mut values) = (vec![0], vec![]);
+        for row in rows {
+            values.extend_from_slice(row);
+            offsets.push(values.len() as i64);
+        }
+        (offsets, values)
+    }
+
+    #[test]
+    fn same_as_searching_each_row() {
+        let rows: Vec<Vec<u8>> = (0..1000)
+            .map(|i| format!("row {} {}", i, "x".repeat(i % 7)).into_bytes())
+            .collect();
+        let rows: Vec<&[u8]> = rows.iter().map(|r| &r[..]).collect();
+        let (offsets, values) = column(&rows);
+        let patterns = &[r"[13]x", r"x", r"", r"x*", r"7+", r"r", r"☃"];
+        let anchored = patterns.iter().map(|p| (p, true));
+        for (pattern, anchored) in
+            patterns.iter().map(|p| (p, false)).chain(anchored)
+        {
+            let re =
+                RegexBuilder::new().anchored(anchored).build(pattern).unwrap();
+            let mut expected_bitmap = vec![0u8; (rows.len() + 7) / 8];
+            let mut expected_counts = vec![];
+            for (i, row) in rows.iter().enumerate() {
+                if re.is_match(row) {
+                    expected_bitmap[i / 8] |= 1 << (i % 8);
+                }
+                expected_counts.push(re.find_iter(row).count() as u32);
+            }
+            for &threads in &[0, 1, 3, 8, 2000] {
+                let mut bitmap = vec![0xFF; expected_bitmap.len()];
+                let mut counts = vec![0; rows.len()];
+                re.select_rows_parallel(
+                    &offsets,
+                    &values,
+                    &mut bitmap,
+                    threads,
+                );
+                re.count_rows_parallel(
+                    &offsets,
+                    &values,
+                    &mut counts,
+                    threads,
+                );
+                assert_eq!(expected_bitmap, bitmap);
+                assert_eq!(expected_counts, counts);
+            }
+            let mut bitmap = vec![0xFF; expected_bitmap.len()];
+            re.select_rows(&offsets, &values, &mut bitmap);
+            assert_eq!(expected_bitmap, bitmap);
+        }
+    }
+
+    #[test]
+    fn empty_column() {
+        let re = Regex::new("a").unwrap();
+        let mut bitmap: [u8; 0] = [];
+        re.select_rows_parallel::<i32>(&[0], b"", &mut bitmap, 4);
+        re.count_rows::<i32>(&[0], b"", &mut []);
+    }
+}
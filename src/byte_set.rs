@@ -0,0 +1,48 @@
+use std::u64;
+
+/// A set of bytes, stored as a 256-bit bitmap.
+#[derive(Clone, Debug)]
+pub struct ByteSet([u64; 4]);
+
+impl ByteSet {
+    pub fn empty() -> ByteSet {
+        ByteSet([0; 4])
+    }
+
+    pub fn full() -> ByteSet {
+        ByteSet([u64::MAX; 4])
+    }
+
+    /// Return the set of bytes that occur in the given haystack.
+    pub fn of(haystack: &[u8]) -> ByteSet {
+        let mut set = ByteSet::empty();
+        for &b in haystack {
+            set.add(b);
+        }
+        set
+    }
+
+    pub fn add(&mut self, byte: u8) {
+        self.0[byte as usize / 64] |= 1 << (byte as usize % 64);
+    }
+
+    pub fn remove(&mut self, byte: u8) {
+        self.0[byte as usize / 64] &= !(1 << (byte as usize % 64));
+    }
+
+    pub fn contains(&self, byte: u8) -> bool {
+        self.0[byte as usize / 64] & (1 << (byte as usize % 64)) != 0
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.0.iter().all(|&bits| bits == 0)
+    }
+
+    pub fn is_full(&self) -> bool {
+        self.0.iter().all(|&bits| bits == u64::MAX)
+    }
+
+    pub fn intersects(&self, other: &ByteSet) -> bool {
+        self.0.iter().zip(other.0.iter()).any(|(a, b)| a & b != 0)
+    }
+}
@@ -107,6 +107,14 @@ impl ByteClasses {
     }
 }
 
+impl PartialEq for ByteClasses {
+    fn eq(&self, other: &ByteClasses) -> bool {
+        self.0[..] == other.0[..]
+    }
+}
+
+impl Eq for ByteClasses {}
+
 impl fmt::Debug for ByteClasses {
     fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
         if self.is_singleton() {
@@ -122,6 +130,155 @@ impl fmt::Debug for ByteClasses {
     }
 }
 
+/// A haystack translated into the equivalence classes of a DFA's alphabet.
+///
+/// Searching a translated haystack skips the per-byte lookup of each byte's
+/// equivalence class that DFAs using byte classes would otherwise perform.
+/// This pays off when the same haystack is searched more than once, either
+/// by several DFAs that share the same byte classes, such as the DFAs in a
+/// [`DFAGroup`](struct.DFAGroup.html), or repeatedly by the same dense DFA
+/// via its `*_classes` search routines.
+///
+/// A `ClassIds` buffer remembers the classes it was translated with, and
+/// searches check that they match the classes of the DFA being used. The
+/// buffer may be reused for many haystacks to amortize its allocation.
+#[cfg(feature = "std")]
+#[derive(Clone, Debug)]
+pub struct ClassIds {
+    classes: ByteClasses,
+    translation: Translation,
+    ids: Vec<u8>,
+}
+
+#[cfg(feature = "std")]
+impl ClassIds {
+    /// Create a new empty buffer.
+    pub fn new() -> ClassIds {
+        ClassIds {
+            classes: ByteClasses::singletons(),
+            translation: Translation::Identity,
+            ids: vec![],
+        }
+    }
+
+    /// Return the class identifiers of the most recently translated
+    /// haystack, one per byte.
+    pub fn as_slice(&self) -> &[u8] {
+        &self.ids
+    }
+
+    /// Return the length, in bytes, of the most recently translated
+    /// haystack.
+    pub fn len(&self) -> usize {
+        self.ids.len()
+    }
+
+    /// Returns true if and only if the most recently translated haystack
+    /// is empty.
+    pub fn is_empty(&self) -> bool {
+        self.ids.is_empty()
+    }
+
+    /// Replace the contents of this buffer with the translation of the given
+    /// haystack using the given classes.
+    pub(crate) fn translate(
+        &mut self,
+        classes: &ByteClasses,
+        haystack: &[u8],
+    ) {
+        if *classes != self.classes {
+            self.classes = *classes;
+            self.translation = Translation::new(classes);
+        }
+        self.ids.clear();
+        match self.translation {
+            Translation::Identity => self.ids.extend_from_slice(haystack),
+            Translation::Boundaries(ref bounds) => {
+                self.ids.resize(haystack.len(), 0);
+                let blocks = self
+                    .ids
+                    .chunks_mut(TRANSLATE_BLOCK)
+                    .zip(haystack.chunks(TRANSLATE_BLOCK));
+                for (ids, bytes) in blocks {
+                    // Each pass over a block is a plain byte comparison, which
+                    // the compiler turns into vector compares and subtracts.
+                    for &bound in bounds {
+                        for (id, &b) in ids.iter_mut().zip(bytes) {
+                            *id += (b > bound) as u8;
+                        }
+                    }
+                }
+            }
+            Translation::Lookup => {
+                self.ids.extend(haystack.iter().map(|&b| classes.get(b)))
+            }
+        }
+    }
+
+    /// Return the classes this buffer was translated with.
+    pub(crate) fn byte_classes(&self) -> &ByteClasses {
+        &self.classes
+    }
+}
+
+#[cfg(feature = "std")]
+impl Default for ClassIds {
+    fn default() -> ClassIds {
+        ClassIds::new()
+    }
+}
+
+/// The largest alphabet that is translated by comparing bytes against class
+/// boundaries. Past this, a table lookup per byte is cheaper than one pass
+/// per boundary.
+#[cfg(feature = "std")]
+const MAX_BOUNDARY_CLASSES: usize = 16;
+
+/// The number of bytes translated per block when comparing against class
+/// boundaries, chosen so that a block stays in L1 cache for every pass.
+#[cfg(feature = "std")]
+const TRANSLATE_BLOCK: usize = 4 * 1024;
+
+/// The strategy used to translate a haystack into class identifiers.
+#[cfg(feature = "std")]
+#[derive(Clone, Debug)]
+enum Translation {
+    /// Every byte is its own class, so the haystack is copied as is.
+    Identity,
+    /// Every class is a contiguous range of bytes, and classes are numbered
+    /// in increasing order of their bytes. This stores the last byte of
+    /// every class but the last, so that the class of a byte is the number
+    /// of boundaries less than it.
+    Boundaries(Vec<u8>),
+    /// Every byte is looked up in the classes.
+    Lookup,
+}
+
+#[cfg(feature = "std")]
+impl Translation {
+    fn new(classes: &ByteClasses) -> Translation {
+        let mut bounds = vec![];
+        let mut contiguous = classes.get(0) == 0;
+        for b in 1..256 {
+            let (prev, class) =
+                (classes.get(b as u8 - 1), classes.get(b as u8));
+            if class != prev {
+                contiguous = contiguous && class as usize == prev as usize + 1;
+                bounds.push(b as u8 - 1);
+            }
+        }
+        if !contiguous {
+            Translation::Lookup
+        } else if bounds.len() == 255 {
+            Translation::Identity
+        } else if bounds.len() < MAX_BOUNDARY_CLASSES {
+            Translation::Boundaries(bounds)
+        } else {
+            Translation::Lookup
+        }
+    }
+}
+
 /// An iterator over representative bytes from each equivalence class.
 #[cfg(feature = "std")]
 #[derive(Debug)]
@@ -199,6 +356,21 @@ impl ByteClassSet {
         self.0[end as usize] = true;
     }
 
+    /// Add the class boundaries of the given equivalence classes to this set.
+    ///
+    /// After adding the classes of several DFAs, the equivalence classes
+    /// produced by this set are a refinement of each of them. That is, any
+    /// two bytes in the same class are also in the same class of every DFA.
+    /// This relies on each class being a contiguous range of bytes, which is
+    /// true of every set of classes produced by this type.
+    pub fn add_byte_classes(&mut self, classes: &ByteClasses) {
+        for b in 0..255 {
+            if classes.get(b) != classes.get(b + 1) {
+                self.0[b as usize] = true;
+            }
+        }
+    }
+
     /// Convert this boolean set to a map that maps all byte values to their
     /// corresponding equivalence class. The last mapping indicates the largest
     /// equivalence class identifier (which is never bigger than 255).
@@ -268,4 +440,37 @@ mod tests {
         }
         assert_eq!(set.byte_classes().alphabet_len(), 256);
     }
+
+    #[cfg(feature = "std")]
+    #[test]
+    fn class_ids_translation() {
+        use super::{ByteClassSet, ByteClasses, ClassIds};
+
+        let haystack: Vec<u8> = (0..3 * 4096).map(|i| i as u8).collect();
+        let mut few = ByteClassSet::new();
+        few.set_range(b'a', b'z');
+        few.set_range(b'0', b'9');
+        let mut many = ByteClassSet::new();
+        for b in (0..256).step_by(7) {
+            many.set_range(b as u8, b as u8);
+        }
+        let mut scattered = ByteClasses::empty();
+        for b in (0..256).step_by(2) {
+            scattered.set(b as u8, 1);
+        }
+        let all = [
+            few.byte_classes(),
+            many.byte_classes(),
+            scattered,
+            ByteClasses::singletons(),
+            ByteClasses::empty(),
+        ];
+        let mut ids = ClassIds::new();
+        for classes in &all {
+            ids.translate(classes, &haystack);
+            let expected: Vec<u8> =
+                haystack.iter().map(|&b| classes.get(b)).collect();
+            assert_eq!(expected, ids.as_slice());
+        }
+    }
 }
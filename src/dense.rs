@@ -3,6 +3,7 @@ use core::fmt;
 #[cfg(feature = "std")]
 use core::iter;
 use core::mem;
+use core::result;
 use core::slice;
 
 #[cfg(feature = "std")]
@@ -11,10 +12,15 @@ use byteorder::{ByteOrder, NativeEndian};
 #[cfg(feature = "std")]
 use regex_syntax::ParserBuilder;
 
+#[cfg(feature = "std")]
+use byte_set::ByteSet;
 use classes::ByteClasses;
 #[cfg(feature = "std")]
+use classes::ClassIds;
+#[cfg(feature = "std")]
 use determinize::Determinizer;
-use dfa::DFA;
+use dfa::{find_from, is_match_from, rfind_from, shortest_match_from};
+use dfa::{DFA, NO_ANCHORED_START};
 #[cfg(feature = "std")]
 use error::{Error, Result};
 #[cfg(feature = "std")]
@@ -44,6 +50,8 @@ const ALPHABET_LEN: usize = 256;
 /// Masks used in serialization of DFAs.
 pub(crate) const MASK_PREMULTIPLIED: u16 = 0b0000_0000_0000_0001;
 pub(crate) const MASK_ANCHORED: u16 = 0b0000_0000_0000_0010;
+pub(crate) const MASK_POW2_STRIDE: u16 = 0b0000_0000_0000_0100;
+pub(crate) const MASK_QUIT: u16 = 0b0000_0000_0000_1000;
 
 /// A dense table-based deterministic finite automaton (DFA).
 ///
@@ -175,7 +183,7 @@ impl<T: AsRef<[S]>, S: StateID> DenseDFA<T, S> {
     /// Return the internal DFA representation.
     ///
     /// All variants share the same internal representation.
-    fn repr(&self) -> &Repr<T, S> {
+    pub(crate) fn repr(&self) -> &Repr<T, S> {
         match *self {
             DenseDFA::Standard(ref r) => &r.0,
             DenseDFA::ByteClass(ref r) => &r.0,
@@ -297,6 +305,103 @@ impl<T: AsRef<[S]>, S: StateID> DenseDFA<T, S> {
     pub fn memory_usage(&self) -> usize {
         self.repr().memory_usage()
     }
+
+    /// Returns the total number of states in this DFA, including the dead
+    /// state.
+    ///
+    /// Together with `memory_usage`, this is useful for judging whether a
+    /// DFA's transition table is likely to fit in cache.
+    pub fn state_count(&self) -> usize {
+        self.repr().state_count()
+    }
+
+    /// Returns the same as `find`, except that it reports where the search
+    /// stopped when it reached a quit byte before finding any match.
+    ///
+    /// This is a convenience routine for `try_find_at` that always starts
+    /// the search at the beginning of `bytes`.
+    pub fn try_find(
+        &self,
+        bytes: &[u8],
+    ) -> result::Result<Option<usize>, usize> {
+        self.try_find_at(bytes, 0)
+    }
+
+    /// Returns the same as `find_at`, except that it reports where the
+    /// search stopped when it reached a quit byte before finding any match.
+    ///
+    /// Namely, if the search reaches one of the quit bytes configured with
+    /// [`Builder::quit`](struct.Builder.html#method.quit) before any match
+    /// was found, then this returns the offset of that byte as an error.
+    /// Since a match never contains a quit byte, callers can resume
+    /// searching right after it, e.g., at the beginning of the next line.
+    /// Otherwise, this returns the same as `find_at`. For a DFA without quit
+    /// bytes, this never returns an error.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::dense;
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let dfa = dense::Builder::new().quit(b'\n', true).build("[0-9]+")?;
+    /// let haystack = b"abc\nxyz 42\n";
+    /// assert_eq!(Err(3), dfa.try_find(haystack));
+    /// assert_eq!(Ok(Some(10)), dfa.try_find_at(haystack, 4));
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn try_find_at(
+        &self,
+        bytes: &[u8],
+        start: usize,
+    ) -> result::Result<Option<usize>, usize> {
+        if self.repr().is_anchored() && start > 0 {
+            return Ok(None);
+        }
+        match *self {
+            DenseDFA::Standard(ref r) => try_find_from(r, bytes, start),
+            DenseDFA::ByteClass(ref r) => try_find_from(r, bytes, start),
+            DenseDFA::Premultiplied(ref r) => try_find_from(r, bytes, start),
+            DenseDFA::PremultipliedByteClass(ref r) => {
+                try_find_from(r, bytes, start)
+            }
+            DenseDFA::__Nonexhaustive => unreachable!(),
+        }
+    }
+}
+
+/// The search loop of `DenseDFA::try_find_at`. This is the same as the loop
+/// of `DFA::find_at`, except when it stops in the quit state.
+#[inline(always)]
+fn try_find_from<D: DFA>(
+    dfa: &D,
+    bytes: &[u8],
+    start: usize,
+) -> result::Result<Option<usize>, usize> {
+    let mut state = dfa.start_state();
+    let mut last_match = if dfa.is_dead_state(state) {
+        return Ok(None);
+    } else if dfa.is_match_state(state) {
+        Some(start)
+    } else {
+        None
+    };
+    for (i, &b) in bytes[start..].iter().enumerate() {
+        state = unsafe { dfa.next_state_unchecked(state, b) };
+        if dfa.is_match_or_dead_state(state) {
+            if dfa.is_dead_state(state) {
+                // The only dead state besides the actual dead state is the
+                // quit state. A match found before it can't be extended past
+                // it, so it's only reported when there's no match.
+                if state != dead_id() && last_match.is_none() {
+                    return Err(start + i);
+                }
+                return Ok(last_match);
+            }
+            last_match = Some(start + i + 1);
+        }
+    }
+    Ok(last_match)
 }
 
 /// Routines for converting a dense DFA to other representations, such as
@@ -313,7 +418,9 @@ impl<T: AsRef<[S]>, S: StateID> DenseDFA<T, S> {
     /// If the chosen state identifier representation is too small to represent
     /// all states in the sparse DFA, then this returns an error. In most
     /// cases, if a dense DFA is constructable with `S` then a sparse DFA will
-    /// be as well. However, it is not guaranteed.
+    /// be as well. However, it is not guaranteed. A dense DFA with quit bytes
+    /// (see [`Builder::quit`](struct.Builder.html#method.quit)) cannot be
+    /// converted either.
     ///
     /// # Example
     ///
@@ -451,6 +558,114 @@ impl<T: AsRef<[S]>, S: StateID> DenseDFA<T, S> {
     }
 }
 
+/// Routines for searching haystacks that have already been translated into a
+/// DFA's equivalence classes.
+///
+/// DFAs that use byte classes look up the class of every byte they read
+/// before following a transition. When the same haystack is searched more
+/// than once, that lookup can be done once up front with
+/// [`translate`](enum.DenseDFA.html#method.translate), and the resulting
+/// [`ClassIds`](struct.ClassIds.html) searched any number of times.
+#[cfg(feature = "std")]
+impl<T: AsRef<[S]>, S: StateID> DenseDFA<T, S> {
+    /// Translate the given haystack into this DFA's equivalence classes,
+    /// replacing the previous contents of `ids`.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::{ClassIds, DFA, DenseDFA};
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let dfa = DenseDFA::new("foo[0-9]+")?;
+    /// let mut ids = ClassIds::new();
+    /// dfa.translate(b"foo12345 foo1", &mut ids);
+    /// assert_eq!(Some(8), dfa.find_classes(&ids));
+    /// assert_eq!(Some(13), dfa.find_classes_at(&ids, 8));
+    /// assert_eq!(Some(4), dfa.shortest_match_classes(&ids));
+    /// assert_eq!(dfa.find(b"foo12345 foo1"), dfa.find_classes(&ids));
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn translate(&self, haystack: &[u8], ids: &mut ClassIds) {
+        ids.translate(self.repr().byte_classes(), haystack);
+    }
+
+    /// Returns the same as `DFA::is_match`, but searches a translated
+    /// haystack.
+    ///
+    /// # Panics
+    ///
+    /// This panics if `ids` was not translated with this DFA's byte classes.
+    pub fn is_match_classes(&self, ids: &ClassIds) -> bool {
+        self.is_match_classes_at(ids, 0)
+    }
+
+    /// Returns the same as `DFA::shortest_match`, but searches a translated
+    /// haystack.
+    ///
+    /// # Panics
+    ///
+    /// This panics if `ids` was not translated with this DFA's byte classes.
+    pub fn shortest_match_classes(&self, ids: &ClassIds) -> Option<usize> {
+        self.shortest_match_classes_at(ids, 0)
+    }
+
+    /// Returns the same as `DFA::find`, but searches a translated haystack.
+    ///
+    /// # Panics
+    ///
+    /// This panics if `ids` was not translated with this DFA's byte classes.
+    pub fn find_classes(&self, ids: &ClassIds) -> Option<usize> {
+        self.find_classes_at(ids, 0)
+    }
+
+    /// Returns the same as `is_match_classes`, but starts the search at the
+    /// given offset.
+    pub fn is_match_classes_at(&self, ids: &ClassIds, start: usize) -> bool {
+        self.shortest_match_classes_at(ids, start).is_some()
+    }
+
+    /// Returns the same as `shortest_match_classes`, but starts the search
+    /// at the given offset.
+    pub fn shortest_match_classes_at(
+        &self,
+        ids: &ClassIds,
+        start: usize,
+    ) -> Option<usize> {
+        match *self {
+            DenseDFA::ByteClass(ref r) => {
+                r.shortest_match_classes_at(ids, start)
+            }
+            DenseDFA::PremultipliedByteClass(ref r) => {
+                r.shortest_match_classes_at(ids, start)
+            }
+            _ => {
+                self.repr().check_class_ids(ids);
+                self.repr().find_classes_at(ids.as_slice(), start, true)
+            }
+        }
+    }
+
+    /// Returns the same as `find_classes`, but starts the search at the
+    /// given offset.
+    pub fn find_classes_at(
+        &self,
+        ids: &ClassIds,
+        start: usize,
+    ) -> Option<usize> {
+        match *self {
+            DenseDFA::ByteClass(ref r) => r.find_classes_at(ids, start),
+            DenseDFA::PremultipliedByteClass(ref r) => {
+                r.find_classes_at(ids, start)
+            }
+            _ => {
+                self.repr().check_class_ids(ids);
+                self.repr().find_classes_at(ids.as_slice(), start, false)
+            }
+        }
+    }
+}
+
 impl<'a, S: StateID> DenseDFA<&'a [S], S> {
     /// Deserialize a DFA with a specific state identifier representation.
     ///
@@ -571,6 +786,11 @@ impl<T: AsRef<[S]>, S: StateID> DFA for DenseDFA<T, S> {
         self.repr().is_anchored()
     }
 
+    #[inline]
+    fn anchored_start_state(&self) -> Option<S> {
+        self.repr().anchored_start_state()
+    }
+
     #[inline]
     fn next_state(&self, current: S, input: u8) -> S {
         match *self {
@@ -659,6 +879,72 @@ impl<T: AsRef<[S]>, S: StateID> DFA for DenseDFA<T, S> {
             DenseDFA::__Nonexhaustive => unreachable!(),
         }
     }
+
+    #[inline]
+    fn is_match_anchored_at(&self, bytes: &[u8], start: usize) -> bool {
+        match *self {
+            DenseDFA::Standard(ref r) => r.is_match_anchored_at(bytes, start),
+            DenseDFA::ByteClass(ref r) => r.is_match_anchored_at(bytes, start),
+            DenseDFA::Premultiplied(ref r) => {
+                r.is_match_anchored_at(bytes, start)
+            }
+            DenseDFA::PremultipliedByteClass(ref r) => {
+                r.is_match_anchored_at(bytes, start)
+            }
+            DenseDFA::__Nonexhaustive => unreachable!(),
+        }
+    }
+
+    #[inline]
+    fn shortest_match_anchored_at(
+        &self,
+        bytes: &[u8],
+        start: usize,
+    ) -> Option<usize> {
+        match *self {
+            DenseDFA::Standard(ref r) => {
+                r.shortest_match_anchored_at(bytes, start)
+            }
+            DenseDFA::ByteClass(ref r) => {
+                r.shortest_match_anchored_at(bytes, start)
+            }
+            DenseDFA::Premultiplied(ref r) => {
+                r.shortest_match_anchored_at(bytes, start)
+            }
+            DenseDFA::PremultipliedByteClass(ref r) => {
+                r.shortest_match_anchored_at(bytes, start)
+            }
+            DenseDFA::__Nonexhaustive => unreachable!(),
+        }
+    }
+
+    #[inline]
+    fn find_anchored_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        match *self {
+            DenseDFA::Standard(ref r) => r.find_anchored_at(bytes, start),
+            DenseDFA::ByteClass(ref r) => r.find_anchored_at(bytes, start),
+            DenseDFA::Premultiplied(ref r) => r.find_anchored_at(bytes, start),
+            DenseDFA::PremultipliedByteClass(ref r) => {
+                r.find_anchored_at(bytes, start)
+            }
+            DenseDFA::__Nonexhaustive => unreachable!(),
+        }
+    }
+
+    #[inline]
+    fn rfind_anchored_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        match *self {
+            DenseDFA::Standard(ref r) => r.rfind_anchored_at(bytes, start),
+            DenseDFA::ByteClass(ref r) => r.rfind_anchored_at(bytes, start),
+            DenseDFA::Premultiplied(ref r) => {
+                r.rfind_anchored_at(bytes, start)
+            }
+            DenseDFA::PremultipliedByteClass(ref r) => {
+                r.rfind_anchored_at(bytes, start)
+            }
+            DenseDFA::__Nonexhaustive => unreachable!(),
+        }
+    }
 }
 
 /// A standard dense DFA that does not use premultiplication or byte classes.
@@ -700,6 +986,11 @@ impl<T: AsRef<[S]>, S: StateID> DFA for Standard<T, S> {
         self.0.is_anchored()
     }
 
+    #[inline]
+    fn anchored_start_state(&self) -> Option<S> {
+        self.0.anchored_start_state()
+    }
+
     #[inline]
     fn next_state(&self, current: S, input: u8) -> S {
         let o = current.to_usize() * ALPHABET_LEN + input as usize;
@@ -760,19 +1051,242 @@ impl<T: AsRef<[S]>, S: StateID> DFA for ByteClass<T, S> {
         self.0.is_anchored()
     }
 
+    #[inline]
+    fn anchored_start_state(&self) -> Option<S> {
+        self.0.anchored_start_state()
+    }
+
     #[inline]
     fn next_state(&self, current: S, input: u8) -> S {
         let input = self.0.byte_classes().get(input);
-        let o = current.to_usize() * self.0.alphabet_len() + input as usize;
+        let o = self.0.row_offset(current) + input as usize;
         self.0.trans()[o]
     }
 
     #[inline]
     unsafe fn next_state_unchecked(&self, current: S, input: u8) -> S {
         let input = self.0.byte_classes().get_unchecked(input);
-        let o = current.to_usize() * self.0.alphabet_len() + input as usize;
+        let o = self.0.row_offset(current) + input as usize;
         *self.0.trans().get_unchecked(o)
     }
+
+    // When rows are a power of two long, each of the searches below runs on
+    // a `Pow2Stride`, which finds rows with a shift. Checking the stride once
+    // per search keeps the check out of the loop over each byte. Otherwise,
+    // they are the same as the default implementations.
+
+    #[inline]
+    fn is_match_at(&self, bytes: &[u8], start: usize) -> bool {
+        if self.0.stride2 > 0 {
+            return Pow2Stride(&self.0).is_match_at(bytes, start);
+        }
+        if self.is_anchored() && start > 0 {
+            return false;
+        }
+        is_match_from(self, self.start_state(), bytes, start)
+    }
+
+    #[inline]
+    fn shortest_match_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        if self.0.stride2 > 0 {
+            return Pow2Stride(&self.0).shortest_match_at(bytes, start);
+        }
+        if self.is_anchored() && start > 0 {
+            return None;
+        }
+        shortest_match_from(self, self.start_state(), bytes, start)
+    }
+
+    #[inline]
+    fn find_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        if self.0.stride2 > 0 {
+            return Pow2Stride(&self.0).find_at(bytes, start);
+        }
+        if self.is_anchored() && start > 0 {
+            return None;
+        }
+        find_from(self, self.start_state(), bytes, start)
+    }
+
+    #[inline(never)]
+    fn rfind_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        if self.0.stride2 > 0 {
+            return Pow2Stride(&self.0).rfind_at(bytes, start);
+        }
+        if self.is_anchored() && start < bytes.len() {
+            return None;
+        }
+        rfind_from(self, self.start_state(), bytes, start)
+    }
+
+    #[inline]
+    fn is_match_anchored_at(&self, bytes: &[u8], start: usize) -> bool {
+        if self.0.stride2 > 0 {
+            return Pow2Stride(&self.0).is_match_anchored_at(bytes, start);
+        }
+        let state = self.anchored_start_state().expect(NO_ANCHORED_START);
+        is_match_from(self, state, bytes, start)
+    }
+
+    #[inline]
+    fn shortest_match_anchored_at(
+        &self,
+        bytes: &[u8],
+        start: usize,
+    ) -> Option<usize> {
+        if self.0.stride2 > 0 {
+            let dfa = Pow2Stride(&self.0);
+            return dfa.shortest_match_anchored_at(bytes, start);
+        }
+        let state = self.anchored_start_state().expect(NO_ANCHORED_START);
+        shortest_match_from(self, state, bytes, start)
+    }
+
+    #[inline]
+    fn find_anchored_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        if self.0.stride2 > 0 {
+            return Pow2Stride(&self.0).find_anchored_at(bytes, start);
+        }
+        let state = self.anchored_start_state().expect(NO_ANCHORED_START);
+        find_from(self, state, bytes, start)
+    }
+
+    #[inline(never)]
+    fn rfind_anchored_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        if self.0.stride2 > 0 {
+            return Pow2Stride(&self.0).rfind_anchored_at(bytes, start);
+        }
+        let state = self.anchored_start_state().expect(NO_ANCHORED_START);
+        rfind_from(self, state, bytes, start)
+    }
+}
+
+/// A byte class DFA whose rows are a power of two long, which finds the row
+/// of a state with a shift instead of a multiplication.
+///
+/// This is only used by the searches of `ByteClass`, after they've checked
+/// that the stride is a power of two.
+#[derive(Debug)]
+struct Pow2Stride<'a, T: AsRef<[S]> + 'a, S: StateID + 'a>(&'a Repr<T, S>);
+
+impl<'a, T: AsRef<[S]>, S: StateID> DFA for Pow2Stride<'a, T, S> {
+    type ID = S;
+
+    #[inline]
+    fn start_state(&self) -> S {
+        self.0.start_state()
+    }
+
+    #[inline]
+    fn is_match_state(&self, id: S) -> bool {
+        self.0.is_match_state(id)
+    }
+
+    #[inline]
+    fn is_dead_state(&self, id: S) -> bool {
+        self.0.is_dead_state(id)
+    }
+
+    #[inline]
+    fn is_match_or_dead_state(&self, id: S) -> bool {
+        self.0.is_match_or_dead_state(id)
+    }
+
+    #[inline]
+    fn is_anchored(&self) -> bool {
+        self.0.is_anchored()
+    }
+
+    #[inline]
+    fn anchored_start_state(&self) -> Option<S> {
+        self.0.anchored_start_state()
+    }
+
+    #[inline]
+    fn next_state(&self, current: S, input: u8) -> S {
+        let input = self.0.byte_classes().get(input);
+        let o = self.0.pow2_row_offset(current) + input as usize;
+        self.0.trans()[o]
+    }
+
+    #[inline]
+    unsafe fn next_state_unchecked(&self, current: S, input: u8) -> S {
+        let input = self.0.byte_classes().get_unchecked(input);
+        let o = self.0.pow2_row_offset(current) + input as usize;
+        *self.0.trans().get_unchecked(o)
+    }
+}
+
+/// Routines for searching translated haystacks without looking up the class
+/// of each byte. See the corresponding routines on
+/// [`DenseDFA`](enum.DenseDFA.html#method.translate) for details.
+#[cfg(feature = "std")]
+impl<T: AsRef<[S]>, S: StateID> ByteClass<T, S> {
+    /// Translate the given haystack into this DFA's equivalence classes,
+    /// replacing the previous contents of `ids`.
+    pub fn translate(&self, haystack: &[u8], ids: &mut ClassIds) {
+        ids.translate(self.0.byte_classes(), haystack);
+    }
+
+    /// Returns the same as `DFA::is_match_at`, but searches a translated
+    /// haystack.
+    ///
+    /// # Panics
+    ///
+    /// This panics if `ids` was not translated with this DFA's byte classes.
+    pub fn is_match_classes_at(&self, ids: &ClassIds, start: usize) -> bool {
+        self.search_classes(ids, start, true).is_some()
+    }
+
+    /// Returns the same as `DFA::shortest_match_at`, but searches a
+    /// translated haystack.
+    ///
+    /// # Panics
+    ///
+    /// This panics if `ids` was not translated with this DFA's byte classes.
+    pub fn shortest_match_classes_at(
+        &self,
+        ids: &ClassIds,
+        start: usize,
+    ) -> Option<usize> {
+        self.search_classes(ids, start, true)
+    }
+
+    /// Returns the same as `DFA::find_at`, but searches a translated
+    /// haystack.
+    ///
+    /// # Panics
+    ///
+    /// This panics if `ids` was not translated with this DFA's byte classes.
+    pub fn find_classes_at(
+        &self,
+        ids: &ClassIds,
+        start: usize,
+    ) -> Option<usize> {
+        self.search_classes(ids, start, false)
+    }
+
+    #[inline(never)]
+    fn search_classes(
+        &self,
+        ids: &ClassIds,
+        start: usize,
+        earliest: bool,
+    ) -> Option<usize> {
+        self.0.check_class_ids(ids);
+        let (repr, trans) = (&self.0, self.0.trans());
+        if repr.stride2 > 0 {
+            repr.find_classes_with(ids.as_slice(), start, earliest, |id, c| {
+                let o = repr.pow2_row_offset(id) + c as usize;
+                unsafe { *trans.get_unchecked(o) }
+            })
+        } else {
+            repr.find_classes_with(ids.as_slice(), start, earliest, |id, c| {
+                let o = repr.row_offset(id) + c as usize;
+                unsafe { *trans.get_unchecked(o) }
+            })
+        }
+    }
 }
 
 /// A dense DFA that premultiplies all of its state identifiers in its
@@ -821,6 +1335,11 @@ impl<T: AsRef<[S]>, S: StateID> DFA for Premultiplied<T, S> {
         self.0.is_anchored()
     }
 
+    #[inline]
+    fn anchored_start_state(&self) -> Option<S> {
+        self.0.anchored_start_state()
+    }
+
     #[inline]
     fn next_state(&self, current: S, input: u8) -> S {
         let o = current.to_usize() + input as usize;
@@ -874,18 +1393,92 @@ impl<T: AsRef<[S]>, S: StateID> DFA for PremultipliedByteClass<T, S> {
         self.0.is_anchored()
     }
 
-    #[inline]
-    fn next_state(&self, current: S, input: u8) -> S {
-        let input = self.0.byte_classes().get(input);
-        let o = current.to_usize() + input as usize;
-        self.0.trans()[o]
+    #[inline]
+    fn anchored_start_state(&self) -> Option<S> {
+        self.0.anchored_start_state()
+    }
+
+    #[inline]
+    fn next_state(&self, current: S, input: u8) -> S {
+        let input = self.0.byte_classes().get(input);
+        let o = current.to_usize() + input as usize;
+        self.0.trans()[o]
+    }
+
+    #[inline]
+    unsafe fn next_state_unchecked(&self, current: S, input: u8) -> S {
+        let input = self.0.byte_classes().get_unchecked(input);
+        let o = current.to_usize() + input as usize;
+        *self.0.trans().get_unchecked(o)
+    }
+}
+
+/// Routines for searching translated haystacks without looking up the class
+/// of each byte. See the corresponding routines on
+/// [`DenseDFA`](enum.DenseDFA.html#method.translate) for details.
+#[cfg(feature = "std")]
+impl<T: AsRef<[S]>, S: StateID> PremultipliedByteClass<T, S> {
+    /// Translate the given haystack into this DFA's equivalence classes,
+    /// replacing the previous contents of `ids`.
+    pub fn translate(&self, haystack: &[u8], ids: &mut ClassIds) {
+        ids.translate(self.0.byte_classes(), haystack);
+    }
+
+    /// Returns the same as `DFA::is_match_at`, but searches a translated
+    /// haystack.
+    ///
+    /// # Panics
+    ///
+    /// This panics if `ids` was not translated with this DFA's byte classes.
+    pub fn is_match_classes_at(&self, ids: &ClassIds, start: usize) -> bool {
+        self.search_classes(ids, start, true).is_some()
+    }
+
+    /// Returns the same as `DFA::shortest_match_at`, but searches a
+    /// translated haystack.
+    ///
+    /// # Panics
+    ///
+    /// This panics if `ids` was not translated with this DFA's byte classes.
+    pub fn shortest_match_classes_at(
+        &self,
+        ids: &ClassIds,
+        start: usize,
+    ) -> Option<usize> {
+        self.search_classes(ids, start, true)
+    }
+
+    /// Returns the same as `DFA::find_at`, but searches a translated
+    /// haystack.
+    ///
+    /// # Panics
+    ///
+    /// This panics if `ids` was not translated with this DFA's byte classes.
+    pub fn find_classes_at(
+        &self,
+        ids: &ClassIds,
+        start: usize,
+    ) -> Option<usize> {
+        self.search_classes(ids, start, false)
     }
 
-    #[inline]
-    unsafe fn next_state_unchecked(&self, current: S, input: u8) -> S {
-        let input = self.0.byte_classes().get_unchecked(input);
-        let o = current.to_usize() + input as usize;
-        *self.0.trans().get_unchecked(o)
+    #[inline(never)]
+    fn search_classes(
+        &self,
+        ids: &ClassIds,
+        start: usize,
+        earliest: bool,
+    ) -> Option<usize> {
+        self.0.check_class_ids(ids);
+        let trans = self.0.trans();
+        self.0.find_classes_with(
+            ids.as_slice(),
+            start,
+            earliest,
+            |id, c| unsafe {
+                *trans.get_unchecked(id.to_usize() + c as usize)
+            },
+        )
     }
 }
 
@@ -929,6 +1522,13 @@ pub(crate) struct Repr<T, S> {
     anchored: bool,
     /// The initial start state ID.
     start: S,
+    /// The start state ID for anchored searches of an unanchored DFA, if the
+    /// DFA was built with one. Searching from this state only permits matches
+    /// that begin where the search begins, regardless of where that is.
+    ///
+    /// This is always `None` for anchored DFAs, since their start state
+    /// already has this property.
+    anchored_start: Option<S>,
     /// The total number of states in this DFA. Note that a DFA always has at
     /// least one state---the dead state---even the empty DFA. In particular,
     /// the dead state always has ID 0 and is correspondingly always the first
@@ -952,6 +1552,14 @@ pub(crate) struct Repr<T, S> {
     ///       // next_state is either dead (no-match) or a match
     ///       return next_state != dead
     max_match: S,
+    /// The quit state, or the dead state if this DFA has no quit bytes.
+    ///
+    /// When present, the quit state always follows the dead state and
+    /// precedes every match state. Every state transitions to it on a quit
+    /// byte, and it transitions to the dead state on every byte. Since a
+    /// search stops at any state less than or equal to `max_match` anyway,
+    /// stopping at a quit byte costs nothing in the search loop.
+    quit: S,
     /// A set of equivalence classes, where a single equivalence class
     /// represents a set of bytes that never discriminate between a match
     /// and a non-match in the DFA. Each equivalence class corresponds to
@@ -964,6 +1572,16 @@ pub(crate) struct Repr<T, S> {
     /// if the DFA's kind uses byte classes. If the DFA doesn't use byte
     /// classes, then this vector is empty.
     byte_classes: ByteClasses,
+    /// The number of entries in each row of the transition table.
+    ///
+    /// This is usually the alphabet length. When rows are padded to a power
+    /// of two, the entries following the alphabet in each row are never read
+    /// and always point to the dead state.
+    stride: usize,
+    /// The base 2 logarithm of `stride` when it is a power of two greater
+    /// than 1, and 0 otherwise. When non-zero, the row of a state that isn't
+    /// premultiplied is found with a shift instead of a multiplication.
+    stride2: usize,
     /// A contiguous region of memory representing the transition table in
     /// row-major order. The representation is dense. That is, every state has
     /// precisely the same number of transitions. The maximum number of
@@ -991,8 +1609,12 @@ impl<S: StateID> Repr<Vec<S>, S> {
             premultiplied: false,
             anchored: true,
             start: dead_id(),
+            anchored_start: None,
             state_count: 0,
             max_match: S::from_usize(0),
+            quit: dead_id(),
+            stride: byte_classes.alphabet_len(),
+            stride2: stride2(byte_classes.alphabet_len()),
             byte_classes,
             trans: vec![],
         };
@@ -1031,9 +1653,13 @@ impl<T: AsRef<[S]>, S: StateID> Repr<T, S> {
             premultiplied: self.premultiplied,
             anchored: self.anchored,
             start: self.start,
+            anchored_start: self.anchored_start,
             state_count: self.state_count,
             max_match: self.max_match,
+            quit: self.quit,
             byte_classes: self.byte_classes().clone(),
+            stride: self.stride,
+            stride2: self.stride2,
             trans: self.trans(),
         }
     }
@@ -1044,9 +1670,13 @@ impl<T: AsRef<[S]>, S: StateID> Repr<T, S> {
             premultiplied: self.premultiplied,
             anchored: self.anchored,
             start: self.start,
+            anchored_start: self.anchored_start,
             state_count: self.state_count,
             max_match: self.max_match,
+            quit: self.quit,
             byte_classes: self.byte_classes().clone(),
+            stride: self.stride,
+            stride2: self.stride2,
             trans: self.trans().to_vec(),
         }
     }
@@ -1060,16 +1690,48 @@ impl<T: AsRef<[S]>, S: StateID> Repr<T, S> {
         self.start
     }
 
+    /// Return the start state to use for anchored searches, if one exists.
+    ///
+    /// For an anchored DFA, this is always its start state. For an unanchored
+    /// DFA, this is only present if it was built with both start states.
+    pub fn anchored_start_state(&self) -> Option<S> {
+        if self.anchored {
+            Some(self.start)
+        } else {
+            self.anchored_start
+        }
+    }
+
     /// Returns true if and only if the given identifier corresponds to a match
     /// state.
     pub fn is_match_state(&self, id: S) -> bool {
-        id <= self.max_match && id != dead_id()
+        id <= self.max_match && id > self.quit
     }
 
     /// Returns true if and only if the given identifier corresponds to a dead
     /// state.
+    ///
+    /// The quit state counts as a dead state, since no search can continue
+    /// past it.
     pub fn is_dead_state(&self, id: S) -> bool {
-        id == dead_id()
+        id <= self.quit
+    }
+
+    /// Returns true if and only if the given identifier corresponds to the
+    /// quit state. This is always false for a DFA without quit bytes.
+    pub fn is_quit_state(&self, id: S) -> bool {
+        id == self.quit && id != dead_id()
+    }
+
+    /// Returns the identifier of the quit state, or the dead state if this
+    /// DFA has no quit bytes.
+    pub fn quit_state(&self) -> S {
+        self.quit
+    }
+
+    /// Returns true if and only if this DFA has a quit state.
+    pub fn has_quit(&self) -> bool {
+        self.quit != dead_id()
     }
 
     /// Returns true if and only if the given identifier could correspond to
@@ -1111,7 +1773,7 @@ impl<T: AsRef<[S]>, S: StateID> Repr<T, S> {
     /// modification.
     #[cfg(feature = "std")]
     pub fn states(&self) -> StateIter<T, S> {
-        let it = self.trans().chunks(self.alphabet_len());
+        let it = self.trans().chunks(self.stride);
         StateIter { dfa: self, it: it.enumerate() }
     }
 
@@ -1131,6 +1793,26 @@ impl<T: AsRef<[S]>, S: StateID> Repr<T, S> {
         self.byte_classes().alphabet_len()
     }
 
+    /// Returns true if and only if the rows of this DFA's transition table
+    /// are padded beyond its alphabet length to a power of two.
+    pub fn is_pow2_stride(&self) -> bool {
+        self.stride != self.alphabet_len()
+    }
+
+    /// Return the offset of the row of the given state, which must not be
+    /// premultiplied, in the transition table.
+    #[inline(always)]
+    fn row_offset(&self, id: S) -> usize {
+        id.to_usize() * self.stride
+    }
+
+    /// Return the same as `row_offset`, but with a shift instead of a
+    /// multiplication. This must only be called when `stride2` is non-zero.
+    #[inline(always)]
+    fn pow2_row_offset(&self, id: S) -> usize {
+        id.to_usize() << self.stride2
+    }
+
     /// Returns the memory usage, in bytes, of this DFA.
     pub fn memory_usage(&self) -> usize {
         self.trans().len() * mem::size_of::<S>()
@@ -1140,11 +1822,12 @@ impl<T: AsRef<[S]>, S: StateID> Repr<T, S> {
     /// index corresponds to the position in which it appears in the transition
     /// table. When a DFA is NOT premultiplied, then a state's identifier is
     /// also its index. When a DFA is premultiplied, then a state's identifier
-    /// is equal to `index * alphabet_len`. This routine reverses that.
+    /// is equal to `index * stride`, where the stride is the alphabet length
+    /// unless rows are padded. This routine reverses that.
     #[cfg(feature = "std")]
     pub fn state_id_to_index(&self, id: S) -> usize {
         if self.premultiplied {
-            id.to_usize() / self.alphabet_len()
+            id.to_usize() / self.stride
         } else {
             id.to_usize()
         }
@@ -1172,7 +1855,7 @@ impl<T: AsRef<[S]>, S: StateID> Repr<T, S> {
         // Check that this DFA can fit into A's representation.
         let mut last_state_id = self.state_count - 1;
         if self.premultiplied {
-            last_state_id *= self.alphabet_len();
+            last_state_id *= self.stride;
         }
         if last_state_id > A::max_id() {
             return Err(Error::state_id_overflow(A::max_id()));
@@ -1184,9 +1867,15 @@ impl<T: AsRef<[S]>, S: StateID> Repr<T, S> {
             premultiplied: self.premultiplied,
             anchored: self.anchored,
             start: A::from_usize(self.start.to_usize()),
+            anchored_start: self
+                .anchored_start
+                .map(|id| A::from_usize(id.to_usize())),
             state_count: self.state_count,
             max_match: A::from_usize(self.max_match.to_usize()),
+            quit: A::from_usize(self.quit.to_usize()),
             byte_classes: self.byte_classes().clone(),
+            stride: self.stride,
+            stride2: self.stride2,
             trans: vec![dead_id::<A>(); self.trans().len()],
         };
         for (i, id) in new.trans.iter_mut().enumerate() {
@@ -1195,6 +1884,155 @@ impl<T: AsRef<[S]>, S: StateID> Repr<T, S> {
         Ok(new)
     }
 
+    /// Create a new DFA whose match semantics are equivalent to this DFA,
+    /// but whose alphabet is given by the classes given instead of this DFA's
+    /// own classes.
+    ///
+    /// The classes given must be a refinement of this DFA's classes. That
+    /// is, any two bytes in the same class must also be in the same class of
+    /// this DFA. If this DFA is premultiplied and the new alphabet is too big
+    /// for its state identifiers to remain premultiplied, then this returns
+    /// an error. If this DFA's rows are padded to a power of two, then so are
+    /// the new DFA's rows.
+    #[cfg(feature = "std")]
+    pub fn with_byte_classes(
+        &self,
+        classes: ByteClasses,
+    ) -> Result<Repr<Vec<S>, S>> {
+        let alphabet_len = classes.alphabet_len();
+        // Maps each class in the new alphabet to its class in ours.
+        let mut old_classes = vec![0u8; alphabet_len];
+        for b in (0..256).map(|b| b as u8) {
+            old_classes[classes.get(b) as usize] = self.byte_classes().get(b);
+        }
+        debug_assert!((0..256).map(|b| b as u8).all(|b| {
+            old_classes[classes.get(b) as usize] == self.byte_classes().get(b)
+        }));
+        let stride = if self.is_pow2_stride() {
+            alphabet_len.next_power_of_two()
+        } else {
+            alphabet_len
+        };
+        if self.premultiplied {
+            premultiply_overflow_error(
+                S::from_usize(self.state_count - 1),
+                stride,
+            )?;
+        }
+
+        let remap = |id: S| -> S {
+            if self.premultiplied {
+                S::from_usize(self.state_id_to_index(id) * stride)
+            } else {
+                id
+            }
+        };
+        let mut trans = Vec::with_capacity(self.state_count * stride);
+        for row in self.trans().chunks(self.stride) {
+            for &class in &old_classes {
+                trans.push(remap(row[class as usize]));
+            }
+            for _ in alphabet_len..stride {
+                trans.push(dead_id());
+            }
+        }
+        Ok(Repr {
+            premultiplied: self.premultiplied,
+            anchored: self.anchored,
+            start: remap(self.start),
+            anchored_start: self.anchored_start.map(&remap),
+            state_count: self.state_count,
+            max_match: remap(self.max_match),
+            quit: remap(self.quit),
+            byte_classes: classes,
+            stride,
+            stride2: stride2(stride),
+            trans,
+        })
+    }
+
+    /// Search a haystack that has already been translated into this DFA's
+    /// equivalence classes, beginning at `start`.
+    ///
+    /// When `earliest` is true, this returns the end of the first match
+    /// seen, like `DFA::shortest_match_at`. Otherwise, this returns the end
+    /// of the leftmost first match, like `DFA::find_at`.
+    ///
+    /// Callers must guarantee that every class identifier in `ids` is less
+    /// than this DFA's alphabet length.
+    #[inline(always)]
+    pub(crate) fn find_classes_at(
+        &self,
+        ids: &[u8],
+        start: usize,
+        earliest: bool,
+    ) -> Option<usize> {
+        let trans = self.trans();
+        if self.premultiplied {
+            self.find_classes_with(ids, start, earliest, |id, class| unsafe {
+                *trans.get_unchecked(id.to_usize() + class as usize)
+            })
+        } else if self.stride2 > 0 {
+            self.find_classes_with(ids, start, earliest, |id, class| unsafe {
+                *trans.get_unchecked(self.pow2_row_offset(id) + class as usize)
+            })
+        } else {
+            self.find_classes_with(ids, start, earliest, |id, class| unsafe {
+                *trans.get_unchecked(self.row_offset(id) + class as usize)
+            })
+        }
+    }
+
+    /// Search a translated haystack like `find_classes_at`, but with a
+    /// transition function specific to one DFA variant.
+    #[inline(always)]
+    fn find_classes_with<F: Fn(S, u8) -> S>(
+        &self,
+        ids: &[u8],
+        start: usize,
+        earliest: bool,
+        next: F,
+    ) -> Option<usize> {
+        if self.anchored && start > 0 {
+            return None;
+        }
+        let mut state = self.start;
+        let mut last_match = if self.is_dead_state(state) {
+            return None;
+        } else if self.is_match_state(state) {
+            Some(start)
+        } else {
+            None
+        };
+        if earliest && last_match.is_some() {
+            return last_match;
+        }
+        for (i, &class) in ids[start..].iter().enumerate() {
+            state = next(state, class);
+            if self.is_match_or_dead_state(state) {
+                if self.is_dead_state(state) {
+                    return last_match;
+                }
+                last_match = Some(start + i + 1);
+                if earliest {
+                    return last_match;
+                }
+            }
+        }
+        last_match
+    }
+
+    /// Assert that `ids` was translated with this DFA's byte classes. This is
+    /// what makes unchecked transition table lookups safe when searching
+    /// translated haystacks.
+    #[cfg(feature = "std")]
+    fn check_class_ids(&self, ids: &ClassIds) {
+        assert!(
+            *ids.byte_classes() == self.byte_classes,
+            "class identifiers were translated with a different alphabet"
+        );
+    }
+
     /// Serialize a DFA to raw bytes, aligned to an 8 byte boundary.
     ///
     /// If the state identifier representation of this DFA has a size different
@@ -1206,6 +2044,20 @@ impl<T: AsRef<[S]>, S: StateID> Repr<T, S> {
         let label = b"rust-regex-automata-dfa\x00";
         assert_eq!(24, label.len());
 
+        // Version 2 differs from version 1 only by an additional anchored
+        // start state following the max match state. We only write version 2
+        // when it's needed, so that single-start DFAs remain readable by
+        // older versions of this crate. Version 3 is written for DFAs whose
+        // rows are padded to a power of two or that have a quit state. It
+        // always has the anchored start state slot, which holds u64::MAX when
+        // there is no such state.
+        let version: u16 = if self.is_pow2_stride() || self.has_quit() {
+            3
+        } else if self.anchored_start.is_some() {
+            2
+        } else {
+            1
+        };
         let trans_size = mem::size_of::<S>() * self.trans().len();
         let size =
             // For human readable label.
@@ -1225,12 +2077,18 @@ impl<T: AsRef<[S]>, S: StateID> Repr<T, S> {
             + 8
             // For max match state.
             + 8
+            // For anchored start state (versions 2 and 3 only).
+            + if version >= 2 { 8 } else { 0 }
             // For byte class map.
             + 256
             // For transition table.
             + trans_size;
         // sanity check, this can be updated if need be
-        assert_eq!(312 + trans_size, size);
+        if version >= 2 {
+            assert_eq!(320 + trans_size, size);
+        } else {
+            assert_eq!(312 + trans_size, size);
+        }
         // This must always pass. It checks that the transition table is at
         // a properly aligned address.
         assert_eq!(0, (size - trans_size) % 8);
@@ -1247,7 +2105,7 @@ impl<T: AsRef<[S]>, S: StateID> Repr<T, S> {
         A::write_u16(&mut buf[i..], 0xFEFF);
         i += 2;
         // version number
-        A::write_u16(&mut buf[i..], 1);
+        A::write_u16(&mut buf[i..], version);
         i += 2;
         // size of state ID
         let state_size = mem::size_of::<S>();
@@ -1267,6 +2125,12 @@ impl<T: AsRef<[S]>, S: StateID> Repr<T, S> {
         if self.anchored {
             options |= MASK_ANCHORED;
         }
+        if self.is_pow2_stride() {
+            options |= MASK_POW2_STRIDE;
+        }
+        if self.has_quit() {
+            options |= MASK_QUIT;
+        }
         A::write_u16(&mut buf[i..], options);
         i += 2;
         // start state
@@ -1278,6 +2142,15 @@ impl<T: AsRef<[S]>, S: StateID> Repr<T, S> {
         // max match state
         A::write_u64(&mut buf[i..], self.max_match.to_usize() as u64);
         i += 8;
+        // anchored start state
+        if version >= 2 {
+            let id = match self.anchored_start {
+                Some(id) => id.to_usize() as u64,
+                None => ::std::u64::MAX,
+            };
+            A::write_u64(&mut buf[i..], id);
+            i += 8;
+        }
         // byte class map
         for b in (0..256).map(|b| b as u8) {
             buf[i] = self.byte_classes().get(b);
@@ -1326,9 +2199,9 @@ impl<'a, S: StateID> Repr<&'a [S], S> {
         // check that the version number is supported
         let version = NativeEndian::read_u16(buf);
         buf = &buf[2..];
-        if version != 1 {
+        if version < 1 || version > 3 {
             panic!(
-                "expected version 1, but found unsupported version {}",
+                "expected version 1, 2 or 3, but found unsupported version {}",
                 version,
             );
         }
@@ -1361,11 +2234,37 @@ impl<'a, S: StateID> Repr<&'a [S], S> {
         let max_match = S::from_usize(NativeEndian::read_u64(buf) as usize);
         buf = &buf[8..];
 
+        // read anchored start state, if present
+        let anchored_start = if version >= 2 {
+            let id = NativeEndian::read_u64(buf);
+            buf = &buf[8..];
+            if version >= 3 && id == ::std::u64::MAX {
+                None
+            } else {
+                Some(S::from_usize(id as usize))
+            }
+        } else {
+            None
+        };
+
         // read byte classes
         let byte_classes = ByteClasses::from_slice(&buf[..256]);
         buf = &buf[256..];
 
-        let len = state_count * byte_classes.alphabet_len();
+        let stride = if opts & MASK_POW2_STRIDE > 0 {
+            byte_classes.alphabet_len().next_power_of_two()
+        } else {
+            byte_classes.alphabet_len()
+        };
+        // the quit state, if present, is always the second state
+        let quit = if opts & MASK_QUIT == 0 {
+            dead_id()
+        } else if opts & MASK_PREMULTIPLIED > 0 {
+            S::from_usize(stride)
+        } else {
+            S::from_usize(1)
+        };
+        let len = state_count * stride;
         let len_bytes = len * state_size;
         assert!(
             buf.len() <= len_bytes,
@@ -1388,9 +2287,13 @@ impl<'a, S: StateID> Repr<&'a [S], S> {
             premultiplied: opts & MASK_PREMULTIPLIED > 0,
             anchored: opts & MASK_ANCHORED > 0,
             start,
+            anchored_start,
             state_count,
             max_match,
+            quit,
             byte_classes,
+            stride,
+            stride2: stride2(stride),
             trans,
         }
     }
@@ -1408,7 +2311,7 @@ impl<S: StateID> Repr<Vec<S>, S> {
             return Ok(());
         }
 
-        let alpha_len = self.alphabet_len();
+        let alpha_len = self.stride;
         premultiply_overflow_error(
             S::from_usize(self.state_count - 1),
             alpha_len,
@@ -1421,10 +2324,38 @@ impl<S: StateID> Repr<Vec<S>, S> {
         }
         self.premultiplied = true;
         self.start = S::from_usize(self.start.to_usize() * alpha_len);
+        self.anchored_start = self
+            .anchored_start
+            .map(|id| S::from_usize(id.to_usize() * alpha_len));
         self.max_match = S::from_usize(self.max_match.to_usize() * alpha_len);
+        self.quit = S::from_usize(self.quit.to_usize() * alpha_len);
         Ok(())
     }
 
+    /// Pad every row of the transition table to the next power of two of the
+    /// alphabet length, so that the row of a state is found with a shift.
+    ///
+    /// This cannot be called on a premultiplied DFA.
+    pub fn pad_rows(&mut self) {
+        assert!(!self.premultiplied, "can't pad rows of premultiplied DFA");
+
+        let (alphabet_len, stride) = (self.alphabet_len(), self.stride);
+        let new_stride = alphabet_len.next_power_of_two();
+        if new_stride == stride {
+            return;
+        }
+        let mut trans = Vec::with_capacity(self.state_count * new_stride);
+        for row in self.trans.chunks(stride) {
+            trans.extend_from_slice(&row[..alphabet_len]);
+            trans.extend(
+                iter::repeat(dead_id::<S>()).take(new_stride - alphabet_len),
+            );
+        }
+        self.trans = trans;
+        self.stride = new_stride;
+        self.stride2 = stride2(new_stride);
+    }
+
     /// Minimize this DFA using Hopcroft's algorithm.
     ///
     /// This cannot be called on a premultiplied DFA.
@@ -1445,6 +2376,18 @@ impl<S: StateID> Repr<Vec<S>, S> {
         self.start = start;
     }
 
+    /// Set the start state used for anchored searches of this DFA.
+    ///
+    /// This is only meaningful for unanchored DFAs. Like `set_start_state`,
+    /// this cannot be called on a premultiplied DFA.
+    pub fn set_anchored_start_state(&mut self, start: S) {
+        assert!(!self.premultiplied, "can't set start on premultiplied DFA");
+        assert!(!self.anchored, "anchored DFAs have only one start state");
+        assert!(start.to_usize() < self.state_count, "invalid start state");
+
+        self.anchored_start = Some(start);
+    }
+
     /// Set the maximum state identifier that could possible correspond to a
     /// match state.
     ///
@@ -1471,7 +2414,7 @@ impl<S: StateID> Repr<Vec<S>, S> {
         assert!(to.to_usize() < self.state_count, "invalid to state");
 
         let class = self.byte_classes().get(byte);
-        let offset = from.to_usize() * self.alphabet_len() + class as usize;
+        let offset = self.row_offset(from) + class as usize;
         self.trans[offset] = to;
     }
 
@@ -1492,8 +2435,8 @@ impl<S: StateID> Repr<Vec<S>, S> {
         } else {
             next_state_id(S::from_usize(self.state_count - 1))?
         };
-        let alphabet_len = self.alphabet_len();
-        self.trans.extend(iter::repeat(dead_id::<S>()).take(alphabet_len));
+        let stride = self.stride;
+        self.trans.extend(iter::repeat(dead_id::<S>()).take(stride));
         // This should never panic, since state_count is a usize. The
         // transition table size would have run out of room long ago.
         self.state_count = self.state_count.checked_add(1).unwrap();
@@ -1509,7 +2452,7 @@ impl<S: StateID> Repr<Vec<S>, S> {
         assert!(!self.premultiplied, "can't get state in premultiplied DFA");
 
         let alphabet_len = self.alphabet_len();
-        let offset = id.to_usize() * alphabet_len;
+        let offset = self.row_offset(id);
         StateMut {
             transitions: &mut self.trans[offset..offset + alphabet_len],
         }
@@ -1525,13 +2468,29 @@ impl<S: StateID> Repr<Vec<S>, S> {
     pub fn swap_states(&mut self, id1: S, id2: S) {
         assert!(!self.premultiplied, "can't swap states in premultiplied DFA");
 
-        let o1 = id1.to_usize() * self.alphabet_len();
-        let o2 = id2.to_usize() * self.alphabet_len();
+        let o1 = self.row_offset(id1);
+        let o2 = self.row_offset(id2);
         for b in 0..self.alphabet_len() {
             self.trans.swap(o1 + b, o2 + b);
         }
     }
 
+    /// Add the quit state to this DFA and return its identifier. This must be
+    /// called right after the DFA is created, so that the quit state
+    /// immediately follows the dead state.
+    ///
+    /// Like the dead state, the quit state transitions to the dead state on
+    /// every byte.
+    pub fn add_quit_state(&mut self) -> Result<S> {
+        assert!(!self.premultiplied, "can't add quit to premultiplied DFA");
+        assert_eq!(1, self.state_count, "quit state must follow dead state");
+
+        let id = self.add_empty_state()?;
+        self.quit = id;
+        self.max_match = id;
+        Ok(id)
+    }
+
     /// Truncate the states in this DFA to the given count.
     ///
     /// This routine does not do anything to check the correctness of this
@@ -1542,15 +2501,16 @@ impl<S: StateID> Repr<Vec<S>, S> {
     pub fn truncate_states(&mut self, count: usize) {
         assert!(!self.premultiplied, "can't truncate in premultiplied DFA");
 
-        let alphabet_len = self.alphabet_len();
-        self.trans.truncate(count * alphabet_len);
+        let stride = self.stride;
+        self.trans.truncate(count * stride);
         self.state_count = count;
     }
 
     /// This routine shuffles all match states in this DFA---according to the
     /// given map---to the beginning of the DFA such that every non-match state
     /// appears after every match state. (With one exception: the special dead
-    /// state remains as the first state.) The given map should have length
+    /// state remains as the first state, followed by the quit state if there
+    /// is one.) The given map should have length
     /// exactly equivalent to the number of states in this DFA.
     ///
     /// The purpose of doing this shuffling is to avoid the need to store
@@ -1559,7 +2519,8 @@ impl<S: StateID> Repr<Vec<S>, S> {
     /// of two.
     ///
     /// This updates `self.max_match` to point to the last matching state as
-    /// well as `self.start` if the starting state was moved.
+    /// well as `self.start` and `self.anchored_start` if the starting states
+    /// were moved.
     pub fn shuffle_match_states(&mut self, is_match: &[bool]) {
         assert!(
             !self.premultiplied,
@@ -1571,7 +2532,8 @@ impl<S: StateID> Repr<Vec<S>, S> {
             return;
         }
 
-        let mut first_non_match = 1;
+        // The dead state and the quit state, if any, never move.
+        let mut first_non_match = self.quit.to_usize() + 1;
         while first_non_match < self.state_count && is_match[first_non_match] {
             first_non_match += 1;
         }
@@ -1604,6 +2566,11 @@ impl<S: StateID> Repr<Vec<S>, S> {
         if swaps[self.start.to_usize()] != dead_id() {
             self.start = swaps[self.start.to_usize()];
         }
+        if let Some(start) = self.anchored_start {
+            if swaps[start.to_usize()] != dead_id() {
+                self.anchored_start = Some(swaps[start.to_usize()]);
+            }
+        }
         self.max_match = S::from_usize(first_non_match - 1);
     }
 }
@@ -1621,12 +2588,20 @@ impl<T: AsRef<[S]>, S: StateID> fmt::Debug for Repr<T, S> {
                 } else {
                     "D "
                 }
+            } else if dfa.is_quit_state(id) {
+                "Q "
             } else if id == dfa.start_state() {
                 if dfa.is_match_state(id) {
                     ">*"
                 } else {
                     "> "
                 }
+            } else if Some(id) == dfa.anchored_start {
+                if dfa.is_match_state(id) {
+                    "^*"
+                } else {
+                    "^ "
+                }
             } else {
                 if dfa.is_match_state(id) {
                     " *"
@@ -1670,12 +2645,10 @@ impl<'a, T: AsRef<[S]>, S: StateID> Iterator for StateIter<'a, T, S> {
 
     fn next(&mut self) -> Option<(S, State<'a, S>)> {
         self.it.next().map(|(id, chunk)| {
+            let chunk = &chunk[..self.dfa.alphabet_len()];
             let state = State { transitions: chunk };
-            let id = if self.dfa.premultiplied {
-                id * self.dfa.alphabet_len()
-            } else {
-                id
-            };
+            let id =
+                if self.dfa.premultiplied { id * self.dfa.stride } else { id };
             (S::from_usize(id), state)
         })
     }
@@ -1879,9 +2852,12 @@ pub struct Builder {
     anchored: bool,
     minimize: bool,
     premultiply: bool,
+    pow2_stride: bool,
     byte_classes: bool,
     reverse: bool,
     longest_match: bool,
+    dual_start: bool,
+    quit: ByteSet,
 }
 
 #[cfg(feature = "std")]
@@ -1898,9 +2874,12 @@ impl Builder {
             anchored: false,
             minimize: false,
             premultiply: true,
+            pow2_stride: false,
             byte_classes: true,
             reverse: false,
             longest_match: false,
+            dual_start: false,
+            quit: ByteSet::empty(),
         }
     }
 
@@ -1954,13 +2933,22 @@ impl Builder {
             Determinizer::new(nfa)
                 .with_byte_classes()
                 .longest_match(self.longest_match)
+                .dual_start(self.dual_start)
+                .quit(self.quit.clone())
                 .build()
         } else {
-            Determinizer::new(nfa).longest_match(self.longest_match).build()
+            Determinizer::new(nfa)
+                .longest_match(self.longest_match)
+                .dual_start(self.dual_start)
+                .quit(self.quit.clone())
+                .build()
         }?;
         if self.minimize {
             dfa.minimize();
         }
+        if self.pow2_stride {
+            dfa.pad_rows();
+        }
         if self.premultiply {
             dfa.premultiply()?;
         }
@@ -2149,6 +3137,82 @@ impl Builder {
         self
     }
 
+    /// Pad each row of the DFA's transition table to a power of two.
+    ///
+    /// When enabled, every row of the transition table has room for the
+    /// next power of two of the alphabet size, and the extra entries always
+    /// lead to the dead state. This only has an effect when byte classes are
+    /// enabled, since the full alphabet of 256 bytes is already a power of
+    /// two.
+    ///
+    /// This is most useful with premultiplication disabled. State
+    /// identifiers then remain indices, so they fit in smaller integer types
+    /// than premultiplied identifiers would, and the row of a state is still
+    /// found with a shift instead of a multiplication. When premultiplication
+    /// is enabled, every row starts at a multiple of a power of two instead.
+    ///
+    /// Padding makes the transition table bigger by up to a factor of two.
+    /// A padded DFA is serialized using version 3 of the format, which older
+    /// versions of this crate cannot read.
+    ///
+    /// This option is disabled by default.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::{dense, DFA};
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let dfa = dense::Builder::new()
+    ///     .premultiply(false)
+    ///     .power_of_two_stride(true)
+    ///     .build_with_size::<u8>("[a-z]+[0-9]")?;
+    /// assert_eq!(Some(4), dfa.find(b"abc1"));
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn power_of_two_stride(&mut self, yes: bool) -> &mut Builder {
+        self.pow2_stride = yes;
+        self
+    }
+
+    /// Add or remove the given byte from the set of quit bytes.
+    ///
+    /// Every state of the DFA transitions to a special quit state on a quit
+    /// byte, so a search never looks past the first quit byte it reaches and
+    /// a match never contains one. This bounds searches to a single line or
+    /// record, e.g., by quitting on `\n`. The quit state is ordered right
+    /// after the dead state, so the search loops detect it with the same
+    /// comparison they already do for match and dead states.
+    ///
+    /// `DFA::find` and friends simply stop at a quit byte.
+    /// [`DenseDFA::try_find_at`](enum.DenseDFA.html#method.try_find_at)
+    /// additionally reports the offset of the quit byte when no match was
+    /// found before it, so that the search can be resumed after it.
+    ///
+    /// A DFA with quit bytes can't be converted to a sparse DFA, and is
+    /// serialized using version 3 of the format. No bytes are quit bytes by
+    /// default.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::{dense, DFA};
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let dfa = dense::Builder::new().quit(b'\n', true).build("a[^b]*b")?;
+    /// assert_eq!(Some(4), dfa.find(b"axyb"));
+    /// assert_eq!(None, dfa.find(b"ax\nyb"));
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn quit(&mut self, byte: u8, yes: bool) -> &mut Builder {
+        if yes {
+            self.quit.add(byte);
+        } else {
+            self.quit.remove(byte);
+        }
+        self
+    }
+
     /// Shrink the size of the DFA's alphabet by mapping bytes to their
     /// equivalence classes.
     ///
@@ -2233,6 +3297,48 @@ impl Builder {
         self
     }
 
+    /// Build an unanchored DFA that also has an anchored start state.
+    ///
+    /// When enabled, the DFA contains two start states that share all other
+    /// states: the usual unanchored start state, and a start state from
+    /// which only matches beginning exactly where the search begins are
+    /// found. The latter is used by the `*_anchored_at` search routines on
+    /// the [`DFA`](../trait.DFA.html) trait, which treat the given starting
+    /// offset as the anchor point. This permits a single DFA to serve both
+    /// unanchored searches and anchored searches at arbitrary positions,
+    /// which would otherwise require building two DFAs.
+    ///
+    /// The anchored start state may add some states to the DFA that are not
+    /// reachable from the unanchored start state, but usually far fewer than
+    /// a second DFA would need.
+    ///
+    /// Both start states are preserved when the DFA is converted to a sparse
+    /// DFA or serialized. Such DFAs are serialized using version 2 of the
+    /// format, which older versions of this crate cannot read.
+    ///
+    /// This has no effect when `anchored` is enabled, since every anchored
+    /// DFA can already be used for anchored searches at any position.
+    ///
+    /// By default this is disabled.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::{dense, DFA};
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let dfa = dense::Builder::new().dual_start(true).build("abc")?;
+    /// let haystack = b"xabcabc";
+    /// assert_eq!(Some(4), dfa.find_at(haystack, 0));
+    /// assert_eq!(None, dfa.find_anchored_at(haystack, 0));
+    /// assert_eq!(Some(7), dfa.find_anchored_at(haystack, 4));
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn dual_start(&mut self, yes: bool) -> &mut Builder {
+        self.dual_start = yes;
+        self
+    }
+
     /// Apply best effort heuristics to shrink the NFA at the expense of more
     /// time/memory.
     ///
@@ -2252,6 +3358,16 @@ impl Default for Builder {
     }
 }
 
+/// Return the base 2 logarithm of the given row stride if it is a power of
+/// two greater than 1, and 0 otherwise.
+fn stride2(stride: usize) -> usize {
+    if stride > 1 && stride.is_power_of_two() {
+        stride.trailing_zeros() as usize
+    } else {
+        0
+    }
+}
+
 /// Return the given byte as its escaped string form.
 #[cfg(feature = "std")]
 fn escape(b: u8) -> String {
@@ -2264,6 +3380,59 @@ fn escape(b: u8) -> String {
 mod tests {
     use super::*;
 
+    #[test]
+    fn class_id_searches_agree() {
+        let haystacks: &[&[u8]] =
+            &[b"", b"abc", b"xx foo123 foo9", "snow☃ 42".as_bytes()];
+        // The start state of the second pattern is a match state.
+        let patterns = &[r"foo[0-9]+|☃|\d", r"a*"];
+        for &premultiply in &[false, true] {
+            for &byte_classes in &[false, true] {
+                for &anchored in &[false, true] {
+                    for &pattern in patterns {
+                        let dfa = Builder::new()
+                            .premultiply(premultiply)
+                            .byte_classes(byte_classes)
+                            .anchored(anchored)
+                            .build(pattern)
+                            .unwrap();
+                        check_class_id_searches(&dfa, haystacks);
+                    }
+                }
+            }
+        }
+    }
+
+    fn check_class_id_searches(
+        dfa: &DenseDFA<Vec<usize>, usize>,
+        haystacks: &[&[u8]],
+    ) {
+        let mut ids = ClassIds::new();
+        for &haystack in haystacks {
+            dfa.translate(haystack, &mut ids);
+            for at in 0..haystack.len() + 1 {
+                assert_eq!(
+                    dfa.find_at(haystack, at),
+                    dfa.find_classes_at(&ids, at)
+                );
+                assert_eq!(
+                    dfa.shortest_match_at(haystack, at),
+                    dfa.shortest_match_classes_at(&ids, at)
+                );
+            }
+        }
+    }
+
+    #[test]
+    #[should_panic]
+    fn class_id_search_rejects_foreign_classes() {
+        let a = DenseDFA::new("a").unwrap();
+        let b = DenseDFA::new("[0-9]").unwrap();
+        let mut ids = ClassIds::new();
+        a.translate(b"a", &mut ids);
+        b.is_match_classes(&ids);
+    }
+
     #[test]
     fn errors_when_converting_to_smaller_dfa() {
         let pattern = r"\w{10}";
@@ -2301,6 +3470,262 @@ mod tests {
         assert!(builder.build_with_size::<u8>(pattern).is_err());
     }
 
+    #[test]
+    fn dual_start_matches_separate_dfas() {
+        let patterns = &["abc", "a+b", "[0-9]+", "x*", "(foo|foobar)", r"\w+"];
+        let haystack = b"xxabc aab 123 foobarbaz";
+        for &pattern in patterns {
+            for &minimize in &[false, true] {
+                for &premultiply in &[false, true] {
+                    let mut builder = Builder::new();
+                    builder.minimize(minimize).premultiply(premultiply);
+                    let unanchored = builder.build(pattern).unwrap();
+                    let anchored =
+                        builder.anchored(true).build(pattern).unwrap();
+                    let dual = builder
+                        .anchored(false)
+                        .dual_start(true)
+                        .build(pattern)
+                        .unwrap();
+                    let sparse = dual.to_sparse().unwrap().to_u16().unwrap();
+                    assert!(unanchored.anchored_start_state().is_none());
+                    assert!(dual.anchored_start_state().is_some());
+
+                    for at in 0..haystack.len() + 1 {
+                        let (h, a) = (&haystack[at..], &anchored);
+                        assert_eq!(
+                            unanchored.find_at(haystack, at),
+                            dual.find_at(haystack, at),
+                            "{:?} at {}",
+                            pattern,
+                            at,
+                        );
+                        let expected = a.find(h).map(|end| at + end);
+                        assert_eq!(
+                            expected,
+                            dual.find_anchored_at(haystack, at)
+                        );
+                        assert_eq!(
+                            expected,
+                            sparse.find_anchored_at(haystack, at)
+                        );
+                        let expected = a.is_match(h);
+                        assert_eq!(
+                            expected,
+                            dual.is_match_anchored_at(haystack, at)
+                        );
+                        // An anchored DFA can be used for anchored searches at
+                        // any position.
+                        assert_eq!(
+                            expected,
+                            a.is_match_anchored_at(haystack, at)
+                        );
+                    }
+                }
+            }
+        }
+    }
+
+    #[test]
+    #[should_panic]
+    fn anchored_search_without_anchored_start_panics() {
+        let dfa = Builder::new().build("a").unwrap();
+        dfa.find_anchored_at(b"a", 0);
+    }
+
+    #[test]
+    fn dual_start_serialization_roundtrip() {
+        let dfa = Builder::new()
+            .dual_start(true)
+            .build_with_size::<u16>(r"[a-z]+[0-9]")
+            .unwrap();
+        let bytes = dfa.to_bytes_native_endian().unwrap();
+        let sparse = dfa.to_sparse().unwrap();
+        let sparse_bytes = sparse.to_bytes_native_endian().unwrap();
+
+        let mut storage = vec![0u16; (bytes.len() + 1) / 2];
+        let aligned = unsafe {
+            ::std::slice::from_raw_parts_mut(
+                storage.as_mut_ptr() as *mut u8,
+                bytes.len(),
+            )
+        };
+        aligned.copy_from_slice(&bytes);
+        let dense2: DenseDFA<&[u16], u16> =
+            unsafe { DenseDFA::from_bytes(aligned) };
+        let sparse2: SparseDFA<&[u8], u16> =
+            unsafe { SparseDFA::from_bytes(&sparse_bytes) };
+
+        assert_eq!(dfa.anchored_start_state(), dense2.anchored_start_state());
+        for &(haystack, at) in
+            &[(&b"--ab1"[..], 0), (b"--ab1", 2), (b"--ab1", 3), (b"1", 0)]
+        {
+            let expected = dfa.find_anchored_at(haystack, at);
+            assert_eq!(expected, dense2.find_anchored_at(haystack, at));
+            assert_eq!(expected, sparse2.find_anchored_at(haystack, at));
+            let expected = dfa.find_at(haystack, at);
+            assert_eq!(expected, dense2.find_at(haystack, at));
+            assert_eq!(expected, sparse2.find_at(haystack, at));
+        }
+
+        // Single-start DFAs are still written using the original format.
+        let single = Builder::new().build_with_size::<u16>("a").unwrap();
+        let bytes = single.to_bytes_native_endian().unwrap();
+        assert_eq!(1, NativeEndian::read_u16(&bytes[26..]));
+    }
+
+    #[test]
+    fn pow2_stride_matches_unpadded() {
+        let patterns = &["abc", "[a-z]+[0-9]", "(foo|foobar)", r"\w+", "x*"];
+        let haystack = "xxabc1 aab 123 foobarbaz ☃".as_bytes();
+        for &pattern in patterns {
+            for &premultiply in &[false, true] {
+                for &minimize in &[false, true] {
+                    let mut builder = Builder::new();
+                    builder
+                        .premultiply(premultiply)
+                        .minimize(minimize)
+                        .dual_start(true);
+                    let plain = builder.build(pattern).unwrap();
+                    let padded = builder
+                        .power_of_two_stride(true)
+                        .build(pattern)
+                        .unwrap();
+                    let sparse = padded.to_sparse().unwrap();
+                    let shrunk = padded.to_u32().unwrap();
+                    assert_eq!(plain.state_count(), padded.state_count());
+                    assert!(padded.repr().stride.is_power_of_two());
+                    let mut ids = ClassIds::new();
+                    padded.translate(haystack, &mut ids);
+                    for at in 0..haystack.len() + 1 {
+                        let expected = plain.find_at(haystack, at);
+                        assert_eq!(expected, padded.find_at(haystack, at));
+                        assert_eq!(expected, padded.find_classes_at(&ids, at));
+                        assert_eq!(expected, sparse.find_at(haystack, at));
+                        assert_eq!(expected, shrunk.find_at(haystack, at));
+                        assert_eq!(
+                            plain.rfind_at(haystack, at),
+                            padded.rfind_at(haystack, at),
+                        );
+                        assert_eq!(
+                            plain.find_anchored_at(haystack, at),
+                            padded.find_anchored_at(haystack, at),
+                        );
+                        assert_eq!(
+                            plain.shortest_match_at(haystack, at),
+                            padded.shortest_match_at(haystack, at),
+                        );
+                        assert_eq!(
+                            plain.is_match_at(haystack, at),
+                            padded.is_match_at(haystack, at),
+                        );
+                    }
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn pow2_stride_serialization_roundtrip() {
+        for &dual_start in &[false, true] {
+            let dfa = Builder::new()
+                .premultiply(false)
+                .power_of_two_stride(true)
+                .dual_start(dual_start)
+                .build_with_size::<u16>(r"[a-z]+[0-9]")
+                .unwrap();
+            let bytes = dfa.to_bytes_native_endian().unwrap();
+            assert_eq!(3, NativeEndian::read_u16(&bytes[26..]));
+
+            let mut storage = vec![0u16; (bytes.len() + 1) / 2];
+            let aligned = unsafe {
+                ::std::slice::from_raw_parts_mut(
+                    storage.as_mut_ptr() as *mut u8,
+                    bytes.len(),
+                )
+            };
+            aligned.copy_from_slice(&bytes);
+            let dfa2: DenseDFA<&[u16], u16> =
+                unsafe { DenseDFA::from_bytes(aligned) };
+            assert_eq!(
+                dfa.anchored_start_state(),
+                dfa2.anchored_start_state()
+            );
+            assert_eq!(dfa.memory_usage(), dfa2.memory_usage());
+            for &haystack in &[&b"--ab1"[..], b"1", b"", b"zz9z"] {
+                assert_eq!(dfa.find(haystack), dfa2.find(haystack));
+            }
+        }
+    }
+
+    #[test]
+    fn quit_reports_offset_and_resumes() {
+        let haystack = b"foo bar\nxyz 123 9\n\n42";
+        for &minimize in &[false, true] {
+            for &premultiply in &[false, true] {
+                for &byte_classes in &[false, true] {
+                    let dfa = Builder::new()
+                        .minimize(minimize)
+                        .premultiply(premultiply)
+                        .byte_classes(byte_classes)
+                        .quit(b'\n', true)
+                        .build(r"[0-9]+")
+                        .unwrap();
+                    assert_eq!(Err(7), dfa.try_find(haystack));
+                    assert_eq!(None, dfa.find(haystack));
+                    assert_eq!(Ok(Some(15)), dfa.try_find_at(haystack, 8));
+                    assert_eq!(Err(18), dfa.try_find_at(haystack, 18));
+                    assert_eq!(Ok(Some(21)), dfa.try_find_at(haystack, 19));
+                    assert!(dfa.to_sparse().is_err());
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn quit_matches_like_truncated_haystack() {
+        let with_quit = Builder::new()
+            .minimize(true)
+            .quit(b',', true)
+            .build(r"\w+[^a]")
+            .unwrap();
+        let without = Builder::new().build(r"\w+[^a]").unwrap();
+        for &haystack in &[&b"ab,cd"[..], b",ab", b"a,", b"xyz", b"x a,b"] {
+            let end = haystack
+                .iter()
+                .position(|&b| b == b',')
+                .unwrap_or(haystack.len());
+            assert_eq!(
+                without.find(&haystack[..end]),
+                with_quit.find(haystack)
+            );
+        }
+    }
+
+    #[test]
+    fn quit_serialization_roundtrip() {
+        let dfa = Builder::new()
+            .quit(b'\n', true)
+            .build_with_size::<u16>(r"[a-z]+[0-9]")
+            .unwrap();
+        let bytes = dfa.to_bytes_native_endian().unwrap();
+        assert_eq!(3, NativeEndian::read_u16(&bytes[26..]));
+
+        let mut storage = vec![0u16; (bytes.len() + 1) / 2];
+        let aligned = unsafe {
+            ::std::slice::from_raw_parts_mut(
+                storage.as_mut_ptr() as *mut u8,
+                bytes.len(),
+            )
+        };
+        aligned.copy_from_slice(&bytes);
+        let dfa2: DenseDFA<&[u16], u16> =
+            unsafe { DenseDFA::from_bytes(aligned) };
+        for &haystack in &[&b"--\nab1"[..], b"ab\n1", b"", b"zz9z"] {
+            assert_eq!(dfa.try_find(haystack), dfa2.try_find(haystack));
+        }
+    }
+
     // let data = ::std::fs::read_to_string("/usr/share/dict/words").unwrap();
     // let mut words: Vec<&str> = data.lines().collect();
     // println!("{} words", words.len());
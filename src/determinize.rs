@@ -2,6 +2,8 @@ use std::collections::HashMap;
 use std::mem;
 use std::rc::Rc;
 
+use byte_set::ByteSet;
+use classes::ByteClassSet;
 use dense;
 use error::Result;
 use nfa::{self, NFA};
@@ -47,6 +49,10 @@ pub(crate) struct Determinizer<'a, S: StateID> {
     scratch_nfa_states: Vec<nfa::StateID>,
     /// Whether to build a DFA that finds the longest possible match.
     longest_match: bool,
+    /// Whether to add an anchored start state to an unanchored DFA.
+    dual_start: bool,
+    /// The bytes on which every DFA state transitions to the quit state.
+    quit: ByteSet,
 }
 
 /// An intermediate representation for a DFA state during determinization.
@@ -73,6 +79,8 @@ impl<'a, S: StateID> Determinizer<'a, S> {
             stack: vec![],
             scratch_nfa_states: vec![],
             longest_match: false,
+            dual_start: false,
+            quit: ByteSet::empty(),
         }
     }
 
@@ -93,22 +101,68 @@ impl<'a, S: StateID> Determinizer<'a, S> {
         self
     }
 
+    /// Instruct the determinizer to build a DFA that has both an unanchored
+    /// start state and an anchored start state. This has no effect if the
+    /// NFA is anchored, since its only start state is already anchored.
+    pub fn dual_start(mut self, yes: bool) -> Determinizer<'a, S> {
+        self.dual_start = yes;
+        self
+    }
+
+    /// Instruct the determinizer to build a DFA in which every state
+    /// transitions to a quit state on any of the given bytes. If the set is
+    /// empty, then the DFA has no quit state.
+    pub fn quit(mut self, bytes: ByteSet) -> Determinizer<'a, S> {
+        self.quit = bytes;
+        self
+    }
+
     /// Build the DFA. If there was a problem constructing the DFA (e.g., if
     /// the chosen state identifier representation is too small), then an error
     /// is returned.
     pub fn build(mut self) -> Result<DFARepr<S>> {
+        let is_quit_class = self.add_quit()?;
+        let quit = self.dfa.quit_state();
         let representative_bytes: Vec<u8> =
             self.dfa.byte_classes().representatives().collect();
+        let mut buckets = vec![vec![]; representative_bytes.len()];
         let mut sparse = self.new_sparse_set();
         let mut uncompiled = vec![self.add_start(&mut sparse)?];
+        if self.dual_start && !self.nfa.is_anchored() {
+            if let Some(id) = self.add_anchored_start(&mut sparse)? {
+                uncompiled.push(id);
+            }
+        }
         while let Some(dfa_id) = uncompiled.pop() {
-            for &b in &representative_bytes {
-                let (next_dfa_id, is_new) =
-                    self.cached_state(dfa_id, b, &mut sparse)?;
-                self.dfa.add_transition(dfa_id, b, next_dfa_id);
-                if is_new {
-                    uncompiled.push(next_dfa_id);
+            self.bucket_transitions(dfa_id, &mut buckets);
+            // Neighboring classes often lead to the same NFA states, such as
+            // the classes of every ASCII byte that a `.` or a `[^a]` matches.
+            // Their next DFA state is only computed once.
+            let mut previous: Option<(usize, S)> = None;
+            for (class, targets) in buckets.iter().enumerate() {
+                let b = representative_bytes[class];
+                if is_quit_class[class] {
+                    self.dfa.add_transition(dfa_id, b, quit);
+                    continue;
                 }
+                // New states have no transitions, that is, every class
+                // leads to the dead state until it is given a transition.
+                if targets.is_empty() {
+                    continue;
+                }
+                let next_dfa_id = match previous {
+                    Some((p, id)) if buckets[p] == *targets => id,
+                    _ => {
+                        let (id, is_new) =
+                            self.cached_state(targets, &mut sparse)?;
+                        if is_new {
+                            uncompiled.push(id);
+                        }
+                        id
+                    }
+                };
+                previous = Some((class, next_dfa_id));
+                self.dfa.add_transition(dfa_id, b, next_dfa_id);
             }
         }
 
@@ -122,10 +176,45 @@ impl<'a, S: StateID> Determinizer<'a, S> {
         Ok(self.dfa)
     }
 
-    /// Return the identifier for the next DFA state given an existing DFA
-    /// state and an input byte. If the next DFA state already exists, then
-    /// return its identifier from the cache. Otherwise, build the state, cache
-    /// it and return its identifier.
+    /// Add the quit state right after the dead state, if there are any quit
+    /// bytes, and return which equivalence classes lead to it.
+    ///
+    /// Each quit byte is put into its own equivalence class first, so that
+    /// no other byte is sent to the quit state with it.
+    fn add_quit(&mut self) -> Result<Vec<bool>> {
+        if self.quit.is_empty() {
+            return Ok(vec![false; self.dfa.alphabet_len()]);
+        }
+        if !self.dfa.byte_classes().is_singleton() {
+            let mut set = ByteClassSet::new();
+            set.add_byte_classes(self.dfa.byte_classes());
+            for b in (0..256).map(|b| b as u8) {
+                if self.quit.contains(b) {
+                    set.set_range(b, b);
+                }
+            }
+            self.dfa = DFARepr::empty_with_byte_classes(set.byte_classes())
+                .anchored(self.nfa.is_anchored());
+        }
+        self.dfa.add_quit_state()?;
+        // The quit state is never looked up or compiled, so it's only here
+        // to keep identifiers and builder states in sync.
+        self.builder_states.push(Rc::new(State::dead()));
+
+        let classes = self.dfa.byte_classes();
+        let mut is_quit_class = vec![false; self.dfa.alphabet_len()];
+        for b in (0..256).map(|b| b as u8) {
+            if self.quit.contains(b) {
+                is_quit_class[classes.get(b) as usize] = true;
+            }
+        }
+        Ok(is_quit_class)
+    }
+
+    /// Return the identifier for the DFA state made up of the epsilon
+    /// closures of the given NFA states, in order. If that DFA state already
+    /// exists, then return its identifier from the cache. Otherwise, build
+    /// the state, cache it and return its identifier.
     ///
     /// The given sparse set is used for scratch space. It must have a capacity
     /// equivalent to the total number of NFA states, but its contents are
@@ -136,13 +225,14 @@ impl<'a, S: StateID> Determinizer<'a, S> {
     /// frontier of uncompiled DFA states to compute transitions for.
     fn cached_state(
         &mut self,
-        dfa_id: S,
-        b: u8,
+        targets: &[nfa::StateID],
         sparse: &mut SparseSet,
     ) -> Result<(S, bool)> {
         sparse.clear();
         // Compute the set of all reachable NFA states, including epsilons.
-        self.next(dfa_id, b, sparse);
+        for &nfa_id in targets {
+            self.epsilon_closure(nfa_id, sparse);
+        }
         // Build a candidate state and check if it has already been built.
         let state = self.new_state(sparse);
         if let Some(&cached_id) = self.cache.get(&state) {
@@ -155,29 +245,39 @@ impl<'a, S: StateID> Determinizer<'a, S> {
         self.add_state(state).map(|s| (s, true))
     }
 
-    /// Compute the set of all eachable NFA states, including the full epsilon
-    /// closure, from a DFA state for a single byte of input.
-    fn next(&mut self, dfa_id: S, b: u8, next_nfa_states: &mut SparseSet) {
-        next_nfa_states.clear();
-        for i in 0..self.builder_states[dfa_id.to_usize()].nfa_states.len() {
-            let nfa_id = self.builder_states[dfa_id.to_usize()].nfa_states[i];
+    /// Compute the NFA states reached from a DFA state on every equivalence
+    /// class at once, without their epsilon closures.
+    ///
+    /// After this returns, `buckets[c]` holds the targets of the transitions
+    /// on class `c` of the DFA state's NFA states, in the order of those NFA
+    /// states. This visits each NFA transition once, instead of once per
+    /// class.
+    fn bucket_transitions(
+        &self,
+        dfa_id: S,
+        buckets: &mut [Vec<nfa::StateID>],
+    ) {
+        for bucket in buckets.iter_mut() {
+            bucket.clear();
+        }
+        let classes = self.dfa.byte_classes();
+        let mut add = |r: &nfa::Transition| {
+            // The NFA's transitions never split an equivalence class, so
+            // every class in this range is entirely covered by it.
+            let (lo, hi) = (classes.get(r.start), classes.get(r.end));
+            for class in lo as usize..hi as usize + 1 {
+                buckets[class].push(r.next);
+            }
+        };
+        for &nfa_id in &self.builder_states[dfa_id.to_usize()].nfa_states {
             match *self.nfa.state(nfa_id) {
                 nfa::State::Union { .. }
                 | nfa::State::Fail
                 | nfa::State::Match => {}
-                nfa::State::Range { range: ref r } => {
-                    if r.start <= b && b <= r.end {
-                        self.epsilon_closure(r.next, next_nfa_states);
-                    }
-                }
+                nfa::State::Range { range: ref r } => add(r),
                 nfa::State::Sparse { ref ranges } => {
                     for r in ranges.iter() {
-                        if r.start > b {
-                            break;
-                        } else if r.start <= b && b <= r.end {
-                            self.epsilon_closure(r.next, next_nfa_states);
-                            break;
-                        }
+                        add(r);
                     }
                 }
             }
@@ -228,6 +328,28 @@ impl<'a, S: StateID> Determinizer<'a, S> {
         Ok(id)
     }
 
+    /// Compute the initial DFA state for anchored searches and return its
+    /// identifier if it is a new state. If it is equivalent to an existing
+    /// state (for example, when the unanchored prefix is empty), then that
+    /// state is reused and `None` is returned.
+    ///
+    /// The sparse set given is used for scratch space, and must have capacity
+    /// equal to the total number of NFA states. Its contents are unspecified.
+    fn add_anchored_start(
+        &mut self,
+        sparse: &mut SparseSet,
+    ) -> Result<Option<S>> {
+        sparse.clear();
+        self.epsilon_closure(self.nfa.start_anchored(), sparse);
+        let state = self.new_state(&sparse);
+        let (id, is_new) = match self.cache.get(&state) {
+            Some(&cached_id) => (cached_id, false),
+            None => (self.add_state(state)?, true),
+        };
+        self.dfa.set_anchored_start_state(id);
+        Ok(if is_new { Some(id) } else { None })
+    }
+
     /// Add the given state to the DFA and make it available in the cache.
     ///
     /// The state initially has no transitions. That is, it transitions to the
@@ -211,18 +211,7 @@ pub trait DFA {
         if self.is_anchored() && start > 0 {
             return false;
         }
-
-        let mut state = self.start_state();
-        if self.is_match_or_dead_state(state) {
-            return self.is_match_state(state);
-        }
-        for &b in bytes[start..].iter() {
-            state = unsafe { self.next_state_unchecked(state, b) };
-            if self.is_match_or_dead_state(state) {
-                return self.is_match_state(state);
-            }
-        }
-        false
+        is_match_from(self, self.start_state(), bytes, start)
     }
 
     /// Returns the same as `shortest_match`, but starts the search at the
@@ -236,22 +225,7 @@ pub trait DFA {
         if self.is_anchored() && start > 0 {
             return None;
         }
-
-        let mut state = self.start_state();
-        if self.is_match_or_dead_state(state) {
-            return if self.is_dead_state(state) { None } else { Some(start) };
-        }
-        for (i, &b) in bytes[start..].iter().enumerate() {
-            state = unsafe { self.next_state_unchecked(state, b) };
-            if self.is_match_or_dead_state(state) {
-                return if self.is_dead_state(state) {
-                    None
-                } else {
-                    Some(start + i + 1)
-                };
-            }
-        }
-        None
+        shortest_match_from(self, self.start_state(), bytes, start)
     }
 
     /// Returns the same as `find`, but starts the search at the given
@@ -265,25 +239,7 @@ pub trait DFA {
         if self.is_anchored() && start > 0 {
             return None;
         }
-
-        let mut state = self.start_state();
-        let mut last_match = if self.is_dead_state(state) {
-            return None;
-        } else if self.is_match_state(state) {
-            Some(start)
-        } else {
-            None
-        };
-        for (i, &b) in bytes[start..].iter().enumerate() {
-            state = unsafe { self.next_state_unchecked(state, b) };
-            if self.is_match_or_dead_state(state) {
-                if self.is_dead_state(state) {
-                    return last_match;
-                }
-                last_match = Some(start + i + 1);
-            }
-        }
-        last_match
+        find_from(self, self.start_state(), bytes, start)
     }
 
     /// Returns the same as `rfind`, but starts the search at the given
@@ -297,25 +253,114 @@ pub trait DFA {
         if self.is_anchored() && start < bytes.len() {
             return None;
         }
+        rfind_from(self, self.start_state(), bytes, start)
+    }
 
-        let mut state = self.start_state();
-        let mut last_match = if self.is_dead_state(state) {
-            return None;
-        } else if self.is_match_state(state) {
-            Some(start)
+    /// Return the identifier of this DFA's anchored start state, if it has
+    /// one.
+    ///
+    /// Beginning a search in the anchored start state at some position only
+    /// permits matches that begin at exactly that position. This is what
+    /// the `*_anchored_at` search routines use.
+    ///
+    /// An anchored DFA always has an anchored start state, which is the same
+    /// as its start state. An unanchored DFA only has one if it was built
+    /// with both start states. (See
+    /// [`dense::Builder::dual_start`](dense/struct.Builder.html#method.dual_start).)
+    #[inline]
+    fn anchored_start_state(&self) -> Option<Self::ID> {
+        if self.is_anchored() {
+            Some(self.start_state())
         } else {
             None
-        };
-        for (i, &b) in bytes[..start].iter().enumerate().rev() {
-            state = unsafe { self.next_state_unchecked(state, b) };
-            if self.is_match_or_dead_state(state) {
-                if self.is_dead_state(state) {
-                    return last_match;
-                }
-                last_match = Some(i);
-            }
         }
-        last_match
+    }
+
+    /// Returns true if and only if there is a match that begins at exactly
+    /// `start`.
+    ///
+    /// Unlike `is_match_at`, this treats `start` as the anchor point, even
+    /// when `start > 0`. This makes it possible to test many starting
+    /// positions using a single DFA, as is common when writing a tokenizer.
+    ///
+    /// # Panics
+    ///
+    /// This panics if this DFA has no anchored start state. That is, if it
+    /// is unanchored and was not built with both start states.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::{dense, DFA};
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let dfa = dense::Builder::new().dual_start(true).build("[0-9]+")?;
+    /// // Unanchored searches still work as usual...
+    /// assert!(dfa.is_match_at(b"foo 123", 1));
+    /// // ... while anchored searches require the match to begin at `start`.
+    /// assert!(!dfa.is_match_anchored_at(b"foo 123", 1));
+    /// assert!(dfa.is_match_anchored_at(b"foo 123", 4));
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    #[inline]
+    fn is_match_anchored_at(&self, bytes: &[u8], start: usize) -> bool {
+        let state = self.anchored_start_state().expect(NO_ANCHORED_START);
+        is_match_from(self, state, bytes, start)
+    }
+
+    /// Returns the same as `shortest_match_at`, except the match reported
+    /// must begin at exactly `start`.
+    ///
+    /// # Panics
+    ///
+    /// This panics if this DFA has no anchored start state.
+    #[inline]
+    fn shortest_match_anchored_at(
+        &self,
+        bytes: &[u8],
+        start: usize,
+    ) -> Option<usize> {
+        let state = self.anchored_start_state().expect(NO_ANCHORED_START);
+        shortest_match_from(self, state, bytes, start)
+    }
+
+    /// Returns the same as `find_at`, except the match reported must begin
+    /// at exactly `start`.
+    ///
+    /// # Panics
+    ///
+    /// This panics if this DFA has no anchored start state.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::{dense, DFA};
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let dfa = dense::Builder::new().dual_start(true).build("[a-z]+")?;
+    /// let haystack = b"foo bar";
+    /// assert_eq!(Some(3), dfa.find_anchored_at(haystack, 0));
+    /// assert_eq!(None, dfa.find_anchored_at(haystack, 3));
+    /// assert_eq!(Some(7), dfa.find_anchored_at(haystack, 4));
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    #[inline]
+    fn find_anchored_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        let state = self.anchored_start_state().expect(NO_ANCHORED_START);
+        find_from(self, state, bytes, start)
+    }
+
+    /// Returns the same as `rfind_at`, except the match reported must end at
+    /// exactly `start`. That is, searching proceeds backwards from `start`
+    /// and `start` is treated as the anchor point.
+    ///
+    /// # Panics
+    ///
+    /// This panics if this DFA has no anchored start state.
+    #[inline(never)]
+    fn rfind_anchored_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        let state = self.anchored_start_state().expect(NO_ANCHORED_START);
+        rfind_from(self, state, bytes, start)
     }
 }
 
@@ -347,6 +392,11 @@ impl<'a, T: DFA> DFA for &'a T {
         (**self).is_anchored()
     }
 
+    #[inline]
+    fn anchored_start_state(&self) -> Option<Self::ID> {
+        (**self).anchored_start_state()
+    }
+
     #[inline]
     fn next_state(&self, current: Self::ID, input: u8) -> Self::ID {
         (**self).next_state(current, input)
@@ -361,3 +411,116 @@ impl<'a, T: DFA> DFA for &'a T {
         (**self).next_state_unchecked(current, input)
     }
 }
+
+pub(crate) const NO_ANCHORED_START: &str = "DFA has no anchored start state";
+
+// The core search loops. Each of these begins searching in the given state,
+// which is either a DFA's start state or its anchored start state. They are
+// free functions (instead of default trait methods) so that they don't
+// become part of the public API.
+
+#[inline(always)]
+pub(crate) fn is_match_from<D: DFA + ?Sized>(
+    dfa: &D,
+    mut state: D::ID,
+    bytes: &[u8],
+    start: usize,
+) -> bool {
+    trace_start!(state);
+    if dfa.is_match_or_dead_state(state) {
+        return dfa.is_match_state(state);
+    }
+    for &b in bytes[start..].iter() {
+        let next = unsafe { dfa.next_state_unchecked(state, b) };
+        trace_transition!(state, b, next);
+        state = next;
+        if dfa.is_match_or_dead_state(state) {
+            return dfa.is_match_state(state);
+        }
+    }
+    false
+}
+
+#[inline(always)]
+pub(crate) fn shortest_match_from<D: DFA + ?Sized>(
+    dfa: &D,
+    mut state: D::ID,
+    bytes: &[u8],
+    start: usize,
+) -> Option<usize> {
+    trace_start!(state);
+    if dfa.is_match_or_dead_state(state) {
+        return if dfa.is_dead_state(state) { None } else { Some(start) };
+    }
+    for (i, &b) in bytes[start..].iter().enumerate() {
+        let next = unsafe { dfa.next_state_unchecked(state, b) };
+        trace_transition!(state, b, next);
+        state = next;
+        if dfa.is_match_or_dead_state(state) {
+            return if dfa.is_dead_state(state) {
+                None
+            } else {
+                Some(start + i + 1)
+            };
+        }
+    }
+    None
+}
+
+#[inline(always)]
+pub(crate) fn find_from<D: DFA + ?Sized>(
+    dfa: &D,
+    mut state: D::ID,
+    bytes: &[u8],
+    start: usize,
+) -> Option<usize> {
+    trace_start!(state);
+    let mut last_match = if dfa.is_dead_state(state) {
+        return None;
+    } else if dfa.is_match_state(state) {
+        Some(start)
+    } else {
+        None
+    };
+    for (i, &b) in bytes[start..].iter().enumerate() {
+        let next = unsafe { dfa.next_state_unchecked(state, b) };
+        trace_transition!(state, b, next);
+        state = next;
+        if dfa.is_match_or_dead_state(state) {
+            if dfa.is_dead_state(state) {
+                return last_match;
+            }
+            last_match = Some(start + i + 1);
+        }
+    }
+    last_match
+}
+
+#[inline(always)]
+pub(crate) fn rfind_from<D: DFA + ?Sized>(
+    dfa: &D,
+    mut state: D::ID,
+    bytes: &[u8],
+    start: usize,
+) -> Option<usize> {
+    trace_start!(state);
+    let mut last_match = if dfa.is_dead_state(state) {
+        return None;
+    } else if dfa.is_match_state(state) {
+        Some(start)
+    } else {
+        None
+    };
+    for (i, &b) in bytes[..start].iter().enumerate().rev() {
+        let next = unsafe { dfa.next_state_unchecked(state, b) };
+        trace_transition!(state, b, next);
+        state = next;
+        if dfa.is_match_or_dead_state(state) {
+            if dfa.is_dead_state(state) {
+                return last_match;
+            }
+            last_match = Some(i);
+        }
+    }
+    last_match
+}
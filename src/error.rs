@@ -79,6 +79,11 @@ impl Error {
         Error { kind: ErrorKind::Unsupported(msg.to_string()) }
     }
 
+    pub(crate) fn unsupported_quit() -> Error {
+        let msg = "DFAs with quit bytes are not supported here";
+        Error { kind: ErrorKind::Unsupported(msg.to_string()) }
+    }
+
     pub(crate) fn serialize(message: &str) -> Error {
         Error { kind: ErrorKind::Serialize(message.to_string()) }
     }
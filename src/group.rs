@@ -0,0 +1,229 @@
+use classes::{ByteClassSet, ByteClasses, ClassIds};
+use dense::DenseDFA;
+use error::Result;
+use state_id::StateID;
+
+/// A group of dense DFAs that share a single alphabet.
+///
+/// Each dense DFA that uses byte classes has its own partition of bytes into
+/// equivalence classes, and translates every byte it reads into its class
+/// before following a transition. When many DFAs search the same haystack,
+/// that translation is repeated once per DFA.
+///
+/// A `DFAGroup` instead computes one partition that refines the classes of
+/// every DFA in the group, and rebuilds each DFA's transition table over
+/// that shared alphabet. A haystack can then be translated into class
+/// identifiers once, via [`translate`](#method.translate), and the result
+/// searched by every DFA in the group without any further lookups.
+///
+/// The shared alphabet is at least as big as the alphabet of each DFA, so
+/// the transition tables in a group can be bigger than the original tables.
+/// This is the same trade off as disabling byte classes, but is usually much
+/// less pronounced for groups of related patterns.
+///
+/// # Example
+///
+/// ```
+/// use regex_automata::{ClassIds, DFAGroup, DenseDFA};
+///
+/// # fn example() -> Result<(), regex_automata::Error> {
+/// let group = DFAGroup::new(&[
+///     DenseDFA::new("[0-9]+")?,
+///     DenseDFA::new("[a-z]+")?,
+///     DenseDFA::new("[A-Z]+")?,
+/// ])?;
+///
+/// let mut ids = ClassIds::new();
+/// group.translate(b"abc123", &mut ids);
+/// let mut matched = vec![];
+/// group.which_match(&ids, &mut matched);
+/// assert_eq!(matched, vec![true, true, false]);
+/// assert_eq!(Some(6), group.find(0, &ids));
+/// # Ok(()) }; example().unwrap()
+/// ```
+#[derive(Clone, Debug)]
+pub struct DFAGroup<S: StateID = usize> {
+    classes: ByteClasses,
+    dfas: Vec<DenseDFA<Vec<S>, S>>,
+}
+
+impl<S: StateID> DFAGroup<S> {
+    /// Build a group from the given DFAs.
+    ///
+    /// Each DFA is copied into the group with a transition table over the
+    /// shared alphabet. The match semantics of each copy are the same as the
+    /// original's.
+    ///
+    /// If a premultiplied DFA can no longer be premultiplied with its state
+    /// identifier representation once its alphabet grows, then this returns
+    /// an error. Using a bigger state identifier representation, or DFAs that
+    /// aren't premultiplied, avoids this.
+    pub fn new<T: AsRef<[S]>>(dfas: &[DenseDFA<T, S>]) -> Result<DFAGroup<S>> {
+        let mut set = ByteClassSet::new();
+        for dfa in dfas {
+            set.add_byte_classes(dfa.repr().byte_classes());
+        }
+        let classes = set.byte_classes();
+        let mut group = Vec::with_capacity(dfas.len());
+        for dfa in dfas {
+            let repr = dfa.repr().with_byte_classes(classes)?;
+            group.push(repr.into_dense_dfa());
+        }
+        Ok(DFAGroup { classes, dfas: group })
+    }
+
+    /// Return the number of DFAs in this group.
+    pub fn len(&self) -> usize {
+        self.dfas.len()
+    }
+
+    /// Returns true if and only if this group has no DFAs.
+    pub fn is_empty(&self) -> bool {
+        self.dfas.is_empty()
+    }
+
+    /// Return the DFAs in this group, in the order they were given.
+    ///
+    /// Each DFA can also be used on its own to search untranslated
+    /// haystacks.
+    pub fn dfas(&self) -> &[DenseDFA<Vec<S>, S>] {
+        &self.dfas
+    }
+
+    /// Return the number of equivalence classes in the shared alphabet.
+    pub fn alphabet_len(&self) -> usize {
+        self.classes.alphabet_len()
+    }
+
+    /// Returns the memory usage, in bytes, of all DFAs in this group.
+    pub fn memory_usage(&self) -> usize {
+        self.dfas.iter().map(|d| d.memory_usage()).sum()
+    }
+
+    /// Translate the given haystack into the shared alphabet of this group,
+    /// replacing the previous contents of `ids`.
+    pub fn translate(&self, haystack: &[u8], ids: &mut ClassIds) {
+        ids.translate(&self.classes, haystack);
+    }
+
+    /// Returns true if and only if the DFA at the given index matches the
+    /// translated haystack.
+    ///
+    /// This behaves like `DFA::is_match` on the original haystack.
+    ///
+    /// # Panics
+    ///
+    /// This panics if `ids` was not translated by a group with the same
+    /// alphabet, or if `index` is out of bounds.
+    pub fn is_match(&self, index: usize, ids: &ClassIds) -> bool {
+        self.search(index, ids, true).is_some()
+    }
+
+    /// Returns the end of the leftmost first match of the DFA at the given
+    /// index in the translated haystack.
+    ///
+    /// This behaves like `DFA::find` on the original haystack.
+    ///
+    /// # Panics
+    ///
+    /// This panics if `ids` was not translated by a group with the same
+    /// alphabet, or if `index` is out of bounds.
+    pub fn find(&self, index: usize, ids: &ClassIds) -> Option<usize> {
+        self.search(index, ids, false)
+    }
+
+    /// Run every DFA in this group over the translated haystack, and
+    /// replace the contents of `matched` with whether each one matched, in
+    /// the order of this group's DFAs.
+    ///
+    /// # Panics
+    ///
+    /// This panics if `ids` was not translated by a group with the same
+    /// alphabet.
+    pub fn which_match(&self, ids: &ClassIds, matched: &mut Vec<bool>) {
+        self.check(ids);
+        matched.clear();
+        matched.extend(self.dfas.iter().map(|dfa| {
+            dfa.repr().find_classes_at(ids.as_slice(), 0, true).is_some()
+        }));
+    }
+
+    fn search(
+        &self,
+        index: usize,
+        ids: &ClassIds,
+        earliest: bool,
+    ) -> Option<usize> {
+        self.check(ids);
+        self.dfas[index].repr().find_classes_at(ids.as_slice(), 0, earliest)
+    }
+
+    /// Assert that `ids` uses this group's alphabet. This is what makes
+    /// unchecked transition table lookups safe during searches.
+    fn check(&self, ids: &ClassIds) {
+        assert!(
+            *ids.byte_classes() == self.classes,
+            "class identifiers were translated with a different alphabet"
+        );
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::DFAGroup;
+    use classes::ClassIds;
+    use dense::{self, DenseDFA};
+    use dfa::DFA;
+
+    #[test]
+    fn same_as_individual_dfas() {
+        let patterns = &[r"[0-9]+", r"[a-f]+x", r"\w+@\w+", r"foo|bar", r"☃"];
+        let haystacks: &[&[u8]] = &[
+            b"",
+            b"abc",
+            b"fox 123",
+            b"eeex",
+            b"me@example",
+            "snow☃".as_bytes(),
+        ];
+        for &premultiply in &[false, true] {
+            for &anchored in &[false, true] {
+                let dfas: Vec<DenseDFA<Vec<u32>, u32>> = patterns
+                    .iter()
+                    .map(|p| {
+                        dense::Builder::new()
+                            .premultiply(premultiply)
+                            .anchored(anchored)
+                            .build_with_size(p)
+                            .unwrap()
+                    })
+                    .collect();
+                let group = DFAGroup::new(&dfas).unwrap();
+                let mut ids = ClassIds::new();
+                let mut matched = vec![];
+                for &haystack in haystacks {
+                    group.translate(haystack, &mut ids);
+                    group.which_match(&ids, &mut matched);
+                    for (i, dfa) in dfas.iter().enumerate() {
+                        assert_eq!(dfa.is_match(haystack), matched[i]);
+                        assert_eq!(dfa.find(haystack), group.find(i, &ids));
+                        assert_eq!(
+                            dfa.find(haystack),
+                            group.dfas()[i].find(haystack)
+                        );
+                    }
+                }
+            }
+        }
+    }
+
+    #[test]
+    #[should_panic]
+    fn rejects_foreign_class_ids() {
+        let a = DFAGroup::new(&[DenseDFA::new("a").unwrap()]).unwrap();
+        let b = DFAGroup::new(&[DenseDFA::new("[0-9]").unwrap()]).unwrap();
+        let mut ids = ClassIds::new();
+        a.translate(b"a", &mut ids);
+        b.is_match(0, &ids);
+    }
+}
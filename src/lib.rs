@@ -301,16 +301,58 @@ extern crate fst;
 #[cfg(feature = "std")]
 extern crate regex_syntax;
 
+#[cfg(feature = "std")]
+pub use adaptive::AdaptiveRegex;
+#[cfg(feature = "std")]
+pub use any::AnyOf;
+#[cfg(feature = "std")]
+pub use async_regex::AsyncRegex;
+#[cfg(feature = "std")]
+pub use batch::RowOffset;
+#[cfg(feature = "std")]
+pub use classes::ClassIds;
 pub use dense::DenseDFA;
 pub use dfa::DFA;
 #[cfg(feature = "std")]
 pub use error::{Error, ErrorKind};
+#[cfg(feature = "std")]
+pub use group::DFAGroup;
+#[cfg(feature = "std")]
+pub use lite::LiteRegex;
+#[cfg(feature = "std")]
+pub use nibble::{CompactDFA, NibbleDFA};
+#[cfg(feature = "std")]
+pub use product::{ProductDFA, MAX_PRODUCT_DFAS};
 pub use regex::Regex;
 #[cfg(feature = "std")]
 pub use regex::RegexBuilder;
+#[cfg(feature = "std")]
+pub use replace::{ReplaceWriter, Replacement};
 pub use sparse::SparseDFA;
+#[cfg(feature = "std")]
+pub use split::Splitter;
 pub use state_id::StateID;
+#[cfg(feature = "std")]
+pub use stride2::Stride2DFA;
+pub use utf8::Utf8Error;
+#[cfg(feature = "trace")]
+pub use trace::Trace;
+
+// This must come first, since it defines the tracing hooks used by the
+// search routines in other modules.
+#[macro_use]
+mod trace;
 
+#[cfg(feature = "std")]
+mod adaptive;
+#[cfg(feature = "std")]
+mod any;
+#[cfg(feature = "std")]
+mod async_regex;
+#[cfg(feature = "std")]
+mod batch;
+#[cfg(feature = "std")]
+mod byte_set;
 mod classes;
 #[path = "dense.rs"]
 mod dense_imp;
@@ -320,18 +362,35 @@ mod dfa;
 #[cfg(feature = "std")]
 mod error;
 #[cfg(feature = "std")]
+mod group;
+#[cfg(feature = "std")]
+mod lite;
+#[cfg(feature = "std")]
 mod minimize;
 #[cfg(feature = "std")]
 #[doc(hidden)]
 pub mod nfa;
+#[cfg(feature = "std")]
+mod nibble;
+#[cfg(feature = "std")]
+mod parallel;
+#[cfg(feature = "std")]
+mod product;
 mod regex;
+#[cfg(feature = "std")]
+mod replace;
 #[path = "sparse.rs"]
 mod sparse_imp;
 #[cfg(feature = "std")]
 mod sparse_set;
+#[cfg(feature = "std")]
+mod split;
 mod state_id;
+#[cfg(feature = "std")]
+mod stride2;
 #[cfg(feature = "transducer")]
 mod transducer;
+mod utf8;
 
 /// Types and routines specific to dense DFAs.
 ///
@@ -364,11 +423,34 @@ pub mod sparse {
     pub use sparse_imp::*;
 }
 
-use std::ffi::{CStr};
+use std::ffi::{CStr, CString};
 
 extern crate libc;
 use libc::c_char;
 
+/// Return the `len` values at `p` as a slice.
+///
+/// Unlike `std::slice::from_raw_parts`, this permits `p` to be null when
+/// `len` is zero, which is what C++ passes for an empty `std::string_view`
+/// or `std::span`.
+unsafe fn raw_slice<'a, T>(p: *const T, len: usize) -> &'a [T] {
+    if len == 0 {
+        &[]
+    } else {
+        std::slice::from_raw_parts(p, len)
+    }
+}
+
+/// Return the `len` values at `p` as a mutable slice, where `p` may be null
+/// when `len` is zero. See `raw_slice`.
+unsafe fn raw_slice_mut<'a, T>(p: *mut T, len: usize) -> &'a mut [T] {
+    if len == 0 {
+        &mut []
+    } else {
+        std::slice::from_raw_parts_mut(p, len)
+    }
+}
+
 #[no_mangle]
 pub extern "C" fn regex_create(pattern: *const c_char) -> *mut Regex<DenseDFA<Vec<usize>, usize>> {
     println!("Calling regex new");
@@ -384,3 +466,636 @@ pub unsafe extern "C" fn regex_match(re: *mut Regex<DenseDFA<Vec<usize>, usize>>
     let matches: Vec<(usize, usize)> = re.find_iter(text_bytes).collect();
     matches.len()
 }
+
+/// Build a regex like `regex_create`, which can also find the last matches
+/// of a text without searching all of it. See `regex_find_last`.
+///
+/// This returns null if the pattern is invalid.
+#[no_mangle]
+pub unsafe extern "C" fn regex_create_reverse(
+    pattern: *const c_char,
+) -> *mut Regex<DenseDFA<Vec<usize>, usize>> {
+    let pattern = match CStr::from_ptr(pattern).to_str() {
+        Ok(pattern) => pattern,
+        Err(_) => return std::ptr::null_mut(),
+    };
+    match RegexBuilder::new().reverse_unanchored(true).build(pattern) {
+        Ok(re) => Box::into_raw(Box::new(re)),
+        Err(_) => std::ptr::null_mut(),
+    }
+}
+
+/// Write the start and end offsets of the last `n` matches of `re` in the
+/// `len` bytes at `text` to `starts` and `ends`, in the order in which they
+/// appear in `text`, and return how many matches were written.
+///
+/// `starts` and `ends` must each have room for `n` offsets. For a regex built
+/// by `regex_create_reverse`, this searches `text` backwards from its end and
+/// stops once it has found `n` matches. Otherwise, all of `text` is searched.
+///
+/// The two searches only differ when matches of `re` can overlap. Searching
+/// backwards finds each match relative to the end of the text not yet
+/// searched, like `Regex::rfind_iter`, while searching forwards returns the
+/// last `n` matches found by `Regex::find_iter`. For example, the last match
+/// of `aa` in `aaa` is `[1, 3)` for a regex built by `regex_create_reverse`,
+/// and `[0, 2)` otherwise.
+#[no_mangle]
+pub unsafe extern "C" fn regex_find_last(
+    re: *const Regex<DenseDFA<Vec<usize>, usize>>,
+    text: *const u8,
+    len: usize,
+    n: usize,
+    starts: *mut usize,
+    ends: *mut usize,
+) -> usize {
+    let re = re.as_ref().unwrap();
+    if n == 0 {
+        return 0;
+    }
+    let text = raw_slice(text, len);
+    let starts = raw_slice_mut(starts, n);
+    let ends = raw_slice_mut(ends, n);
+    let last: Vec<(usize, usize)> =
+        if re.reverse_unanchored().is_some() || re.forward().is_anchored() {
+            let mut last: Vec<_> = re.rfind_iter(text).take(n).collect();
+            last.reverse();
+            last
+        } else {
+            let mut last = std::collections::VecDeque::with_capacity(n);
+            for m in re.find_iter(text) {
+                if last.len() == n {
+                    last.pop_front();
+                }
+                last.push_back(m);
+            }
+            last.into_iter().collect()
+        };
+    for (i, &(s, e)) in last.iter().enumerate() {
+        starts[i] = s;
+        ends[i] = e;
+    }
+    last.len()
+}
+
+/// Options for `regex_build`. Each corresponds to the `RegexBuilder` option
+/// of the same name. `regex_options_default` returns the default options.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct RegexOptions {
+    pub anchored: bool,
+    pub case_insensitive: bool,
+    pub ignore_whitespace: bool,
+    pub dot_matches_new_line: bool,
+    pub swap_greed: bool,
+    pub unicode: bool,
+    pub minimize: bool,
+    pub reverse_unanchored: bool,
+    pub parallel: bool,
+}
+
+/// Return the options `regex_build` uses when it isn't given any.
+#[no_mangle]
+pub extern "C" fn regex_options_default() -> RegexOptions {
+    RegexOptions {
+        anchored: false,
+        case_insensitive: false,
+        ignore_whitespace: false,
+        dot_matches_new_line: false,
+        swap_greed: false,
+        unicode: true,
+        minimize: false,
+        reverse_unanchored: false,
+        parallel: false,
+    }
+}
+
+/// Build a regex from the `len` bytes at `pattern`, which need not be NUL
+/// terminated, using `options`, or the defaults if `options` is null.
+///
+/// This returns null if the regex can't be built. If `error` is not null, it
+/// is then set to a NUL terminated description of the error, which must be
+/// freed with `regex_error_free`. The regex must be freed with `regex_free`.
+#[no_mangle]
+pub unsafe extern "C" fn regex_build(
+    pattern: *const u8,
+    len: usize,
+    options: *const RegexOptions,
+    error: *mut *mut c_char,
+) -> *mut Regex<DenseDFA<Vec<usize>, usize>> {
+    let opts = options.as_ref().cloned().unwrap_or(regex_options_default());
+    let result = std::str::from_utf8(raw_slice(pattern, len))
+        .map_err(|err| err.to_string())
+        .and_then(|pattern| {
+            RegexBuilder::new()
+                .anchored(opts.anchored)
+                .case_insensitive(opts.case_insensitive)
+                .ignore_whitespace(opts.ignore_whitespace)
+                .dot_matches_new_line(opts.dot_matches_new_line)
+                .swap_greed(opts.swap_greed)
+                .unicode(opts.unicode)
+                .minimize(opts.minimize)
+                .reverse_unanchored(opts.reverse_unanchored)
+                .parallel(opts.parallel)
+                .build(pattern)
+                .map_err(|err| err.to_string())
+        });
+    match result {
+        Ok(re) => Box::into_raw(Box::new(re)),
+        Err(msg) => {
+            if let Some(error) = error.as_mut() {
+                let msg = msg.replace('\0', "");
+                *error = CString::new(msg).unwrap().into_raw();
+            }
+            std::ptr::null_mut()
+        }
+    }
+}
+
+/// Free an error description written by `regex_build`.
+#[no_mangle]
+pub unsafe extern "C" fn regex_error_free(error: *mut c_char) {
+    if !error.is_null() {
+        drop(CString::from_raw(error));
+    }
+}
+
+/// Free a regex built by `regex_create`, `regex_create_reverse` or
+/// `regex_build`.
+#[no_mangle]
+pub unsafe extern "C" fn regex_free(
+    re: *mut Regex<DenseDFA<Vec<usize>, usize>>,
+) {
+    if !re.is_null() {
+        drop(Box::from_raw(re));
+    }
+}
+
+/// Return whether `re` matches anywhere in the `len` bytes at `text`.
+#[no_mangle]
+pub unsafe extern "C" fn regex_is_match(
+    re: *const Regex<DenseDFA<Vec<usize>, usize>>,
+    text: *const u8,
+    len: usize,
+) -> bool {
+    let re = re.as_ref().unwrap();
+    re.is_match(raw_slice(text, len))
+}
+
+/// Where an iteration over the matches of a regex is at, which lets
+/// `regex_find_batch` continue from where an earlier call stopped.
+///
+/// An iteration starts with `last_end` set to `0` and `last_match` set to
+/// `SIZE_MAX`.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct RegexCursor {
+    /// The offset at which the next search starts.
+    pub last_end: usize,
+    /// The end of the last match found, or `SIZE_MAX` if none has been.
+    pub last_match: usize,
+}
+
+/// Write the start and end offsets of the next `n` matches of `re` in the
+/// `len` bytes at `text` to `starts` and `ends`, and return how many matches
+/// were written. Fewer than `n` are written only once there are no more.
+///
+/// The matches are those `Regex::find_iter` yields, continuing from
+/// `cursor`, which is advanced past them. `starts` and `ends` must each have
+/// room for `n` offsets.
+#[no_mangle]
+pub unsafe extern "C" fn regex_find_batch(
+    re: *const Regex<DenseDFA<Vec<usize>, usize>>,
+    text: *const u8,
+    len: usize,
+    cursor: *mut RegexCursor,
+    n: usize,
+    starts: *mut usize,
+    ends: *mut usize,
+) -> usize {
+    let re = re.as_ref().unwrap();
+    let cursor = cursor.as_mut().unwrap();
+    if n == 0 {
+        return 0;
+    }
+    let text = raw_slice(text, len);
+    let starts = raw_slice_mut(starts, n);
+    let ends = raw_slice_mut(ends, n);
+    let last_match = match cursor.last_match {
+        std::usize::MAX => None,
+        e => Some(e),
+    };
+    let mut it =
+        regex::Matches::resume(re, text, (cursor.last_end, last_match));
+    let mut count = 0;
+    while count < n {
+        match it.next() {
+            None => break,
+            Some((s, e)) => {
+                starts[count] = s;
+                ends[count] = e;
+                count += 1;
+            }
+        }
+    }
+    let (last_end, last_match) = it.position();
+    cursor.last_end = last_end;
+    cursor.last_match = last_match.unwrap_or(std::usize::MAX);
+    count
+}
+
+/// Write the `len` bytes at `text` to the `len` bytes at `out`, with every
+/// byte of every match of `re` overwritten by `mask`, and return the number
+/// of matches masked. `out` must not overlap `text`.
+#[no_mangle]
+pub unsafe extern "C" fn regex_mask_all(
+    re: *const Regex<DenseDFA<Vec<usize>, usize>>,
+    text: *const u8,
+    len: usize,
+    mask: u8,
+    out: *mut u8,
+) -> usize {
+    let re = re.as_ref().unwrap();
+    let text = raw_slice(text, len);
+    re.mask_all_to_slice(text, mask, raw_slice_mut(out, len))
+}
+
+/// Passes the output of a `RegexReplacer` to a C callback.
+struct CallbackWriter {
+    callback: extern "C" fn(*mut libc::c_void, *const u8, usize),
+    user_data: *mut libc::c_void,
+}
+
+impl std::io::Write for CallbackWriter {
+    fn write(&mut self, buf: &[u8]) -> std::io::Result<usize> {
+        if !buf.is_empty() {
+            (self.callback)(self.user_data, buf.as_ptr(), buf.len());
+        }
+        Ok(buf.len())
+    }
+
+    fn flush(&mut self) -> std::io::Result<()> {
+        Ok(())
+    }
+}
+
+/// A stream that replaces the matches of a regex in the records written to
+/// it. See `regex_replacer_create`.
+pub struct RegexReplacer {
+    writer: ReplaceWriter<'static, DenseDFA<Vec<usize>, usize>, CallbackWriter>,
+}
+
+unsafe fn replacer(
+    re: *const Regex<DenseDFA<Vec<usize>, usize>>,
+    replacement: Replacement,
+    delimiter: u8,
+    callback: extern "C" fn(*mut libc::c_void, *const u8, usize),
+    user_data: *mut libc::c_void,
+) -> *mut RegexReplacer {
+    let re = re.as_ref().unwrap();
+    let wtr = CallbackWriter { callback, user_data };
+    let writer = re.replace_writer(replacement, delimiter, wtr);
+    Box::into_raw(Box::new(RegexReplacer { writer }))
+}
+
+/// Start a stream that replaces every match of `re` with the
+/// `replacement_len` bytes at `replacement`, and passes its output to
+/// `callback` along with `user_data`.
+///
+/// The input written with `regex_replacer_write` is split into records, each
+/// terminated by `delimiter`, and complete records are replaced and passed
+/// to `callback` as soon as they have been written. The output is the same
+/// as replacing the matches in all of the input at once, provided no match
+/// contains the delimiter. `re` must outlive the stream, which is ended with
+/// `regex_replacer_finish`.
+#[no_mangle]
+pub unsafe extern "C" fn regex_replacer_create(
+    re: *const Regex<DenseDFA<Vec<usize>, usize>>,
+    replacement: *const u8,
+    replacement_len: usize,
+    delimiter: u8,
+    callback: extern "C" fn(*mut libc::c_void, *const u8, usize),
+    user_data: *mut libc::c_void,
+) -> *mut RegexReplacer {
+    let replacement = raw_slice(replacement, replacement_len);
+    let replacement = Replacement::Bytes(replacement);
+    replacer(re, replacement, delimiter, callback, user_data)
+}
+
+/// Start a stream like `regex_replacer_create`, which overwrites every byte
+/// of every match of `re` with `mask` instead.
+#[no_mangle]
+pub unsafe extern "C" fn regex_masker_create(
+    re: *const Regex<DenseDFA<Vec<usize>, usize>>,
+    mask: u8,
+    delimiter: u8,
+    callback: extern "C" fn(*mut libc::c_void, *const u8, usize),
+    user_data: *mut libc::c_void,
+) -> *mut RegexReplacer {
+    replacer(re, Replacement::Mask(mask), delimiter, callback, user_data)
+}
+
+/// Write the `len` bytes at `data` to a stream started by
+/// `regex_replacer_create` or `regex_masker_create`.
+#[no_mangle]
+pub unsafe extern "C" fn regex_replacer_write(
+    replacer: *mut RegexReplacer,
+    data: *const u8,
+    len: usize,
+) {
+    use std::io::Write;
+
+    let replacer = replacer.as_mut().unwrap();
+    let data = raw_slice(data, len);
+    // Writing to a CallbackWriter never fails.
+    replacer.writer.write_all(data).unwrap();
+}
+
+/// End a stream, passing the replaced final record, if it wasn't terminated
+/// by the delimiter, to its callback. This frees the stream, and returns the
+/// number of matches it replaced.
+#[no_mangle]
+pub unsafe extern "C" fn regex_replacer_finish(
+    replacer: *mut RegexReplacer,
+) -> usize {
+    let mut replacer = Box::from_raw(replacer);
+    replacer.writer.write_pending().unwrap();
+    replacer.writer.count()
+}
+
+/// Build a splitter for texts whose fields are separated by the matches of
+/// `re`. The regex is copied into the splitter, so it may be freed once the
+/// splitter has been built.
+#[no_mangle]
+pub unsafe extern "C" fn regex_splitter_create(
+    re: *const Regex<DenseDFA<Vec<usize>, usize>>,
+) -> *mut Splitter<DenseDFA<Vec<usize>, usize>> {
+    let re = re.as_ref().unwrap().clone();
+    Box::into_raw(Box::new(Splitter::new(re)))
+}
+
+/// Write the start and end offsets of the fields of the `len` bytes at
+/// `text` to `starts` and `ends`, and return the number of fields written.
+///
+/// `starts` and `ends` must each have room for `n` offsets. When there are
+/// more than `n` fields, the last field written covers all of the remaining
+/// text. Delimiters that are a single byte from a fixed set, such as `,` or
+/// `[\t;]`, are found without running the regex.
+#[no_mangle]
+pub unsafe extern "C" fn regex_splitter_fields(
+    splitter: *const Splitter<DenseDFA<Vec<usize>, usize>>,
+    text: *const u8,
+    len: usize,
+    n: usize,
+    starts: *mut usize,
+    ends: *mut usize,
+) -> usize {
+    let splitter = splitter.as_ref().unwrap();
+    if n == 0 {
+        return 0;
+    }
+    let text = raw_slice(text, len);
+    let starts = raw_slice_mut(starts, n);
+    let ends = raw_slice_mut(ends, n);
+    splitter.fields(text, starts, ends)
+}
+
+/// Free a splitter built by `regex_splitter_create`.
+#[no_mangle]
+pub unsafe extern "C" fn regex_splitter_free(
+    splitter: *mut Splitter<DenseDFA<Vec<usize>, usize>>,
+) {
+    if !splitter.is_null() {
+        drop(Box::from_raw(splitter));
+    }
+}
+
+/// Count the matches of `re` in `text` while checking that `text` is valid
+/// UTF-8 in the same pass.
+///
+/// This returns the number of matches, or `-1` if `text` is not valid UTF-8.
+/// In the latter case, the offset of the first invalid byte is written to
+/// `invalid_at` when it is not null.
+#[no_mangle]
+pub unsafe extern "C" fn regex_match_utf8(
+    re: *mut Regex<DenseDFA<Vec<usize>, usize>>,
+    text: *const c_char,
+    invalid_at: *mut usize,
+) -> isize {
+    let re = re.as_ref().unwrap();
+    let text_bytes = CStr::from_ptr(text).to_bytes();
+    let mut count = 0;
+    for m in re.find_iter_validated(text_bytes) {
+        match m {
+            Ok(_) => count += 1,
+            Err(err) => {
+                if let Some(invalid_at) = invalid_at.as_mut() {
+                    *invalid_at = err.valid_up_to();
+                }
+                return -1;
+            }
+        }
+    }
+    count
+}
+
+/// Build a group matcher from `len` regexes, which combines their forward
+/// DFAs into a single product DFA when it is small enough.
+///
+/// This returns null if `len` is zero or greater than 8. The regexes may be
+/// freed once the group has been built.
+#[no_mangle]
+pub unsafe extern "C" fn regex_group_create(
+    res: *const *const Regex<DenseDFA<Vec<usize>, usize>>,
+    len: usize,
+) -> *mut ProductDFA<usize> {
+    if len == 0 || len > MAX_PRODUCT_DFAS {
+        return std::ptr::null_mut();
+    }
+    let res = raw_slice(res, len);
+    let dfas: Vec<_> =
+        res.iter().map(|re| re.as_ref().unwrap().forward().as_ref()).collect();
+    Box::into_raw(Box::new(ProductDFA::new(&dfas)))
+}
+
+/// Return the set of regexes in `group` that match `text`, where bit `i` is
+/// set if and only if the `i`th regex given to `regex_group_create` matches.
+#[no_mangle]
+pub unsafe extern "C" fn regex_group_match(
+    group: *const ProductDFA<usize>,
+    text: *const c_char,
+) -> u8 {
+    let group = group.as_ref().unwrap();
+    group.which_match(CStr::from_ptr(text).to_bytes())
+}
+
+/// Free a group matcher built by `regex_group_create`.
+#[no_mangle]
+pub unsafe extern "C" fn regex_group_free(group: *mut ProductDFA<usize>) {
+    if !group.is_null() {
+        drop(Box::from_raw(group));
+    }
+}
+
+/// Build a group of `len` regexes that answers whether any of them match,
+/// trying the regexes most likely to match cheaply first.
+///
+/// The regexes are copied into the group, so they may be freed once the
+/// group has been built. `res` may be null when `len` is zero, in which case
+/// the group never matches.
+#[no_mangle]
+pub unsafe extern "C" fn regex_any_create(
+    res: *const *const Regex<DenseDFA<Vec<usize>, usize>>,
+    len: usize,
+) -> *mut AnyOf<DenseDFA<Vec<usize>, usize>> {
+    let res = raw_slice(res, len);
+    let regexes = res.iter().map(|re| re.as_ref().unwrap().clone()).collect();
+    Box::into_raw(Box::new(AnyOf::new(regexes)))
+}
+
+/// Return the index of a regex in `any` that matches `text`, or `-1` if none
+/// of them match.
+///
+/// This updates the statistics used to order the regexes, so a group must not
+/// be used by more than one thread at a time.
+#[no_mangle]
+pub unsafe extern "C" fn regex_any_match(
+    any: *mut AnyOf<DenseDFA<Vec<usize>, usize>>,
+    text: *const c_char,
+) -> isize {
+    let any = any.as_mut().unwrap();
+    match any.match_index(CStr::from_ptr(text).to_bytes()) {
+        Some(i) => i as isize,
+        None => -1,
+    }
+}
+
+/// Free a group built by `regex_any_create`.
+#[no_mangle]
+pub unsafe extern "C" fn regex_any_free(
+    any: *mut AnyOf<DenseDFA<Vec<usize>, usize>>,
+) {
+    if !any.is_null() {
+        drop(Box::from_raw(any));
+    }
+}
+
+/// Write a selection bitmap for a column of `rows` strings stored as Arrow
+/// style `int32` offsets and a values buffer, where bit `i` (least
+/// significant bit first) is set if and only if row `i` matches `re`.
+///
+/// `offsets` must have `rows + 1` entries and `bitmap` must have room for
+/// one bit per row. `values` and `bitmap` may be null when they would be
+/// empty. When `threads` is greater than 1, ranges of rows are searched on
+/// up to that many threads.
+#[no_mangle]
+pub unsafe extern "C" fn regex_select_rows(
+    re: *const Regex<DenseDFA<Vec<usize>, usize>>,
+    offsets: *const i32,
+    rows: usize,
+    values: *const u8,
+    values_len: usize,
+    bitmap: *mut u8,
+    threads: usize,
+) {
+    let re = re.as_ref().unwrap();
+    let offsets = raw_slice(offsets, rows + 1);
+    let values = raw_slice(values, values_len);
+    let bitmap = raw_slice_mut(bitmap, (rows + 7) / 8);
+    if threads > 1 {
+        re.select_rows_parallel(offsets, values, bitmap, threads);
+    } else {
+        re.select_rows(offsets, values, bitmap);
+    }
+}
+
+/// Write the number of matches of `re` in each row of a column of `rows`
+/// strings stored as Arrow style `int32` offsets and a values buffer.
+///
+/// `offsets` must have `rows + 1` entries and `counts` must have `rows`
+/// entries. `values` and `counts` may be null when they would be empty.
+/// When `threads` is greater than 1, ranges of rows are searched on up to
+/// that many threads.
+#[no_mangle]
+pub unsafe extern "C" fn regex_count_rows(
+    re: *const Regex<DenseDFA<Vec<usize>, usize>>,
+    offsets: *const i32,
+    rows: usize,
+    values: *const u8,
+    values_len: usize,
+    counts: *mut u32,
+    threads: usize,
+) {
+    let re = re.as_ref().unwrap();
+    let offsets = raw_slice(offsets, rows + 1);
+    let values = raw_slice(values, values_len);
+    let counts = raw_slice_mut(counts, rows);
+    if threads > 1 {
+        re.count_rows_parallel(offsets, values, counts, threads);
+    } else {
+        re.count_rows(offsets, values, counts);
+    }
+}
+
+/// User data for a completion callback. The caller of `regex_create_async`
+/// is responsible for making it safe to use from the background thread.
+struct CallbackData(*mut libc::c_void);
+
+unsafe impl Send for CallbackData {}
+
+/// Build a regex whose DFAs are built on a background thread, and which
+/// simulates the pattern's NFA to answer searches until they are ready.
+///
+/// When `callback` is not null, it is called from the background thread with
+/// `user_data` and whether the DFAs were built, once the build has finished.
+/// If no thread can be spawned, the DFAs are built, and `callback` is called,
+/// on the calling thread before this returns. This returns null if the
+/// pattern is invalid.
+#[no_mangle]
+pub unsafe extern "C" fn regex_create_async(
+    pattern: *const c_char,
+    callback: Option<extern "C" fn(*mut libc::c_void, bool)>,
+    user_data: *mut libc::c_void,
+) -> *mut AsyncRegex {
+    let pattern = match CStr::from_ptr(pattern).to_str() {
+        Ok(pattern) => pattern,
+        Err(_) => return std::ptr::null_mut(),
+    };
+    let data = CallbackData(user_data);
+    let re = RegexBuilder::new().build_async_with(pattern, move |result| {
+        if let Some(callback) = callback {
+            callback(data.0, result.is_ok());
+        }
+    });
+    match re {
+        Ok(re) => Box::into_raw(Box::new(re)),
+        Err(_) => std::ptr::null_mut(),
+    }
+}
+
+/// Count the matches of `re` in `text`, using its DFAs if they are ready.
+#[no_mangle]
+pub unsafe extern "C" fn regex_async_match(
+    re: *const AsyncRegex,
+    text: *const c_char,
+) -> usize {
+    let re = re.as_ref().unwrap();
+    re.find_iter(CStr::from_ptr(text).to_bytes()).count()
+}
+
+/// Return whether the DFAs of `re` have been built.
+#[no_mangle]
+pub unsafe extern "C" fn regex_async_is_ready(re: *const AsyncRegex) -> bool {
+    re.as_ref().unwrap().is_ready()
+}
+
+/// Free a regex built by `regex_create_async`.
+///
+/// This waits for the background build to finish, so the completion callback
+/// is never called after this returns.
+#[no_mangle]
+pub unsafe extern "C" fn regex_async_free(re: *mut AsyncRegex) {
+    if !re.is_null() {
+        let re = Box::from_raw(re);
+        re.wait();
+    }
+}
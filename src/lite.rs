@@ -0,0 +1,448 @@
+use std::ptr;
+use std::sync::atomic::{AtomicPtr, Ordering};
+use std::sync::Mutex;
+
+use dfa::DFA;
+use error::{Error, Result};
+use nfa::{PikeVM, NFA};
+use regex::{Regex, RegexBuilder};
+
+/// A regex that searches ASCII text with small ASCII-only DFAs, and builds
+/// its full DFAs lazily, the first time it has to search non-ASCII text.
+///
+/// Unicode-aware character classes such as `\w`, `\d` and `\s` produce DFAs
+/// that are much bigger, and much slower to build, than their ASCII
+/// counterparts. Yet on ASCII text, both match precisely the same strings.
+/// A `LiteRegex` exploits this by first building the pattern with Unicode
+/// mode disabled. Each search uses the resulting ASCII DFAs until the
+/// forward DFA would have to read a byte greater than `0x7F`, at which point
+/// the search is restarted with DFAs built from the pattern using the
+/// builder's actual configuration. Those DFAs are built at most once and
+/// are then shared by all subsequent searches, including searches from
+/// other threads. Once built, they are read without taking a lock.
+///
+/// Consequently, a `LiteRegex` always reports the same results as the
+/// corresponding [`Regex`](struct.Regex.html) built via
+/// [`RegexBuilder::build`](struct.RegexBuilder.html#method.build).
+///
+/// A `LiteRegex` is built with
+/// [`RegexBuilder::build_lite`](struct.RegexBuilder.html#method.build_lite).
+/// Patterns that cannot be built without Unicode mode (such as `\pL`) are
+/// supported, but their full DFAs are built right away.
+///
+/// Building a `LiteRegex` checks that the pattern compiles with the
+/// builder's configuration, so building its full DFAs later can only fail if
+/// they are too big. In that case, searches that read non-ASCII text
+/// simulate the pattern's NFA instead, which is slower but reports the same
+/// results. [`build_unicode`](struct.LiteRegex.html#method.build_unicode)
+/// builds the full DFAs right away and returns the error, if any.
+///
+/// # Example
+///
+/// ```
+/// use regex_automata::RegexBuilder;
+///
+/// # fn example() -> Result<(), regex_automata::Error> {
+/// let re = RegexBuilder::new().build_lite(r"\w+")?;
+/// assert_eq!(Some((1, 4)), re.find(b" foo "));
+/// assert!(!re.is_unicode_built());
+///
+/// assert_eq!(Some((1, 5)), re.find(" fȯo ".as_bytes()));
+/// assert!(re.is_unicode_built());
+/// # Ok(()) }; example().unwrap()
+/// ```
+#[derive(Debug)]
+pub struct LiteRegex {
+    pattern: String,
+    builder: RegexBuilder,
+    ascii: Option<Regex>,
+    /// What searches that read non-ASCII text use, or null if it hasn't
+    /// been built yet. It is set at most once, after which it never changes
+    /// until it is freed along with this value.
+    unicode: AtomicPtr<Unicode>,
+    /// The pattern's NFA, until `unicode` is set. Holding this lock
+    /// serializes building `unicode`.
+    nfa: Mutex<Option<NFA>>,
+}
+
+impl Drop for LiteRegex {
+    fn drop(&mut self) {
+        let unicode = *self.unicode.get_mut();
+        if !unicode.is_null() {
+            unsafe {
+                drop(Box::from_raw(unicode));
+            }
+        }
+    }
+}
+
+/// What searches that read non-ASCII text use.
+#[derive(Debug)]
+enum Unicode {
+    /// The full DFAs for the pattern.
+    Regex(Regex),
+    /// The pattern's NFA, which is simulated because building its full DFAs
+    /// failed with the given error.
+    NFA(PikeVM, Error),
+}
+
+impl LiteRegex {
+    /// Create a regex from its ASCII DFAs and the pattern's NFA, both built
+    /// with `builder`, whose full DFAs are built later.
+    pub(crate) fn new(
+        pattern: &str,
+        builder: RegexBuilder,
+        ascii: Regex,
+        nfa: NFA,
+    ) -> LiteRegex {
+        LiteRegex {
+            pattern: pattern.to_string(),
+            builder,
+            ascii: Some(ascii),
+            unicode: AtomicPtr::new(ptr::null_mut()),
+            nfa: Mutex::new(Some(nfa)),
+        }
+    }
+
+    /// Create a regex whose full DFAs were built right away, because the
+    /// pattern can't be built without Unicode mode.
+    pub(crate) fn unicode_only(
+        pattern: &str,
+        builder: RegexBuilder,
+        unicode: Regex,
+    ) -> LiteRegex {
+        let unicode = Box::new(Unicode::Regex(unicode));
+        LiteRegex {
+            pattern: pattern.to_string(),
+            builder,
+            ascii: None,
+            unicode: AtomicPtr::new(Box::into_raw(unicode)),
+            nfa: Mutex::new(None),
+        }
+    }
+
+    /// Returns true if and only if the given bytes match.
+    ///
+    /// This behaves like [`Regex::is_match`](struct.Regex.html#method.is_match).
+    pub fn is_match(&self, input: &[u8]) -> bool {
+        self.is_match_at(input, 0)
+    }
+
+    /// Returns the first position at which a match is found.
+    ///
+    /// This behaves like
+    /// [`Regex::shortest_match`](struct.Regex.html#method.shortest_match).
+    pub fn shortest_match(&self, input: &[u8]) -> Option<usize> {
+        self.shortest_match_at(input, 0)
+    }
+
+    /// Returns the start and end offset of the leftmost first match.
+    ///
+    /// This behaves like [`Regex::find`](struct.Regex.html#method.find).
+    pub fn find(&self, input: &[u8]) -> Option<(usize, usize)> {
+        self.find_at(input, 0)
+    }
+
+    /// Returns the same as `is_match`, but starts the search at the given
+    /// offset.
+    pub fn is_match_at(&self, input: &[u8], start: usize) -> bool {
+        self.shortest_match_at(input, start).is_some()
+    }
+
+    /// Returns the same as `shortest_match`, but starts the search at the
+    /// given offset.
+    pub fn shortest_match_at(
+        &self,
+        input: &[u8],
+        start: usize,
+    ) -> Option<usize> {
+        if let Some(ref ascii) = self.ascii {
+            if let Some(end) = find_ascii(ascii.forward(), input, start, true)
+            {
+                return end;
+            }
+        }
+        self.unicode().shortest_match_at(input, start)
+    }
+
+    /// Returns the same as `find`, but starts the search at the given
+    /// offset.
+    pub fn find_at(
+        &self,
+        input: &[u8],
+        start: usize,
+    ) -> Option<(usize, usize)> {
+        if let Some(ref ascii) = self.ascii {
+            if let Some(end) = find_ascii(ascii.forward(), input, start, false)
+            {
+                // The forward search only read ASCII bytes, and the reverse
+                // search never reads beyond the bytes read by the forward
+                // search.
+                return end
+                    .map(|end| (ascii.find_start(input, start, end), end));
+            }
+        }
+        self.unicode().find_at(input, start)
+    }
+
+    /// Returns an iterator over all non-overlapping leftmost first matches
+    /// in the given bytes.
+    ///
+    /// This behaves like
+    /// [`Regex::find_iter`](struct.Regex.html#method.find_iter).
+    pub fn find_iter<'r, 't>(
+        &'r self,
+        input: &'t [u8],
+    ) -> LiteMatches<'r, 't> {
+        LiteMatches { re: self, text: input, last_end: 0, last_match: None }
+    }
+
+    /// Returns true if and only if the full DFAs for this regex have been
+    /// built, either because a search encountered non-ASCII text or because
+    /// the pattern requires Unicode mode.
+    pub fn is_unicode_built(&self) -> bool {
+        match self.built() {
+            Some(&Unicode::Regex(_)) => true,
+            Some(&Unicode::NFA(..)) | None => false,
+        }
+    }
+
+    /// Build the full DFAs for this regex, if they haven't been built yet.
+    ///
+    /// This returns the error that prevented building them, if any, in
+    /// which case searches that read non-ASCII text simulate the pattern's
+    /// NFA instead. Since the pattern is checked when this regex is built,
+    /// this can only fail if the DFAs are too big.
+    pub fn build_unicode(&self) -> Result<()> {
+        match *self.unicode() {
+            Unicode::Regex(_) => Ok(()),
+            Unicode::NFA(_, ref err) => Err(err.clone()),
+        }
+    }
+
+    /// Returns what searches that read non-ASCII text use, building the full
+    /// DFAs if they haven't been built yet.
+    fn unicode(&self) -> &Unicode {
+        if let Some(unicode) = self.built() {
+            return unicode;
+        }
+        let mut nfa = self.nfa.lock().unwrap();
+        match nfa.take() {
+            // Another thread built it while this one waited for the lock.
+            None => self.built().unwrap(),
+            Some(nfa) => match self.builder.build(&self.pattern) {
+                Ok(re) => self.publish(Unicode::Regex(re)),
+                Err(err) => self.publish(Unicode::NFA(PikeVM::new(nfa), err)),
+            },
+        }
+    }
+
+    /// Returns what searches that read non-ASCII text use, if it has been
+    /// built.
+    fn built(&self) -> Option<&Unicode> {
+        let unicode = self.unicode.load(Ordering::Acquire);
+        // It is never replaced once set, and is only freed when this regex
+        // is dropped, which can't happen while `self` is borrowed.
+        unsafe { unicode.as_ref() }
+    }
+
+    /// Set what searches that read non-ASCII text use. This must be called
+    /// at most once, while holding the `nfa` lock.
+    fn publish(&self, unicode: Unicode) -> &Unicode {
+        let unicode = Box::into_raw(Box::new(unicode));
+        self.unicode.store(unicode, Ordering::Release);
+        unsafe { &*unicode }
+    }
+}
+
+impl Unicode {
+    fn shortest_match_at(&self, input: &[u8], start: usize) -> Option<usize> {
+        match *self {
+            Unicode::Regex(ref re) => re.shortest_match_at(input, start),
+            Unicode::NFA(ref pikevm, _) => {
+                pikevm.find_at(input, start, true).map(|m| m.1)
+            }
+        }
+    }
+
+    fn find_at(&self, input: &[u8], start: usize) -> Option<(usize, usize)> {
+        match *self {
+            Unicode::Regex(ref re) => re.find_at(input, start),
+            Unicode::NFA(ref pikevm, _) => pikevm.find_at(input, start, false),
+        }
+    }
+}
+
+/// An iterator over all non-overlapping matches of a
+/// [`LiteRegex`](struct.LiteRegex.html).
+///
+/// The iterator yields a `(usize, usize)` value until no more matches could be
+/// found, in the same way as [`Matches`](struct.Matches.html).
+#[derive(Clone, Debug)]
+pub struct LiteMatches<'r, 't> {
+    re: &'r LiteRegex,
+    text: &'t [u8],
+    last_end: usize,
+    last_match: Option<usize>,
+}
+
+impl<'r, 't> Iterator for LiteMatches<'r, 't> {
+    type Item = (usize, usize);
+
+    fn next(&mut self) -> Option<(usize, usize)> {
+        if self.last_end > self.text.len() {
+            return None;
+        }
+        let (s, e) = match self.re.find_at(self.text, self.last_end) {
+            None => return None,
+            Some((s, e)) => (s, e),
+        };
+        if s == e {
+            // See the corresponding comment in `Matches`.
+            self.last_end = e + 1;
+            if Some(e) == self.last_match {
+                return self.next();
+            }
+        } else {
+            self.last_end = e;
+        }
+        self.last_match = Some(e);
+        Some((s, e))
+    }
+}
+
+/// Run a forward search with an ASCII-only DFA, stopping at the first match
+/// if `earliest` is set, or otherwise at the end of the leftmost first
+/// match.
+///
+/// If the search would need to read a non-ASCII byte to determine its
+/// result, then `None` is returned. Otherwise, the result is the same as the
+/// result of the corresponding search with a Unicode-aware DFA.
+fn find_ascii<D: DFA>(
+    dfa: &D,
+    bytes: &[u8],
+    start: usize,
+    earliest: bool,
+) -> Option<Option<usize>> {
+    if dfa.is_anchored() && start > 0 {
+        return Some(None);
+    }
+    let mut state = dfa.start_state();
+    let mut last_match = if dfa.is_dead_state(state) {
+        return Some(None);
+    } else if dfa.is_match_state(state) {
+        Some(start)
+    } else {
+        None
+    };
+    if earliest && last_match.is_some() {
+        return Some(last_match);
+    }
+    for (i, &b) in bytes[start..].iter().enumerate() {
+        if b > 0x7F {
+            return None;
+        }
+        state = unsafe { dfa.next_state_unchecked(state, b) };
+        if dfa.is_match_or_dead_state(state) {
+            if dfa.is_dead_state(state) {
+                return Some(last_match);
+            }
+            last_match = Some(start + i + 1);
+            if earliest {
+                return Some(last_match);
+            }
+        }
+    }
+    Some(last_match)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::Unicode;
+    use error::Error;
+    use nfa::PikeVM;
+    use regex::RegexBuilder;
+
+    #[test]
+    fn same_as_regex() {
+        let patterns = &[
+            r"\w+",
+            r"\d+\s*\w",
+            r"(?i)k+",
+            r"[^a]+",
+            r".",
+            r"a|é",
+            r"\pL+",
+            r"",
+        ];
+        let haystacks: &[&[u8]] = &[
+            b"",
+            b"abc 123 kk",
+            "ab é 12 \u{212A}K 𝛃".as_bytes(),
+            "\u{212A}".as_bytes(),
+            b"\xFFab",
+        ];
+        for &pattern in patterns {
+            let mut builder = RegexBuilder::new();
+            builder.allow_invalid_utf8(true);
+            let re = builder.build(pattern).unwrap();
+            for &haystack in haystacks {
+                let lite = builder.build_lite(pattern).unwrap();
+                let expected: Vec<_> = re.find_iter(haystack).collect();
+                let got: Vec<_> = lite.find_iter(haystack).collect();
+                assert_eq!(expected, got, "{:?} on {:?}", pattern, haystack);
+                for at in 0..haystack.len() {
+                    assert_eq!(
+                        re.shortest_match_at(haystack, at),
+                        lite.shortest_match_at(haystack, at),
+                    );
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn unicode_is_built_lazily() {
+        let lite = RegexBuilder::new().build_lite(r"\w+").unwrap();
+        assert!(!lite.is_unicode_built());
+        assert!(lite.is_match(b"foo"));
+        assert!(!lite.is_unicode_built());
+        // A match found before any non-ASCII byte is read is final.
+        assert_eq!(Some(1), lite.shortest_match("a☃".as_bytes()));
+        assert!(!lite.is_unicode_built());
+        assert_eq!(Some((0, 5)), lite.find("fooé".as_bytes()));
+        assert!(lite.is_unicode_built());
+
+        let lite = RegexBuilder::new().build_lite(r"\w+").unwrap();
+        assert!(lite.build_unicode().is_ok());
+        assert!(lite.is_unicode_built());
+
+        let lite = RegexBuilder::new().build_lite(r"\pL").unwrap();
+        assert!(lite.is_unicode_built());
+    }
+
+    #[test]
+    fn falls_back_to_nfa() {
+        let re = RegexBuilder::new().build(r"\w+").unwrap();
+        let lite = RegexBuilder::new().build_lite(r"\w+").unwrap();
+        // Pretend that the full DFAs were too big to build.
+        let nfa = lite.nfa.lock().unwrap().take().unwrap();
+        let err = Error::state_id_overflow(0);
+        lite.publish(Unicode::NFA(PikeVM::new(nfa), err));
+        assert!(lite.build_unicode().is_err());
+        assert!(!lite.is_unicode_built());
+
+        let haystack = "ab é 12 \u{212A}K 𝛃".as_bytes();
+        let expected: Vec<_> = re.find_iter(haystack).collect();
+        let got: Vec<_> = lite.find_iter(haystack).collect();
+        assert_eq!(expected, got);
+        let expected = re.shortest_match_at(haystack, 3);
+        assert_eq!(expected, lite.shortest_match_at(haystack, 3));
+    }
+
+    #[test]
+    fn syntax_errors_are_reported() {
+        assert!(RegexBuilder::new().build_lite(r"(?-u:\xFF)").is_err());
+        assert!(RegexBuilder::new().build_lite(r"(").is_err());
+    }
+}
@@ -76,7 +76,10 @@ impl<'a, S: StateID> Minimizer<'a, S> {
     pub fn new(dfa: &'a mut DFARepr<S>) -> Minimizer<'a, S> {
         let in_transitions = Minimizer::incoming_transitions(dfa);
         let partitions = Minimizer::initial_partitions(dfa);
-        let waiting = vec![partitions[0].clone()];
+        // Every initial partition but the largest one needs to be refined
+        // against. With only match and non-match states, that's just the
+        // smaller of the two.
+        let waiting = partitions[..partitions.len() - 1].to_vec();
 
         Minimizer { dfa, in_transitions, partitions, waiting }
     }
@@ -181,6 +184,15 @@ impl<'a, S: StateID> Minimizer<'a, S> {
         self.dfa.set_start_state(
             minimal_ids[state_to_part[old_start.to_usize()].to_usize()],
         );
+        // Do the same for the anchored start state, if this (unanchored) DFA
+        // has one.
+        if !self.dfa.is_anchored() {
+            if let Some(old_start) = self.dfa.anchored_start_state() {
+                let part = state_to_part[old_start.to_usize()];
+                let new_start = minimal_ids[part.to_usize()];
+                self.dfa.set_anchored_start_state(new_start);
+            }
+        }
 
         // In order to update the ID of the maximum match state, we need to
         // find the maximum ID among all of the match states in the minimized
@@ -222,9 +234,14 @@ impl<'a, S: StateID> Minimizer<'a, S> {
     fn initial_partitions(dfa: &DFARepr<S>) -> Vec<StateSet<S>> {
         let mut is_match = StateSet::empty();
         let mut no_match = StateSet::empty();
+        // The quit state must never be merged with the dead state, since
+        // searches report it differently.
+        let mut quit = StateSet::empty();
         for (id, _) in dfa.states() {
             if dfa.is_match_state(id) {
                 is_match.add(id);
+            } else if dfa.is_quit_state(id) {
+                quit.add(id);
             } else {
                 no_match.add(id);
             }
@@ -234,6 +251,9 @@ impl<'a, S: StateID> Minimizer<'a, S> {
         if !no_match.is_empty() {
             sets.push(no_match);
         }
+        if !quit.is_empty() {
+            sets.push(quit);
+        }
         sets.sort_by_key(|s| s.len());
         sets
     }
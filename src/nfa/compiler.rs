@@ -300,13 +300,16 @@ impl Compiler {
         let match_id = self.add_match();
         self.patch(start, compiled.start);
         self.patch(compiled.end, match_id);
-        self.finish(nfa);
+        // N.B. The end of the unanchored prefix can't be used as the anchored
+        // starting point, since it may be the `.*?` loop itself.
+        self.finish(nfa, compiled.start);
         Ok(())
     }
 
     /// Finishes the compilation process and populates the provide NFA with
-    /// the final graph.
-    fn finish(&self, nfa: &mut NFA) {
+    /// the final graph. `start_anchored` should be the (intermediate) ID of
+    /// the state at which the pattern itself begins.
+    fn finish(&self, nfa: &mut NFA, start_anchored: StateID) {
         let mut bstates = self.states.borrow_mut();
         let mut remap = self.remap.borrow_mut();
         remap.resize(bstates.len(), 0);
@@ -386,6 +389,7 @@ impl Compiler {
         }
         // The compiler always begins the NFA at the first state.
         nfa.start = remap[0];
+        nfa.start_anchored = remap[start_anchored];
         nfa.byte_classes = byteset.byte_classes();
     }
 
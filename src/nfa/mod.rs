@@ -2,9 +2,11 @@ use std::fmt;
 
 use classes::ByteClasses;
 pub use nfa::compiler::Builder;
+pub(crate) use nfa::pikevm::PikeVM;
 
 mod compiler;
 mod map;
+mod pikevm;
 mod range_trie;
 
 /// The representation for an NFA state identifier.
@@ -23,6 +25,10 @@ pub struct NFA {
     anchored: bool,
     /// The starting state of this NFA.
     start: StateID,
+    /// The starting state for anchored searches. For an anchored NFA, this is
+    /// always equivalent to `start`. For an unanchored NFA, this is the state
+    /// immediately following the unanchored `.*?` prefix.
+    start_anchored: StateID,
     /// The state list. This list is guaranteed to be indexable by the starting
     /// state ID, and it is also guaranteed to contain exactly one `Match`
     /// state.
@@ -47,6 +53,7 @@ impl NFA {
         NFA {
             anchored: false,
             start: 0,
+            start_anchored: 0,
             states: vec![State::Match],
             byte_classes: ByteClasses::empty(),
         }
@@ -57,6 +64,7 @@ impl NFA {
         NFA {
             anchored: false,
             start: 0,
+            start_anchored: 0,
             states: vec![State::Fail],
             byte_classes: ByteClasses::empty(),
         }
@@ -77,6 +85,12 @@ impl NFA {
         self.start
     }
 
+    /// Return the ID of the initial state of this NFA for anchored searches.
+    /// That is, this skips the unanchored prefix, if one exists.
+    pub fn start_anchored(&self) -> StateID {
+        self.start_anchored
+    }
+
     /// Return the NFA state corresponding to the given ID.
     pub fn state(&self, id: StateID) -> &State {
         &self.states[id]
@@ -93,7 +107,13 @@ impl NFA {
 impl fmt::Debug for NFA {
     fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
         for (i, state) in self.states.iter().enumerate() {
-            let status = if i == self.start { '>' } else { ' ' };
+            let status = if i == self.start {
+                '>'
+            } else if i == self.start_anchored {
+                '^'
+            } else {
+                ' '
+            };
             writeln!(f, "{}{:06}: {:?}", status, i, state)?;
         }
         Ok(())
@@ -0,0 +1,208 @@
+use std::mem;
+
+use nfa::{State, StateID, NFA};
+use sparse_set::SparseSet;
+
+/// A search routine that simulates an NFA directly, by tracking every NFA
+/// state it could be in at once.
+///
+/// This is much slower than searching with a DFA, but it requires nothing
+/// beyond the NFA itself, which is cheap to build. It reports precisely the
+/// same matches as a `Regex` built from the same NFA: the leftmost first
+/// match, with shortest match semantics available for early exits.
+#[derive(Clone, Debug)]
+pub(crate) struct PikeVM {
+    nfa: NFA,
+}
+
+/// The start of a thread that is still in the unanchored `.*?` prefix of an
+/// NFA, and therefore has not started a match yet.
+const PREFIX: usize = ::std::usize::MAX;
+
+/// The set of NFA states active at one position, in priority order, along
+/// with the offset at which the thread in each state started.
+#[derive(Debug)]
+struct Threads {
+    set: SparseSet,
+    starts: Vec<usize>,
+}
+
+impl Threads {
+    fn new(len: usize) -> Threads {
+        Threads { set: SparseSet::new(len), starts: vec![0; len] }
+    }
+}
+
+impl PikeVM {
+    pub fn new(nfa: NFA) -> PikeVM {
+        PikeVM { nfa }
+    }
+
+    /// Search `bytes` starting at `start`, and return the start and end of
+    /// the leftmost first match.
+    ///
+    /// When `earliest` is true, this instead returns as soon as any match is
+    /// found. The end of that match is the same as the one reported by
+    /// `DFA::shortest_match_at`, but its start is not meaningful.
+    pub fn find_at(
+        &self,
+        bytes: &[u8],
+        start: usize,
+        earliest: bool,
+    ) -> Option<(usize, usize)> {
+        if self.nfa.is_anchored() && start > 0 {
+            return None;
+        }
+        let mut clist = Threads::new(self.nfa.len());
+        let mut nlist = Threads::new(self.nfa.len());
+        let mut stack = vec![];
+        let mut matched = None;
+        let mut at = start;
+        // Unanchored searches start in the NFA's own `.*?` prefix, which only
+        // permits matches to start where the DFA would permit them to start,
+        // such as at the beginning of a UTF-8 encoded codepoint. Once a match
+        // is found, the prefix is cut along with every other thread of lower
+        // priority, so no match starting later is considered.
+        self.add(&mut clist, &mut stack, self.nfa.start(), PREFIX, start);
+        loop {
+            if clist.set.len() == 0 {
+                break;
+            }
+            for &id in &clist.set {
+                let thread_start = clist.starts[id];
+                let next = match *self.nfa.state(id) {
+                    State::Match => {
+                        matched = Some((thread_start, at));
+                        if earliest {
+                            return matched;
+                        }
+                        // Every thread after this one has a lower priority,
+                        // so none of them can produce the leftmost first
+                        // match.
+                        break;
+                    }
+                    State::Range { ref range } => match bytes.get(at) {
+                        Some(&b) if range.start <= b && b <= range.end => {
+                            range.next
+                        }
+                        _ => continue,
+                    },
+                    State::Sparse { ref ranges } => {
+                        let b = match bytes.get(at) {
+                            Some(&b) => b,
+                            None => continue,
+                        };
+                        match ranges
+                            .iter()
+                            .find(|r| r.start <= b && b <= r.end)
+                        {
+                            Some(r) => r.next,
+                            None => continue,
+                        }
+                    }
+                    State::Union { .. } | State::Fail => continue,
+                };
+                self.add(&mut nlist, &mut stack, next, thread_start, at + 1);
+            }
+            if at >= bytes.len() {
+                break;
+            }
+            at += 1;
+            mem::swap(&mut clist, &mut nlist);
+            nlist.set.clear();
+        }
+        matched
+    }
+
+    /// Add the given state and every state reachable from it through epsilon
+    /// transitions to `list`, in priority order, as threads that started at
+    /// `start`. States already in `list` belong to a higher priority thread
+    /// and are left alone.
+    ///
+    /// A thread in the unanchored prefix has a start of `PREFIX`. It starts
+    /// at `at`, the position of the states being added, once it leaves the
+    /// prefix for the pattern itself.
+    fn add(
+        &self,
+        list: &mut Threads,
+        stack: &mut Vec<(StateID, usize)>,
+        id: StateID,
+        start: usize,
+        at: usize,
+    ) {
+        stack.push((id, start));
+        while let Some((id, mut start)) = stack.pop() {
+            if list.set.contains(id) {
+                continue;
+            }
+            if start == PREFIX && id == self.nfa.start_anchored() {
+                start = at;
+            }
+            list.set.insert(id);
+            list.starts[id] = start;
+            if let State::Union { ref alternates } = *self.nfa.state(id) {
+                stack.extend(alternates.iter().rev().map(|&id| (id, start)));
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::PikeVM;
+    use dense;
+    use regex::RegexBuilder;
+
+    #[test]
+    fn same_as_regex() {
+        let patterns = &[
+            r"a+",
+            r"[0-9]+|[a-z]+",
+            r"Sam|Samwise",
+            r"Samwise|Sam",
+            r"a*",
+            r"(?:ab|a)(?:bc|c)?",
+            r"\w+@\w+",
+            r"☃|snow",
+            r"",
+        ];
+        let haystacks: &[&[u8]] = &[
+            b"",
+            b"aaa",
+            b"xx12ab",
+            b"Samwise",
+            b"zabc abc",
+            b"me@example.com",
+            "a ☃ snow".as_bytes(),
+        ];
+        for &anchored in &[false, true] {
+            for &pattern in patterns {
+                let re = RegexBuilder::new()
+                    .anchored(anchored)
+                    .build(pattern)
+                    .unwrap();
+                let nfa = dense::Builder::new()
+                    .anchored(anchored)
+                    .build_nfa(pattern)
+                    .unwrap();
+                let vm = PikeVM::new(nfa);
+                for &haystack in haystacks {
+                    for at in 0..haystack.len() + 1 {
+                        assert_eq!(
+                            re.find_at(haystack, at),
+                            vm.find_at(haystack, at, false),
+                            "{:?} on {:?} at {}",
+                            pattern,
+                            haystack,
+                            at,
+                        );
+                        assert_eq!(
+                            re.shortest_match_at(haystack, at),
+                            vm.find_at(haystack, at, true).map(|m| m.1),
+                        );
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,589 @@
+use std::collections::HashMap;
+use std::mem;
+
+use dense::DenseDFA;
+use dfa::DFA;
+use error::{Error, Result};
+use state_id::StateID;
+use stride2::{Stride2DFA, DEFAULT_STRIDE2_BUDGET};
+
+/// The number of entries in each row of a nibble DFA.
+const NIBBLE_LEN: usize = 16;
+
+/// The default size, in bytes, of a dense DFA above which
+/// [`CompactDFA::new`](enum.CompactDFA.html#method.new) uses a nibble DFA
+/// instead.
+pub const DEFAULT_NIBBLE_THRESHOLD: usize = 1 << 20;
+
+/// A DFA that follows each byte of a haystack in two steps of 4 bits each.
+///
+/// Every state of a dense DFA has a row with one transition for each of its
+/// equivalence classes. For big Unicode-aware patterns, that is usually
+/// more than 100 transitions per state, and a DFA with thousands of states
+/// quickly takes tens of megabytes. A nibble DFA instead gives each state a
+/// row of 16 transitions, one for each value of the high 4 bits of a byte.
+/// Each of those leads to an intermediate row of 16 transitions, one for
+/// each value of the low 4 bits, that finally leads to the next state.
+///
+/// Intermediate rows are shared by every state that has them. Most states
+/// of such DFAs have the same transitions on large ranges of bytes, such as
+/// every UTF-8 continuation byte, so there are usually about as many
+/// distinct intermediate rows as states. For a DFA with more than 100
+/// equivalence classes, a nibble DFA is then several times smaller than the
+/// corresponding dense DFA.
+///
+/// Following a byte takes two table lookups instead of one, and neither of
+/// them branches. A nibble DFA is therefore somewhat slower to search than
+/// a dense DFA, but much faster than a sparse DFA.
+///
+/// A nibble DFA is built from a dense DFA via
+/// [`NibbleDFA::from_dense`](#method.from_dense), and reports precisely the
+/// same matches. [`CompactDFA`](enum.CompactDFA.html) picks between the two
+/// based on the size of the dense DFA.
+///
+/// # Example
+///
+/// ```
+/// use regex_automata::{DenseDFA, NibbleDFA, DFA};
+///
+/// # fn example() -> Result<(), regex_automata::Error> {
+/// let dense = DenseDFA::new(r"\p{L}{3}\s+\p{N}+")?;
+/// let nibble = NibbleDFA::from_dense(&dense)?;
+/// assert!(nibble.memory_usage() < dense.memory_usage());
+/// assert_eq!(Some(8), nibble.find("Ünï 42".as_bytes()));
+/// # Ok(()) }; example().unwrap()
+/// ```
+#[derive(Clone, Debug)]
+pub struct NibbleDFA<S: StateID = usize> {
+    /// Rows of 16 transitions. The first `state_count` rows belong to the
+    /// states of the DFA, in the same order as the states of the dense DFA
+    /// it was built from. They are followed by the intermediate rows.
+    ///
+    /// Identifiers are premultiplied, i.e., the identifier of a row is the
+    /// offset of its first transition. The dead state's row leads to itself
+    /// on every nibble, so it doubles as the intermediate row in which every
+    /// low nibble leads to the dead state.
+    trans: Vec<S>,
+    start: S,
+    anchored_start: Option<S>,
+    max_match: S,
+    /// The quit state of the dense DFA, or the dead state if it has none.
+    quit: S,
+    state_count: usize,
+    anchored: bool,
+}
+
+impl<S: StateID> NibbleDFA<S> {
+    /// Build a nibble DFA that reports the same matches as the given dense
+    /// DFA.
+    ///
+    /// If the identifiers of the nibble DFA's rows cannot be represented by
+    /// `S`, then this returns an error.
+    pub fn from_dense<T: AsRef<[S]>>(
+        dense: &DenseDFA<T, S>,
+    ) -> Result<NibbleDFA<S>> {
+        let repr = dense.repr();
+        let state_count = repr.state_count();
+        let index = |id: S| repr.state_id_to_index(id);
+
+        // Rows are built with state indices, and only premultiplied once the
+        // number of rows is known.
+        let mut trans = vec![0; state_count * NIBBLE_LEN];
+        let mut rows: HashMap<[usize; NIBBLE_LEN], usize> = HashMap::new();
+        rows.insert([0; NIBBLE_LEN], 0);
+        let quit = index(repr.quit_state());
+        let mut max_match = quit;
+        for (id, _) in repr.states() {
+            let i = index(id);
+            if dense.is_match_state(id) {
+                max_match = i;
+            }
+            for hi in 0..NIBBLE_LEN {
+                let mut row = [0; NIBBLE_LEN];
+                for (lo, next) in row.iter_mut().enumerate() {
+                    let b = (hi << 4 | lo) as u8;
+                    *next = index(dense.next_state(id, b));
+                }
+                let next_row = rows.len() + state_count - 1;
+                let row_index = *rows.entry(row).or_insert(next_row);
+                if row_index == next_row {
+                    trans.extend_from_slice(&row);
+                }
+                trans[i * NIBBLE_LEN + hi] = row_index;
+            }
+        }
+
+        let max_id = trans.len() - NIBBLE_LEN;
+        if max_id > S::max_id() {
+            return Err(Error::premultiply_overflow(S::max_id(), max_id));
+        }
+        let id = |i: usize| S::from_usize(i * NIBBLE_LEN);
+        Ok(NibbleDFA {
+            trans: trans.into_iter().map(id).collect(),
+            start: id(index(dense.start_state())),
+            anchored_start: dense.anchored_start_state().map(|s| id(index(s))),
+            max_match: id(max_match),
+            quit: id(quit),
+            state_count,
+            anchored: dense.is_anchored(),
+        })
+    }
+
+    /// Returns the number of states in this DFA, not counting its
+    /// intermediate rows.
+    pub fn state_count(&self) -> usize {
+        self.state_count
+    }
+
+    /// Returns the total number of rows in this DFA, including the rows of
+    /// its states and its intermediate rows.
+    pub fn row_count(&self) -> usize {
+        self.trans.len() / NIBBLE_LEN
+    }
+
+    /// Returns the memory usage, in bytes, of this DFA's transitions.
+    pub fn memory_usage(&self) -> usize {
+        self.trans.len() * mem::size_of::<S>()
+    }
+}
+
+impl<S: StateID> DFA for NibbleDFA<S> {
+    type ID = S;
+
+    #[inline]
+    fn start_state(&self) -> S {
+        self.start
+    }
+
+    #[inline]
+    fn is_match_state(&self, id: S) -> bool {
+        id <= self.max_match && id > self.quit
+    }
+
+    #[inline]
+    fn is_dead_state(&self, id: S) -> bool {
+        id <= self.quit
+    }
+
+    #[inline]
+    fn is_match_or_dead_state(&self, id: S) -> bool {
+        id <= self.max_match
+    }
+
+    #[inline]
+    fn is_anchored(&self) -> bool {
+        self.anchored
+    }
+
+    #[inline]
+    fn anchored_start_state(&self) -> Option<S> {
+        if self.anchored {
+            Some(self.start)
+        } else {
+            self.anchored_start
+        }
+    }
+
+    #[inline]
+    fn next_state(&self, current: S, input: u8) -> S {
+        let mid = self.trans[current.to_usize() + (input >> 4) as usize];
+        self.trans[mid.to_usize() + (input & 0xF) as usize]
+    }
+
+    #[inline]
+    unsafe fn next_state_unchecked(&self, current: S, input: u8) -> S {
+        let o = current.to_usize() + (input >> 4) as usize;
+        let mid = *self.trans.get_unchecked(o);
+        *self.trans.get_unchecked(mid.to_usize() + (input & 0xF) as usize)
+    }
+}
+
+/// A DFA whose representation is chosen from the size of its dense DFA.
+///
+/// This is built by
+/// [`RegexBuilder::build_compact`](struct.RegexBuilder.html#method.build_compact)
+/// for each of a regex's DFAs, or directly from a dense DFA with
+/// [`CompactDFA::new`](#method.new).
+///
+/// * A DFA whose pair table would fit within a budget is converted to a
+///   [`Stride2DFA`](struct.Stride2DFA.html), which searches about twice as
+///   fast. Such DFAs are tiny, so this costs little memory.
+/// * A DFA whose dense representation uses more memory than a threshold is
+///   converted to a [`NibbleDFA`](struct.NibbleDFA.html), which is usually
+///   much smaller.
+/// * Every other DFA stays dense.
+///
+/// # Example
+///
+/// ```
+/// use regex_automata::{CompactDFA, DenseDFA, DFA};
+///
+/// # fn example() -> Result<(), regex_automata::Error> {
+/// let dfa = CompactDFA::new(DenseDFA::new(r"[0-9]+")?);
+/// assert!(dfa.is_stride2());
+/// let dfa = CompactDFA::with_threshold(DenseDFA::new(r"\p{L}+")?, 0);
+/// assert!(dfa.is_nibble());
+/// assert_eq!(Some(5), dfa.find("Ünï 42".as_bytes()));
+/// # Ok(()) }; example().unwrap()
+/// ```
+#[derive(Clone, Debug)]
+pub enum CompactDFA<S: StateID = usize> {
+    /// A DFA that is kept dense.
+    Dense(DenseDFA<Vec<S>, S>),
+    /// A DFA whose dense representation was too big.
+    Nibble(NibbleDFA<S>),
+    /// A DFA small enough to follow two bytes at a time.
+    Stride2(Stride2DFA<S>),
+}
+
+impl<S: StateID> CompactDFA<S> {
+    /// Choose a representation for the given dense DFA with the default
+    /// stride-2 budget of 16,384 pair table entries and the default nibble
+    /// threshold of 1MB.
+    pub fn new(dense: DenseDFA<Vec<S>, S>) -> CompactDFA<S> {
+        CompactDFA::with_threshold(dense, DEFAULT_NIBBLE_THRESHOLD)
+    }
+
+    /// Choose a representation for the given dense DFA with the default
+    /// stride-2 budget, using a nibble DFA if the dense DFA uses more than
+    /// `threshold` bytes of memory.
+    pub fn with_threshold(
+        dense: DenseDFA<Vec<S>, S>,
+        threshold: usize,
+    ) -> CompactDFA<S> {
+        CompactDFA::with_limits(dense, DEFAULT_STRIDE2_BUDGET, threshold)
+    }
+
+    /// Choose a representation for the given dense DFA.
+    ///
+    /// A stride-2 DFA is used if `alphabet_len^2 * state_count` is at most
+    /// `stride2_budget`. Otherwise, a nibble DFA is used if the dense DFA
+    /// uses more than `nibble_threshold` bytes of memory. The dense DFA is
+    /// kept if neither applies, if the nibble DFA would not be smaller, or
+    /// if the other representation's identifiers cannot be represented by
+    /// `S`.
+    pub fn with_limits(
+        dense: DenseDFA<Vec<S>, S>,
+        stride2_budget: usize,
+        nibble_threshold: usize,
+    ) -> CompactDFA<S> {
+        if let Some(dfa) = Stride2DFA::from_dense(&dense, stride2_budget) {
+            return CompactDFA::Stride2(dfa);
+        }
+        if dense.memory_usage() <= nibble_threshold {
+            return CompactDFA::Dense(dense);
+        }
+        match NibbleDFA::from_dense(&dense) {
+            Ok(nibble) if nibble.memory_usage() < dense.memory_usage() => {
+                CompactDFA::Nibble(nibble)
+            }
+            _ => CompactDFA::Dense(dense),
+        }
+    }
+
+    /// Returns true if and only if this is a nibble DFA.
+    pub fn is_nibble(&self) -> bool {
+        match *self {
+            CompactDFA::Nibble(_) => true,
+            CompactDFA::Dense(_) | CompactDFA::Stride2(_) => false,
+        }
+    }
+
+    /// Returns true if and only if this is a stride-2 DFA.
+    pub fn is_stride2(&self) -> bool {
+        match *self {
+            CompactDFA::Stride2(_) => true,
+            CompactDFA::Dense(_) | CompactDFA::Nibble(_) => false,
+        }
+    }
+
+    /// Returns the memory usage, in bytes, of this DFA.
+    pub fn memory_usage(&self) -> usize {
+        match *self {
+            CompactDFA::Dense(ref d) => d.memory_usage(),
+            CompactDFA::Nibble(ref d) => d.memory_usage(),
+            CompactDFA::Stride2(ref d) => d.memory_usage(),
+        }
+    }
+}
+
+impl<S: StateID> DFA for CompactDFA<S> {
+    type ID = S;
+
+    #[inline]
+    fn start_state(&self) -> S {
+        match *self {
+            CompactDFA::Dense(ref d) => d.start_state(),
+            CompactDFA::Nibble(ref d) => d.start_state(),
+            CompactDFA::Stride2(ref d) => d.start_state(),
+        }
+    }
+
+    #[inline]
+    fn is_match_state(&self, id: S) -> bool {
+        match *self {
+            CompactDFA::Dense(ref d) => d.is_match_state(id),
+            CompactDFA::Nibble(ref d) => d.is_match_state(id),
+            CompactDFA::Stride2(ref d) => d.is_match_state(id),
+        }
+    }
+
+    #[inline]
+    fn is_dead_state(&self, id: S) -> bool {
+        match *self {
+            CompactDFA::Dense(ref d) => d.is_dead_state(id),
+            CompactDFA::Nibble(ref d) => d.is_dead_state(id),
+            CompactDFA::Stride2(ref d) => d.is_dead_state(id),
+        }
+    }
+
+    #[inline]
+    fn is_match_or_dead_state(&self, id: S) -> bool {
+        match *self {
+            CompactDFA::Dense(ref d) => d.is_match_or_dead_state(id),
+            CompactDFA::Nibble(ref d) => d.is_match_or_dead_state(id),
+            CompactDFA::Stride2(ref d) => d.is_match_or_dead_state(id),
+        }
+    }
+
+    #[inline]
+    fn is_anchored(&self) -> bool {
+        match *self {
+            CompactDFA::Dense(ref d) => d.is_anchored(),
+            CompactDFA::Nibble(ref d) => d.is_anchored(),
+            CompactDFA::Stride2(ref d) => d.is_anchored(),
+        }
+    }
+
+    #[inline]
+    fn anchored_start_state(&self) -> Option<S> {
+        match *self {
+            CompactDFA::Dense(ref d) => d.anchored_start_state(),
+            CompactDFA::Nibble(ref d) => d.anchored_start_state(),
+            CompactDFA::Stride2(ref d) => d.anchored_start_state(),
+        }
+    }
+
+    #[inline]
+    fn next_state(&self, current: S, input: u8) -> S {
+        match *self {
+            CompactDFA::Dense(ref d) => d.next_state(current, input),
+            CompactDFA::Nibble(ref d) => d.next_state(current, input),
+            CompactDFA::Stride2(ref d) => d.next_state(current, input),
+        }
+    }
+
+    #[inline]
+    unsafe fn next_state_unchecked(&self, current: S, input: u8) -> S {
+        match *self {
+            CompactDFA::Dense(ref d) => d.next_state_unchecked(current, input),
+            CompactDFA::Nibble(ref d) => {
+                d.next_state_unchecked(current, input)
+            }
+            CompactDFA::Stride2(ref d) => {
+                d.next_state_unchecked(current, input)
+            }
+        }
+    }
+
+    // As with dense DFAs, the following methods are specialized so that the
+    // case analysis happens once per search instead of once per byte. This
+    // also lets stride-2 DFAs use their own search loops.
+
+    #[inline]
+    fn is_match_at(&self, bytes: &[u8], start: usize) -> bool {
+        match *self {
+            CompactDFA::Dense(ref d) => d.is_match_at(bytes, start),
+            CompactDFA::Nibble(ref d) => d.is_match_at(bytes, start),
+            CompactDFA::Stride2(ref d) => d.is_match_at(bytes, start),
+        }
+    }
+
+    #[inline]
+    fn shortest_match_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        match *self {
+            CompactDFA::Dense(ref d) => d.shortest_match_at(bytes, start),
+            CompactDFA::Nibble(ref d) => d.shortest_match_at(bytes, start),
+            CompactDFA::Stride2(ref d) => d.shortest_match_at(bytes, start),
+        }
+    }
+
+    #[inline]
+    fn find_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        match *self {
+            CompactDFA::Dense(ref d) => d.find_at(bytes, start),
+            CompactDFA::Nibble(ref d) => d.find_at(bytes, start),
+            CompactDFA::Stride2(ref d) => d.find_at(bytes, start),
+        }
+    }
+
+    #[inline]
+    fn rfind_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        match *self {
+            CompactDFA::Dense(ref d) => d.rfind_at(bytes, start),
+            CompactDFA::Nibble(ref d) => d.rfind_at(bytes, start),
+            CompactDFA::Stride2(ref d) => d.rfind_at(bytes, start),
+        }
+    }
+
+    #[inline]
+    fn is_match_anchored_at(&self, bytes: &[u8], start: usize) -> bool {
+        match *self {
+            CompactDFA::Dense(ref d) => d.is_match_anchored_at(bytes, start),
+            CompactDFA::Nibble(ref d) => d.is_match_anchored_at(bytes, start),
+            CompactDFA::Stride2(ref d) => d.is_match_anchored_at(bytes, start),
+        }
+    }
+
+    #[inline]
+    fn shortest_match_anchored_at(
+        &self,
+        bytes: &[u8],
+        start: usize,
+    ) -> Option<usize> {
+        match *self {
+            CompactDFA::Dense(ref d) => {
+                d.shortest_match_anchored_at(bytes, start)
+            }
+            CompactDFA::Nibble(ref d) => {
+                d.shortest_match_anchored_at(bytes, start)
+            }
+            CompactDFA::Stride2(ref d) => {
+                d.shortest_match_anchored_at(bytes, start)
+            }
+        }
+    }
+
+    #[inline]
+    fn find_anchored_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        match *self {
+            CompactDFA::Dense(ref d) => d.find_anchored_at(bytes, start),
+            CompactDFA::Nibble(ref d) => d.find_anchored_at(bytes, start),
+            CompactDFA::Stride2(ref d) => d.find_anchored_at(bytes, start),
+        }
+    }
+
+    #[inline]
+    fn rfind_anchored_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        match *self {
+            CompactDFA::Dense(ref d) => d.rfind_anchored_at(bytes, start),
+            CompactDFA::Nibble(ref d) => d.rfind_anchored_at(bytes, start),
+            CompactDFA::Stride2(ref d) => d.rfind_anchored_at(bytes, start),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{CompactDFA, NibbleDFA};
+    use dense::{self, DenseDFA};
+    use dfa::DFA;
+    use regex::RegexBuilder;
+
+    #[test]
+    fn same_as_dense() {
+        let patterns = &[r"[0-9]+", r"\w+@\w+", r"☃+|snow", r"a*", r""];
+        let haystacks: &[&[u8]] = &[
+            b"",
+            b"abc 123",
+            b"me@example",
+            "snow☃☃ x".as_bytes(),
+            b"\xFF\x80abc",
+        ];
+        for &premultiply in &[false, true] {
+            for &anchored in &[false, true] {
+                for &pattern in patterns {
+                    let dense: DenseDFA<Vec<u32>, u32> = dense::Builder::new()
+                        .premultiply(premultiply)
+                        .anchored(anchored)
+                        .dual_start(true)
+                        .build_with_size(pattern)
+                        .unwrap();
+                    let nibble = NibbleDFA::from_dense(&dense).unwrap();
+                    assert_eq!(dense.state_count(), nibble.state_count());
+                    for &haystack in haystacks {
+                        for at in 0..haystack.len() + 1 {
+                            assert_eq!(
+                                dense.find_at(haystack, at),
+                                nibble.find_at(haystack, at),
+                                "{:?} on {:?} at {}",
+                                pattern,
+                                haystack,
+                                at,
+                            );
+                            assert_eq!(
+                                dense.rfind_at(haystack, at),
+                                nibble.rfind_at(haystack, at),
+                            );
+                            assert_eq!(
+                                dense.find_anchored_at(haystack, at),
+                                nibble.find_anchored_at(haystack, at),
+                            );
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn compact_picks_by_size() {
+        let pattern = r"\p{L}{3,}\s+\p{N}+";
+        let dense: DenseDFA<Vec<u32>, u32> =
+            dense::Builder::new().build_with_size(pattern).unwrap();
+        let small =
+            CompactDFA::with_threshold(dense.clone(), ::std::usize::MAX);
+        let big = CompactDFA::with_threshold(dense.clone(), 0);
+        assert!(!small.is_nibble());
+        assert!(big.is_nibble());
+        assert!(big.memory_usage() * 3 < small.memory_usage());
+
+        let haystack = "Straße 123 ünd ΣΣΣ\t٤٢".as_bytes();
+        for at in 0..haystack.len() + 1 {
+            assert_eq!(small.find_at(haystack, at), big.find_at(haystack, at));
+        }
+    }
+
+    #[test]
+    fn compact_uses_stride2_for_tiny_dfas() {
+        let dense = DenseDFA::new(r"[0-9]+x").unwrap();
+        let tiny = CompactDFA::new(dense.clone());
+        let dense = CompactDFA::with_limits(dense, 0, ::std::usize::MAX);
+        assert!(tiny.is_stride2());
+        assert!(!dense.is_stride2() && !dense.is_nibble());
+        let haystack = b"a1x 22 333x";
+        for at in 0..haystack.len() + 1 {
+            assert_eq!(
+                dense.find_at(haystack, at),
+                tiny.find_at(haystack, at)
+            );
+            assert_eq!(
+                dense.rfind_at(haystack, at),
+                tiny.rfind_at(haystack, at)
+            );
+        }
+    }
+
+    #[test]
+    fn build_compact_keeps_reverse_dfas_out_of_stride2() {
+        let re = RegexBuilder::new()
+            .reverse_unanchored(true)
+            .build_compact(r"[0-9]+x")
+            .unwrap();
+        assert!(re.forward().is_stride2());
+        assert!(!re.reverse().is_stride2());
+        assert!(!re.reverse_unanchored().unwrap().is_stride2());
+        assert_eq!(Some((1, 3)), re.find(b"a1x 22 333x"));
+    }
+
+    #[test]
+    fn errors_when_rows_overflow() {
+        let dense: DenseDFA<Vec<u8>, u8> = dense::Builder::new()
+            .premultiply(false)
+            .build_with_size(r"[a-z]{20}")
+            .unwrap();
+        assert!(NibbleDFA::from_dense(&dense).is_err());
+        let dfa = CompactDFA::with_threshold(dense, 0);
+        assert!(!dfa.is_nibble());
+    }
+}
@@ -0,0 +1,96 @@
+use std::panic;
+use std::sync::{Arc, Mutex};
+use std::thread;
+
+/// Call `job` with every index in `0..jobs`, each on its own thread except
+/// for the first, which runs on the current thread. If a thread cannot be
+/// spawned, its index runs on the current thread instead.
+///
+/// The spawned threads borrow `job`, which is sound because all of them are
+/// joined before this returns, even when a job panics.
+pub(crate) fn scoped(jobs: usize, job: &(dyn Fn(usize) + Sync)) {
+    struct Joiner(Vec<thread::JoinHandle<()>>);
+
+    impl Drop for Joiner {
+        fn drop(&mut self) {
+            for handle in self.0.drain(..) {
+                let _ = handle.join();
+            }
+        }
+    }
+
+    let job: &'static (dyn Fn(usize) + Sync) =
+        unsafe { ::std::mem::transmute(job) };
+    let mut joiner = Joiner(Vec::with_capacity(jobs));
+    let mut inline = vec![0];
+    for i in 1..jobs {
+        match thread::Builder::new().spawn(move || job(i)) {
+            Ok(handle) => joiner.0.push(handle),
+            Err(_) => inline.push(i),
+        }
+    }
+    for i in inline {
+        job(i);
+    }
+    let mut panicked = None;
+    for handle in joiner.0.drain(..) {
+        if let Err(err) = handle.join() {
+            panicked = Some(err);
+        }
+    }
+    if let Some(err) = panicked {
+        panic::resume_unwind(err);
+    }
+}
+
+/// Call `job` on a new thread, and return a handle for joining it. If a
+/// thread cannot be spawned, this calls `job` on the current thread instead
+/// and returns `None`.
+pub(crate) fn spawn<F>(job: F) -> Option<thread::JoinHandle<()>>
+where
+    F: FnOnce() + Send + 'static,
+{
+    // A failed spawn drops the closure it was given, so the job is shared
+    // with the closure rather than moved into it.
+    let job = Arc::new(Mutex::new(Some(job)));
+    let shared = job.clone();
+    let spawned = thread::Builder::new().spawn(move || {
+        let job = shared.lock().unwrap().take();
+        if let Some(job) = job {
+            job();
+        }
+    });
+    match spawned {
+        Ok(handle) => Some(handle),
+        Err(_) => {
+            let job = job.lock().unwrap().take();
+            if let Some(job) = job {
+                job();
+            }
+            None
+        }
+    }
+}
+
+/// Run `a` on the current thread and `b` on another thread, and return both
+/// of their results once both have finished.
+pub(crate) fn join<A, B, RA, RB>(a: A, b: B) -> (RA, RB)
+where
+    A: FnOnce() -> RA + Send,
+    B: FnOnce() -> RB + Send,
+    RA: Send,
+    RB: Send,
+{
+    let (a, b) = (Mutex::new(Some(a)), Mutex::new(Some(b)));
+    let (ra, rb) = (Mutex::new(None), Mutex::new(None));
+    scoped(2, &|i| {
+        if i == 0 {
+            let a = a.lock().unwrap().take().unwrap();
+            *ra.lock().unwrap() = Some(a());
+        } else {
+            let b = b.lock().unwrap().take().unwrap();
+            *rb.lock().unwrap() = Some(b());
+        }
+    });
+    (ra.into_inner().unwrap().unwrap(), rb.into_inner().unwrap().unwrap())
+}
@@ -0,0 +1,360 @@
+use std::collections::HashMap;
+
+use classes::ByteClassSet;
+use dense::{self, DenseDFA};
+use dfa::DFA;
+use state_id::StateID;
+
+/// The maximum number of DFAs that can be combined into a product DFA. Each
+/// DFA is tracked by one bit of a `u8` match set.
+pub const MAX_PRODUCT_DFAS: usize = 8;
+
+/// The default maximum number of states in a product DFA.
+const DEFAULT_STATE_LIMIT: usize = 10_000;
+
+/// The slot of a component DFA that has already matched. Once a component
+/// has matched, its remaining transitions can no longer change the result,
+/// so every such component state is collapsed into this one.
+const MATCHED: usize = ::std::usize::MAX;
+
+/// A small group of dense DFAs that are always searched together, combined
+/// into a single product DFA when it is small enough.
+///
+/// Each state of a product DFA corresponds to a tuple of states, one from
+/// each of its component DFAs. Following one transition of the product DFA
+/// follows the corresponding transition in every component at once, so a
+/// group of DFAs is searched in a single pass over the haystack with the
+/// cost of searching with one DFA.
+///
+/// A product DFA answers which of its components match anywhere in a
+/// haystack, like calling `DFA::is_match` on each component. Each of its
+/// states records which components have matched so far as a set of match
+/// bits, and the search stops as soon as every component has either matched
+/// or can no longer match.
+///
+/// The number of states in a product DFA can be as large as the product of
+/// the number of states in each component. A product DFA is therefore only
+/// built when it fits within a budget of states. Otherwise, the components
+/// are kept as separate DFAs and searched one after the other, which reports
+/// the same results. [`is_product`](#method.is_product) says which of the two
+/// was chosen.
+///
+/// # Example
+///
+/// ```
+/// use regex_automata::{DenseDFA, ProductDFA};
+///
+/// # fn example() -> Result<(), regex_automata::Error> {
+/// let product = ProductDFA::new(&[
+///     DenseDFA::new("[0-9]+")?,
+///     DenseDFA::new("[a-z]+")?,
+///     DenseDFA::new("[A-Z]+")?,
+/// ]);
+/// assert!(product.is_product());
+/// assert_eq!(0b011, product.which_match(b"abc123"));
+/// assert_eq!(0b100, product.which_match(b"XYZ"));
+/// assert_eq!(0b000, product.which_match(b"!?"));
+/// # Ok(()) }; example().unwrap()
+/// ```
+#[derive(Clone, Debug)]
+pub struct ProductDFA<S: StateID = usize> {
+    imp: Imp<S>,
+    len: usize,
+}
+
+#[derive(Clone, Debug)]
+enum Imp<S: StateID> {
+    /// A single DFA whose states are tuples of component states. `bits` maps
+    /// the index of each state to the set of components that have matched.
+    ///
+    /// The match states of the product DFA are precisely the states in which
+    /// every component has either matched or died, which is what lets a
+    /// search stop early.
+    Product { dfa: DenseDFA<Vec<S>, S>, bits: Vec<u8> },
+    /// The components themselves, used when their product is too big.
+    Separate(Vec<DenseDFA<Vec<S>, S>>),
+}
+
+impl<S: StateID> ProductDFA<S> {
+    /// Combine the given DFAs, building their product if it has at most
+    /// 10,000 states.
+    ///
+    /// # Panics
+    ///
+    /// This panics if more than 8 DFAs are given.
+    pub fn new<T: AsRef<[S]>>(dfas: &[DenseDFA<T, S>]) -> ProductDFA<S> {
+        ProductDFA::with_state_limit(dfas, DEFAULT_STATE_LIMIT)
+    }
+
+    /// Combine the given DFAs, building their product if it has at most
+    /// `limit` states. Otherwise, or if the product's states cannot be
+    /// represented by `S`, the DFAs are kept separate.
+    ///
+    /// # Panics
+    ///
+    /// This panics if more than 8 DFAs are given.
+    pub fn with_state_limit<T: AsRef<[S]>>(
+        dfas: &[DenseDFA<T, S>],
+        limit: usize,
+    ) -> ProductDFA<S> {
+        assert!(
+            dfas.len() <= MAX_PRODUCT_DFAS,
+            "a product DFA has at most {} components",
+            MAX_PRODUCT_DFAS,
+        );
+        let imp = match product(dfas, limit) {
+            Some((dfa, bits)) => Imp::Product { dfa, bits },
+            None => Imp::Separate(dfas.iter().map(|d| d.to_owned()).collect()),
+        };
+        ProductDFA { imp, len: dfas.len() }
+    }
+
+    /// Return the number of component DFAs.
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    /// Returns true if and only if there are no component DFAs.
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    /// Returns true if and only if the component DFAs were combined into a
+    /// single product DFA, rather than kept separate.
+    pub fn is_product(&self) -> bool {
+        match self.imp {
+            Imp::Product { .. } => true,
+            Imp::Separate(_) => false,
+        }
+    }
+
+    /// Returns the memory usage, in bytes, of the product DFA and its match
+    /// bits, or of the separate DFAs.
+    pub fn memory_usage(&self) -> usize {
+        match self.imp {
+            Imp::Product { ref dfa, ref bits } => {
+                dfa.memory_usage() + bits.len()
+            }
+            Imp::Separate(ref dfas) => {
+                dfas.iter().map(|d| d.memory_usage()).sum()
+            }
+        }
+    }
+
+    /// Returns the set of component DFAs that match anywhere in the given
+    /// haystack. Bit `i` is set if and only if `DFA::is_match` returns true
+    /// for the `i`th DFA given when this was built.
+    pub fn which_match(&self, haystack: &[u8]) -> u8 {
+        match self.imp {
+            Imp::Product { ref dfa, ref bits } => {
+                let state = match *dfa {
+                    DenseDFA::PremultipliedByteClass(ref r) => {
+                        run(r, haystack)
+                    }
+                    DenseDFA::ByteClass(ref r) => run(r, haystack),
+                    ref dfa => run(dfa, haystack),
+                };
+                bits[dfa.repr().state_id_to_index(state)]
+            }
+            Imp::Separate(ref dfas) => {
+                let mut matched = 0;
+                for (i, dfa) in dfas.iter().enumerate() {
+                    if dfa.is_match(haystack) {
+                        matched |= 1 << i;
+                    }
+                }
+                matched
+            }
+        }
+    }
+}
+
+/// Run the product DFA over the haystack and return the state it stopped
+/// in. The search stops early once a match state is reached, since all
+/// components are resolved and every match state loops back to itself.
+#[inline(always)]
+fn run<D: DFA>(dfa: &D, haystack: &[u8]) -> D::ID {
+    let mut state = dfa.start_state();
+    if dfa.is_match_or_dead_state(state) {
+        return state;
+    }
+    for &b in haystack {
+        state = unsafe { dfa.next_state_unchecked(state, b) };
+        if dfa.is_match_or_dead_state(state) {
+            break;
+        }
+    }
+    state
+}
+
+/// Build the product of the given DFAs, returning it along with the match
+/// bits of each of its states. If the product would have more than `limit`
+/// states, or its state identifiers would overflow `S`, then this returns
+/// `None`.
+fn product<T: AsRef<[S]>, S: StateID>(
+    dfas: &[DenseDFA<T, S>],
+    limit: usize,
+) -> Option<(DenseDFA<Vec<S>, S>, Vec<u8>)> {
+    // A slot is the state of one component. Dead components use the dead
+    // state's identifier, which is always 0.
+    let slot = |dfa: &DenseDFA<T, S>, id: S| -> usize {
+        if dfa.is_dead_state(id) {
+            0
+        } else if dfa.is_match_state(id) {
+            MATCHED
+        } else {
+            id.to_usize()
+        }
+    };
+    let mut set = ByteClassSet::new();
+    for dfa in dfas {
+        set.add_byte_classes(dfa.repr().byte_classes());
+    }
+    let classes = set.byte_classes();
+    let reps: Vec<u8> = classes.representatives().collect();
+
+    // Explore every reachable tuple of component states. The tuple in which
+    // every component is dead is added first, since it must become the dead
+    // state of the product.
+    let mut tuples: Vec<Vec<usize>> = vec![vec![0; dfas.len()]];
+    let mut index: HashMap<Vec<usize>, usize> = HashMap::new();
+    index.insert(tuples[0].clone(), 0);
+    let start: Vec<usize> =
+        dfas.iter().map(|d| slot(d, d.start_state())).collect();
+    let start = *index.entry(start.clone()).or_insert_with(|| {
+        tuples.push(start);
+        tuples.len() - 1
+    });
+    let mut trans: Vec<usize> = vec![];
+    let mut next = vec![0; dfas.len()];
+    let mut i = 0;
+    while i < tuples.len() {
+        if tuples.len() > limit {
+            return None;
+        }
+        for &b in &reps {
+            for (k, dfa) in dfas.iter().enumerate() {
+                next[k] = match tuples[i][k] {
+                    id @ 0 | id @ MATCHED => id,
+                    id => slot(dfa, dfa.next_state(S::from_usize(id), b)),
+                };
+            }
+            let id = match index.get(&next) {
+                Some(&id) => id,
+                None => {
+                    tuples.push(next.clone());
+                    index.insert(next.clone(), tuples.len() - 1);
+                    tuples.len() - 1
+                }
+            };
+            trans.push(id);
+        }
+        i += 1;
+    }
+    if tuples.len() > limit {
+        return None;
+    }
+
+    // Number the states so that the states in which every component is
+    // resolved directly follow the dead state. These become the product's
+    // match states.
+    let resolved = |t: &[usize]| t.iter().all(|&id| id == 0 || id == MATCHED);
+    let mut order: Vec<usize> = vec![0];
+    order.extend((1..tuples.len()).filter(|&i| resolved(&tuples[i])));
+    let max_match = order.len() - 1;
+    order.extend((1..tuples.len()).filter(|&i| !resolved(&tuples[i])));
+    let mut remap = vec![0; tuples.len()];
+    for (new, &old) in order.iter().enumerate() {
+        remap[old] = new;
+    }
+
+    let mut repr = dense::Repr::empty_with_byte_classes(classes);
+    for _ in 1..tuples.len() {
+        repr.add_empty_state().ok()?;
+    }
+    let mut bits = vec![0; tuples.len()];
+    for (old, tuple) in tuples.iter().enumerate() {
+        let from = S::from_usize(remap[old]);
+        for (c, &b) in reps.iter().enumerate() {
+            let to = remap[trans[old * reps.len() + c]];
+            repr.add_transition(from, b, S::from_usize(to));
+        }
+        for (k, &id) in tuple.iter().enumerate() {
+            if id == MATCHED {
+                bits[remap[old]] |= 1 << k;
+            }
+        }
+    }
+    repr.set_start_state(S::from_usize(remap[start]));
+    repr.set_max_match_state(S::from_usize(max_match));
+    // Premultiplication only speeds up searching, so a product DFA whose
+    // identifiers can't be premultiplied is still worth using. A failed
+    // attempt leaves the DFA as it was.
+    let _ = repr.premultiply();
+    Some((repr.into_dense_dfa(), bits))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::ProductDFA;
+    use dense::{self, DenseDFA};
+    use dfa::DFA;
+
+    #[test]
+    fn same_as_individual_dfas() {
+        let patterns =
+            &[r"[0-9]+", r"[a-f]+x", r"(?-u:\w+@\w+)", r"foo|bar", r"☃"];
+        let haystacks: &[&[u8]] = &[
+            b"",
+            b"abc",
+            b"fox 123",
+            b"eeex",
+            b"me@example",
+            "snow☃".as_bytes(),
+            b"bar 1 ax foo",
+        ];
+        for &premultiply in &[false, true] {
+            for &anchored in &[false, true] {
+                let dfas: Vec<DenseDFA<Vec<u32>, u32>> = patterns
+                    .iter()
+                    .map(|p| {
+                        dense::Builder::new()
+                            .premultiply(premultiply)
+                            .anchored(anchored)
+                            .build_with_size(p)
+                            .unwrap()
+                    })
+                    .collect();
+                let product = ProductDFA::new(&dfas);
+                let separate = ProductDFA::with_state_limit(&dfas, 0);
+                assert!(product.is_product());
+                assert!(!separate.is_product());
+                for &haystack in haystacks {
+                    let mut expected = 0;
+                    for (i, dfa) in dfas.iter().enumerate() {
+                        if dfa.is_match(haystack) {
+                            expected |= 1 << i;
+                        }
+                    }
+                    assert_eq!(expected, product.which_match(haystack));
+                    assert_eq!(expected, separate.which_match(haystack));
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn falls_back_when_too_big() {
+        let dfas = vec![
+            DenseDFA::new(r"\w{5}").unwrap(),
+            DenseDFA::new(r"[0-9a-z]{2}x").unwrap(),
+        ];
+        let product = ProductDFA::with_state_limit(&dfas, 10);
+        assert!(!product.is_product());
+        assert_eq!(0b11, product.which_match(b"abc1x"));
+
+        let empty: ProductDFA = ProductDFA::new::<Vec<usize>>(&[]);
+        assert!(empty.is_product());
+        assert_eq!(0, empty.which_match(b"abc"));
+    }
+}
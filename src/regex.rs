@@ -1,12 +1,29 @@
+use core::result;
+
+#[cfg(feature = "std")]
+use adaptive::AdaptiveRegex;
+#[cfg(feature = "std")]
+use async_regex::AsyncRegex;
 #[cfg(feature = "std")]
 use dense::{self, DenseDFA};
 use dfa::DFA;
 #[cfg(feature = "std")]
 use error::Result;
 #[cfg(feature = "std")]
+use lite::LiteRegex;
+#[cfg(feature = "std")]
+use nfa::NFA;
+#[cfg(feature = "std")]
+use nibble::{CompactDFA, DEFAULT_NIBBLE_THRESHOLD};
+#[cfg(feature = "std")]
+use parallel;
+#[cfg(feature = "std")]
 use sparse::SparseDFA;
 #[cfg(feature = "std")]
 use state_id::StateID;
+#[cfg(feature = "std")]
+use stride2::DEFAULT_STRIDE2_BUDGET;
+use utf8::{self, Utf8Error, Validator};
 
 /// A regular expression that uses deterministic finite automata for fast
 /// searching.
@@ -58,6 +75,7 @@ use state_id::StateID;
 pub struct Regex<D: DFA = DenseDFA<Vec<usize>, usize>> {
     forward: D,
     reverse: D,
+    reverse_unanchored: Option<D>,
 }
 
 /// A regular expression that uses deterministic finite automata for fast
@@ -109,6 +127,7 @@ pub struct Regex<D: DFA = DenseDFA<Vec<usize>, usize>> {
 pub struct Regex<D> {
     forward: D,
     reverse: D,
+    reverse_unanchored: Option<D>,
 }
 
 #[cfg(feature = "std")]
@@ -292,12 +311,68 @@ impl<D: DFA> Regex<D> {
             None => return None,
             Some(end) => end,
         };
-        let start = self
-            .reverse()
-            .rfind(&input[start..end])
-            .map(|i| start + i)
-            .expect("reverse search must match if forward search does");
-        Some((start, end))
+        Some((self.find_start(input, start, end), end))
+    }
+
+    /// Returns true if and only if there is a match that begins precisely at
+    /// `start`.
+    ///
+    /// Unlike `is_match_at`, this never finds a match that begins after
+    /// `start`, even when the regex is unanchored. This requires the forward
+    /// DFA to have an anchored start state, which is the case when it was
+    /// built with
+    /// [`RegexBuilder::dual_start`](struct.RegexBuilder.html#method.dual_start)
+    /// or [`RegexBuilder::anchored`](struct.RegexBuilder.html#method.anchored)
+    /// enabled.
+    ///
+    /// # Panics
+    ///
+    /// This panics if the forward DFA has no anchored start state.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::RegexBuilder;
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let re = RegexBuilder::new().dual_start(true).build("[0-9]+")?;
+    /// assert_eq!(true, re.is_match_at(b"abc123", 0));
+    /// assert_eq!(false, re.is_match_anchored_at(b"abc123", 0));
+    /// assert_eq!(true, re.is_match_anchored_at(b"abc123", 3));
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn is_match_anchored_at(&self, input: &[u8], start: usize) -> bool {
+        self.forward().is_match_anchored_at(input, start)
+    }
+
+    /// Returns the leftmost first match that begins precisely at `start`.
+    ///
+    /// Since the start of any such match is known in advance, this only runs
+    /// the forward DFA. This has the same requirements as
+    /// `is_match_anchored_at`.
+    ///
+    /// # Panics
+    ///
+    /// This panics if the forward DFA has no anchored start state.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::RegexBuilder;
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let re = RegexBuilder::new().dual_start(true).build("[0-9]+")?;
+    /// assert_eq!(Some((3, 6)), re.find_at(b"abc123", 0));
+    /// assert_eq!(None, re.find_anchored_at(b"abc123", 0));
+    /// assert_eq!(Some((4, 6)), re.find_anchored_at(b"abc123", 4));
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn find_anchored_at(
+        &self,
+        input: &[u8],
+        start: usize,
+    ) -> Option<(usize, usize)> {
+        self.forward().find_anchored_at(input, start).map(|end| (start, end))
     }
 
     /// Returns an iterator over all non-overlapping leftmost first matches
@@ -327,6 +402,146 @@ impl<D: DFA> Regex<D> {
         Matches::new(self, input)
     }
 
+    /// Returns the same matches as `find_iter`, while also checking that the
+    /// given bytes are valid UTF-8.
+    ///
+    /// Validation is fused with searching: the input is validated in chunks
+    /// immediately before the forward DFA scans each chunk, so that the
+    /// input is only read from memory once instead of requiring a separate
+    /// validation pass. Any input following the last match is validated once
+    /// no more matches can be found.
+    ///
+    /// If invalid UTF-8 is found, then the iterator yields an error reporting
+    /// the offset of the first invalid byte, and then stops. Matches that end
+    /// at or before that offset are yielded before the error, as if the input
+    /// ended at that offset.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::Regex;
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let re = Regex::new("[0-9]+")?;
+    ///
+    /// let matches: Vec<_> = re.find_iter_validated(b"a1 b22").collect();
+    /// assert_eq!(matches, vec![Ok((1, 2)), Ok((4, 6))]);
+    ///
+    /// let mut it = re.find_iter_validated(b"a1 b\xFF22");
+    /// assert_eq!(Some(Ok((1, 2))), it.next());
+    /// assert_eq!(Some(4), it.next().unwrap().err().map(|e| e.valid_up_to()));
+    /// assert_eq!(None, it.next());
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn find_iter_validated<'r, 't>(
+        &'r self,
+        input: &'t [u8],
+    ) -> ValidatedMatches<'r, 't, D> {
+        ValidatedMatches::new(self, input)
+    }
+
+    /// Returns an iterator over non-overlapping matches in the given bytes,
+    /// from right to left.
+    ///
+    /// Each match is found by running an unanchored reverse DFA from the end
+    /// of the text not yet searched, which finds the start of the last match
+    /// in it, and then running the forward DFA from that start to find its
+    /// end. Thus, finding the last `n` matches of a long text only scans the
+    /// text following them and the matches themselves.
+    ///
+    /// The end of each match is the same as the end `find_iter` would
+    /// report for a match with the same start. Empty matches are treated
+    /// like `find_iter` treats them, but mirrored: an empty match directly
+    /// preceding a match is skipped. When no two matches overlap, which is
+    /// the case for most patterns, the matches are exactly those yielded by
+    /// `find_iter` in reverse order. Otherwise, they may differ, since every
+    /// match is found relative to the end of the text instead of its start.
+    /// For example, `aa` matches `(1, 3)` in `aaa` instead of `(0, 2)`.
+    ///
+    /// This requires the regex to be built with
+    /// [`RegexBuilder::reverse_unanchored`](struct.RegexBuilder.html#method.reverse_unanchored)
+    /// enabled, unless it is anchored.
+    ///
+    /// # Panics
+    ///
+    /// This panics if the regex is unanchored and has no unanchored reverse
+    /// DFA.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::RegexBuilder;
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let re = RegexBuilder::new()
+    ///     .reverse_unanchored(true)
+    ///     .build("foo[0-9]+")?;
+    /// let text = b"foo1 foo12 foo123";
+    /// let last: Vec<(usize, usize)> = re.rfind_iter(text).take(2).collect();
+    /// assert_eq!(last, vec![(11, 17), (5, 10)]);
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn rfind_iter<'r, 't>(
+        &'r self,
+        input: &'t [u8],
+    ) -> ReverseMatches<'r, 't, D> {
+        assert!(
+            self.forward().is_anchored() || self.reverse_unanchored.is_some(),
+            "rfind_iter requires an unanchored reverse DFA"
+        );
+        ReverseMatches::new(self, input)
+    }
+
+    /// Returns an iterator over the parts of the given bytes that are
+    /// separated by the matches of this regex.
+    ///
+    /// The matches are those yielded by
+    /// [`find_iter`](struct.Regex.html#method.find_iter). Every part is a
+    /// slice of `input`, and there is always one more part than there are
+    /// matches, so a match at the beginning or end of `input` yields an empty
+    /// part before or after it.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::Regex;
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let re = Regex::new(r"[ \t]*,[ \t]*")?;
+    /// let fields: Vec<&[u8]> = re.split(b"a, b ,,c").collect();
+    /// assert_eq!(fields, vec![&b"a"[..], &b"b"[..], &b""[..], &b"c"[..]]);
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn split<'r, 't>(&'r self, input: &'t [u8]) -> Split<'r, 't, D> {
+        Split { finder: self.find_iter(input), text: input, last: 0 }
+    }
+
+    /// Returns an iterator over at most `limit` parts of the given bytes that
+    /// are separated by the matches of this regex.
+    ///
+    /// This yields the same parts as [`split`](#method.split), except that
+    /// the last part yielded is all of the remaining input, including any
+    /// matches it contains.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::Regex;
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let re = Regex::new(r"=+")?;
+    /// let parts: Vec<&[u8]> = re.splitn(b"key==a=b", 2).collect();
+    /// assert_eq!(parts, vec![&b"key"[..], &b"a=b"[..]]);
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn splitn<'r, 't>(
+        &'r self,
+        input: &'t [u8],
+        limit: usize,
+    ) -> SplitN<'r, 't, D> {
+        SplitN { splits: self.split(input), n: limit }
+    }
+
     /// Build a new regex from its constituent forward and reverse DFAs.
     ///
     /// This is useful when deserializing a regex from some arbitrary
@@ -386,7 +601,20 @@ impl<D: DFA> Regex<D> {
     /// # Ok(()) }; example().unwrap()
     /// ```
     pub fn from_dfas(forward: D, reverse: D) -> Regex<D> {
-        Regex { forward, reverse }
+        Regex { forward, reverse, reverse_unanchored: None }
+    }
+
+    /// Add the unanchored reverse DFA used by `rfind_iter` to this regex.
+    ///
+    /// Like `from_dfas`, this is useful when deserializing a regex. The DFA
+    /// given must be built from the same pattern as this regex's DFAs, with
+    /// [`dense::Builder::reverse`](dense/struct.Builder.html#method.reverse)
+    /// enabled and
+    /// [`dense::Builder::anchored`](dense/struct.Builder.html#method.anchored)
+    /// disabled.
+    pub fn with_reverse_unanchored(mut self, dfa: D) -> Regex<D> {
+        self.reverse_unanchored = Some(dfa);
+        self
     }
 
     /// Return the underlying DFA responsible for forward matching.
@@ -398,6 +626,31 @@ impl<D: DFA> Regex<D> {
     pub fn reverse(&self) -> &D {
         &self.reverse
     }
+
+    /// Return the underlying DFA responsible for finding the start of the
+    /// last match in `rfind_iter`, if this regex has one.
+    pub fn reverse_unanchored(&self) -> Option<&D> {
+        self.reverse_unanchored.as_ref()
+    }
+
+    /// Returns the start of the leftmost first match that was found by a
+    /// forward search beginning at `start` and ending at `end`.
+    pub(crate) fn find_start(
+        &self,
+        input: &[u8],
+        start: usize,
+        end: usize,
+    ) -> usize {
+        // When the forward DFA is anchored, every match begins where the
+        // search does, so there is no need to run the reverse DFA.
+        if self.forward().is_anchored() {
+            return start;
+        }
+        self.reverse()
+            .rfind(&input[start..end])
+            .map(|i| start + i)
+            .expect("reverse search must match if forward search does")
+    }
 }
 
 /// An iterator over all non-overlapping matches for a particular search.
@@ -423,6 +676,22 @@ impl<'r, 't, D: DFA> Matches<'r, 't, D> {
     fn new(re: &'r Regex<D>, text: &'t [u8]) -> Matches<'r, 't, D> {
         Matches { re, text, last_end: 0, last_match: None }
     }
+
+    /// Continue an iteration over `text` from a position previously returned
+    /// by `position`. This lets callers that can't hold on to an iterator,
+    /// such as the C API, fetch matches a batch at a time.
+    pub(crate) fn resume(
+        re: &'r Regex<D>,
+        text: &'t [u8],
+        (last_end, last_match): (usize, Option<usize>),
+    ) -> Matches<'r, 't, D> {
+        Matches { re, text, last_end, last_match }
+    }
+
+    /// Returns where this iteration is at, for use with `resume`.
+    pub(crate) fn position(&self) -> (usize, Option<usize>) {
+        (self.last_end, self.last_match)
+    }
 }
 
 impl<'r, 't, D: DFA> Iterator for Matches<'r, 't, D> {
@@ -454,6 +723,245 @@ impl<'r, 't, D: DFA> Iterator for Matches<'r, 't, D> {
     }
 }
 
+/// An iterator over non-overlapping matches for a particular search, from
+/// right to left.
+///
+/// The iterator yields a `(usize, usize)` value until no more matches could be
+/// found, in the same way as [`Matches`](struct.Matches.html). See
+/// [`Regex::rfind_iter`](struct.Regex.html#method.rfind_iter) for how its
+/// matches relate to those of `Matches`.
+///
+/// The lifetime variables are as follows:
+///
+/// * `'r` is the lifetime of the regular expression value itself.
+/// * `'t` is the lifetime of the text being searched.
+#[derive(Clone, Debug)]
+pub struct ReverseMatches<'r, 't, D: DFA + 'r> {
+    re: &'r Regex<D>,
+    text: &'t [u8],
+    /// The end of the text that remains to be searched, or `None` once the
+    /// search is done.
+    end: Option<usize>,
+    /// The start of the last match yielded.
+    last_match: Option<usize>,
+}
+
+impl<'r, 't, D: DFA> ReverseMatches<'r, 't, D> {
+    fn new(re: &'r Regex<D>, text: &'t [u8]) -> ReverseMatches<'r, 't, D> {
+        ReverseMatches { re, text, end: Some(text.len()), last_match: None }
+    }
+}
+
+impl<'r, 't, D: DFA> Iterator for ReverseMatches<'r, 't, D> {
+    type Item = (usize, usize);
+
+    fn next(&mut self) -> Option<(usize, usize)> {
+        let text = match self.end {
+            None => return None,
+            Some(end) => &self.text[..end],
+        };
+        // An anchored regex has at most one match, which find reports.
+        if self.re.forward().is_anchored() {
+            self.end = None;
+            return self.re.find(text);
+        }
+        let rev = self.re.reverse_unanchored.as_ref().unwrap();
+        let s = match rev.rfind(text) {
+            None => {
+                self.end = None;
+                return None;
+            }
+            Some(s) => s,
+        };
+        // Since a match begins at `s`, the leftmost first match found from
+        // `s` begins there too.
+        let e = self
+            .re
+            .forward()
+            .find_at(text, s)
+            .expect("forward search must match if reverse search does");
+        if s == e {
+            // This is an empty match. To ensure we make progress, end the
+            // next search at the largest possible end of the next match
+            // preceding this one.
+            self.end = if s == 0 { None } else { Some(s - 1) };
+            // Don't accept empty matches immediately preceding a match.
+            if Some(s) == self.last_match {
+                return self.next();
+            }
+        } else {
+            self.end = Some(s);
+        }
+        self.last_match = Some(s);
+        Some((s, e))
+    }
+}
+
+/// An iterator over the parts of a text separated by the matches of a regex.
+///
+/// This is returned by [`Regex::split`](struct.Regex.html#method.split).
+///
+/// The lifetime variables are as follows:
+///
+/// * `'r` is the lifetime of the regular expression value itself.
+/// * `'t` is the lifetime of the text being split.
+#[derive(Clone, Debug)]
+pub struct Split<'r, 't, D: DFA + 'r> {
+    finder: Matches<'r, 't, D>,
+    text: &'t [u8],
+    /// The start of the next part, or a value past the end of the text once
+    /// the last part has been yielded.
+    last: usize,
+}
+
+impl<'r, 't, D: DFA> Iterator for Split<'r, 't, D> {
+    type Item = &'t [u8];
+
+    fn next(&mut self) -> Option<&'t [u8]> {
+        let text = self.text;
+        match self.finder.next() {
+            None => {
+                if self.last > text.len() {
+                    None
+                } else {
+                    let part = &text[self.last..];
+                    self.last = text.len() + 1;
+                    Some(part)
+                }
+            }
+            Some((s, e)) => {
+                let part = &text[self.last..s];
+                self.last = e;
+                Some(part)
+            }
+        }
+    }
+}
+
+/// An iterator over at most a fixed number of parts of a text separated by
+/// the matches of a regex.
+///
+/// This is returned by [`Regex::splitn`](struct.Regex.html#method.splitn).
+///
+/// The lifetime variables are as follows:
+///
+/// * `'r` is the lifetime of the regular expression value itself.
+/// * `'t` is the lifetime of the text being split.
+#[derive(Clone, Debug)]
+pub struct SplitN<'r, 't, D: DFA + 'r> {
+    splits: Split<'r, 't, D>,
+    n: usize,
+}
+
+impl<'r, 't, D: DFA> Iterator for SplitN<'r, 't, D> {
+    type Item = &'t [u8];
+
+    fn next(&mut self) -> Option<&'t [u8]> {
+        if self.n == 0 {
+            return None;
+        }
+        self.n -= 1;
+        if self.n > 0 {
+            return self.splits.next();
+        }
+        let text = self.splits.text;
+        if self.splits.last > text.len() {
+            None
+        } else {
+            Some(&text[self.splits.last..])
+        }
+    }
+}
+
+/// An iterator over all non-overlapping matches for a particular search,
+/// which also validates that the text searched is UTF-8.
+///
+/// The iterator yields `Ok((usize, usize))` for each match, in the same way
+/// as [`Matches`](struct.Matches.html). If the text is not valid UTF-8, then
+/// an error is yielded and iteration stops.
+///
+/// The lifetime variables are as follows:
+///
+/// * `'r` is the lifetime of the regular expression value itself.
+/// * `'t` is the lifetime of the text being searched.
+#[derive(Clone, Debug)]
+pub struct ValidatedMatches<'r, 't, D: DFA + 'r> {
+    re: &'r Regex<D>,
+    text: &'t [u8],
+    validator: Validator,
+    last_end: usize,
+    last_match: Option<usize>,
+    done: bool,
+}
+
+impl<'r, 't, D: DFA> ValidatedMatches<'r, 't, D> {
+    fn new(re: &'r Regex<D>, text: &'t [u8]) -> ValidatedMatches<'r, 't, D> {
+        ValidatedMatches {
+            re,
+            text,
+            validator: Validator::new(),
+            last_end: 0,
+            last_match: None,
+            done: false,
+        }
+    }
+}
+
+impl<'r, 't, D: DFA> Iterator for ValidatedMatches<'r, 't, D> {
+    type Item = result::Result<(usize, usize), Utf8Error>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        if self.done {
+            return None;
+        }
+        let end = if self.last_end > self.text.len() {
+            None
+        } else {
+            let fwd = self.re.forward();
+            match utf8::find_at(
+                fwd,
+                &mut self.validator,
+                self.text,
+                self.last_end,
+            ) {
+                Err(err) => {
+                    self.done = true;
+                    return Some(Err(err));
+                }
+                Ok(end) => end,
+            }
+        };
+        let e = match end {
+            None => {
+                // No more matches, but the rest of the text still needs to
+                // be validated.
+                self.done = true;
+                return self.validator.finish(self.text).err().map(Err);
+            }
+            Some(e) => e,
+        };
+        let s = self.re.find_start(self.text, self.last_end, e);
+        if s == e {
+            // See the corresponding comment in `Matches`.
+            self.last_end = e + 1;
+            if Some(e) == self.last_match {
+                return self.next();
+            }
+        } else {
+            self.last_end = e;
+        }
+        self.last_match = Some(e);
+        Some(Ok((s, e)))
+    }
+}
+
+/// The minimum number of states in a pattern's forward NFA for
+/// `RegexBuilder::parallel` to build its DFAs on two threads. Smaller
+/// patterns are determinized in tens of microseconds, which is about what it
+/// costs to spawn a thread.
+#[cfg(feature = "std")]
+const PARALLEL_MIN_NFA_STATES: usize = 256;
+
 /// A builder for a regex based on deterministic finite automatons.
 ///
 /// This builder permits configuring several aspects of the construction
@@ -471,13 +979,23 @@ impl<'r, 't, D: DFA> Iterator for Matches<'r, 't, D> {
 #[derive(Clone, Debug)]
 pub struct RegexBuilder {
     dfa: dense::Builder,
+    reverse_unanchored: bool,
+    parallel: bool,
+    stride2_budget: usize,
+    nibble_threshold: usize,
 }
 
 #[cfg(feature = "std")]
 impl RegexBuilder {
     /// Create a new regex builder with the default configuration.
     pub fn new() -> RegexBuilder {
-        RegexBuilder { dfa: dense::Builder::new() }
+        RegexBuilder {
+            dfa: dense::Builder::new(),
+            reverse_unanchored: false,
+            parallel: false,
+            stride2_budget: DEFAULT_STRIDE2_BUDGET,
+            nibble_threshold: DEFAULT_NIBBLE_THRESHOLD,
+        }
     }
 
     /// Build a regex from the given pattern.
@@ -485,7 +1003,92 @@ impl RegexBuilder {
     /// If there was a problem parsing or compiling the pattern, then an error
     /// is returned.
     pub fn build(&self, pattern: &str) -> Result<Regex> {
-        self.build_with_size::<usize>(pattern)
+        self.build_parallel::<usize>(pattern)
+    }
+
+    /// Build a regex from the given pattern that searches ASCII text using
+    /// small ASCII-only DFAs, and only builds the full DFAs for this
+    /// configuration once it encounters non-ASCII text.
+    ///
+    /// This is useful for patterns like `\w+` whose Unicode-aware DFAs are
+    /// much bigger and slower to build than their ASCII counterparts, when
+    /// most haystacks are expected to be ASCII. The results are always the
+    /// same as the results of a regex returned by `build`. See
+    /// [`LiteRegex`](struct.LiteRegex.html) for more details.
+    ///
+    /// If there was a problem parsing or compiling the pattern, then an error
+    /// is returned.
+    pub fn build_lite(&self, pattern: &str) -> Result<LiteRegex> {
+        let mut ascii = self.clone();
+        ascii.unicode(false).allow_invalid_utf8(true);
+        match ascii.build(pattern) {
+            Ok(ascii) => {
+                // Compiling the pattern's NFA is much cheaper than building
+                // its full DFAs, and leaves only their size to go wrong when
+                // they are built later.
+                let nfa = self.build_nfa(pattern)?;
+                Ok(LiteRegex::new(pattern, self.clone(), ascii, nfa))
+            }
+            // Some patterns, such as `\pL`, can't be used without Unicode
+            // mode. In that case, there's no point in delaying the build.
+            Err(_) => {
+                let unicode = self.build(pattern)?;
+                Ok(LiteRegex::unicode_only(pattern, self.clone(), unicode))
+            }
+        }
+    }
+
+    /// Build a regex from the given pattern that changes how it searches
+    /// based on statistics it records about its own searches.
+    ///
+    /// The regex starts with a sparse forward DFA and no reverse DFA, and
+    /// switches to faster but bigger representations once its use justifies
+    /// them. The results are always the same as the results of a regex
+    /// returned by `build`. See
+    /// [`AdaptiveRegex`](struct.AdaptiveRegex.html) for more details.
+    ///
+    /// If there was a problem parsing or compiling the pattern, then an error
+    /// is returned.
+    pub fn build_adaptive(&self, pattern: &str) -> Result<AdaptiveRegex> {
+        AdaptiveRegex::new(pattern, self.dfa.clone())
+    }
+
+    /// Build a regex from the given pattern whose DFAs are built on a
+    /// background thread, and which simulates the pattern's NFA to answer
+    /// searches until they are ready.
+    ///
+    /// This returns as soon as the NFA is built, which is usually much
+    /// sooner than the DFAs would be. See
+    /// [`AsyncRegex`](struct.AsyncRegex.html) for more details.
+    ///
+    /// If there was a problem parsing or compiling the pattern, then an error
+    /// is returned.
+    pub fn build_async(&self, pattern: &str) -> Result<AsyncRegex> {
+        self.build_async_with(pattern, |_| {})
+    }
+
+    /// Returns the same as `build_async`, but calls `done` with the result
+    /// of building the DFAs once the background build has finished.
+    ///
+    /// `done` is called on the background thread, or on the current thread
+    /// before this returns if no thread can be spawned. It is passed an
+    /// error if the DFAs could not be built, in which case the returned
+    /// regex keeps simulating its NFA.
+    pub fn build_async_with<F>(
+        &self,
+        pattern: &str,
+        done: F,
+    ) -> Result<AsyncRegex>
+    where
+        F: FnOnce(Result<()>) + Send + 'static,
+    {
+        let nfa = self.build_nfa(pattern)?;
+        Ok(AsyncRegex::new(pattern, self.clone(), nfa, done))
+    }
+
+    /// Build the NFA for the given pattern with this configuration.
+    pub(crate) fn build_nfa(&self, pattern: &str) -> Result<NFA> {
+        self.dfa.build_nfa(pattern)
     }
 
     /// Build a regex from the given pattern using sparse DFAs.
@@ -496,7 +1099,7 @@ impl RegexBuilder {
         &self,
         pattern: &str,
     ) -> Result<Regex<SparseDFA<Vec<u8>, usize>>> {
-        self.build_with_size_sparse::<usize>(pattern)
+        to_sparse(self.build_parallel::<usize>(pattern)?)
     }
 
     /// Build a regex from the given pattern using a specific representation
@@ -521,19 +1124,63 @@ impl RegexBuilder {
     /// routines, such as [`DenseDFA::to_u16`](enum.DenseDFA.html#method.to_u16).
     /// Finally, reconstitute the regex via
     /// [`Regex::from_dfa`](struct.Regex.html#method.from_dfa).
+    ///
+    /// Unlike `build`, this always builds the forward and reverse DFAs one
+    /// after the other, since building them on two threads requires `S` to
+    /// implement `Send`.
     pub fn build_with_size<S: StateID>(
         &self,
         pattern: &str,
     ) -> Result<Regex<DenseDFA<Vec<S>, S>>> {
+        let rev = self.reverse_builder();
         let forward = self.dfa.build_with_size(pattern)?;
-        let reverse = self
-            .dfa
-            .clone()
-            .anchored(true)
-            .reverse(true)
-            .longest_match(true)
-            .build_with_size(pattern)?;
-        Ok(Regex::from_dfas(forward, reverse))
+        let reverse = rev.build_with_size(pattern)?;
+        let re = Regex::from_dfas(forward, reverse);
+        self.add_reverse_unanchored(re, pattern)
+    }
+
+    /// Build a regex from the given pattern like `build_with_size`, but
+    /// build its forward and reverse DFAs on two threads when `parallel` is
+    /// enabled and the pattern's NFA is big enough for that to pay off.
+    fn build_parallel<S: StateID + Send>(
+        &self,
+        pattern: &str,
+    ) -> Result<Regex<DenseDFA<Vec<S>, S>>> {
+        let rev = self.reverse_builder();
+        let fwd_nfa = self.dfa.build_nfa(pattern)?;
+        let rev_nfa = rev.build_nfa(pattern)?;
+        let forward = || self.dfa.build_from_nfa(&fwd_nfa);
+        let reverse = || rev.build_from_nfa(&rev_nfa);
+        let (forward, reverse) =
+            if self.parallel && fwd_nfa.len() >= PARALLEL_MIN_NFA_STATES {
+                parallel::join(forward, reverse)
+            } else {
+                (forward(), reverse())
+            };
+        let re = Regex::from_dfas(forward?, reverse?);
+        self.add_reverse_unanchored(re, pattern)
+    }
+
+    /// Returns a builder for the reverse DFA of a regex.
+    fn reverse_builder(&self) -> dense::Builder {
+        let mut rev = self.dfa.clone();
+        rev.anchored(true).reverse(true).longest_match(true);
+        rev
+    }
+
+    /// Build the unanchored reverse DFA of the given regex, if this builder
+    /// asks for one.
+    fn add_reverse_unanchored<S: StateID>(
+        &self,
+        mut re: Regex<DenseDFA<Vec<S>, S>>,
+        pattern: &str,
+    ) -> Result<Regex<DenseDFA<Vec<S>, S>>> {
+        if self.reverse_unanchored && !re.forward().is_anchored() {
+            let mut tail = self.dfa.clone();
+            tail.reverse(true).dual_start(false);
+            re.reverse_unanchored = Some(tail.build_with_size(pattern)?);
+        }
+        Ok(re)
     }
 
     /// Build a regex from the given pattern using a specific representation
@@ -542,10 +1189,100 @@ impl RegexBuilder {
         &self,
         pattern: &str,
     ) -> Result<Regex<SparseDFA<Vec<u8>, S>>> {
-        let re = self.build_with_size(pattern)?;
-        let fwd = re.forward().to_sparse()?;
-        let rev = re.reverse().to_sparse()?;
-        Ok(Regex::from_dfas(fwd, rev))
+        to_sparse(self.build_with_size(pattern)?)
+    }
+
+    /// Build a regex from the given pattern whose DFAs use a representation
+    /// chosen from the size of their dense DFAs.
+    ///
+    /// Each of the regex's DFAs is first built as a dense DFA. If the forward
+    /// DFA is tiny enough for the
+    /// [stride-2 budget](struct.RegexBuilder.html#method.stride2_budget),
+    /// then it is replaced by an equivalent
+    /// [`Stride2DFA`](struct.Stride2DFA.html), which searches about twice as
+    /// fast. Reverse DFAs are never converted, since reverse searches spend
+    /// most of their time in match states, which a stride-2 DFA follows one
+    /// byte at a time. If a DFA uses more memory than the
+    /// [nibble threshold](struct.RegexBuilder.html#method.nibble_threshold),
+    /// then it is replaced by an equivalent
+    /// [`NibbleDFA`](struct.NibbleDFA.html), which is usually much smaller
+    /// but somewhat slower to search. See
+    /// [`CompactDFA`](enum.CompactDFA.html) for more details.
+    ///
+    /// If there was a problem parsing or compiling the pattern, then an error
+    /// is returned.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::RegexBuilder;
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let re = RegexBuilder::new()
+    ///     .nibble_threshold(0)
+    ///     .build_compact(r"\p{L}+\s+\p{N}+")?;
+    /// assert!(re.forward().is_nibble());
+    /// assert_eq!(Some((0, 8)), re.find("Ünï 42".as_bytes()));
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn build_compact(&self, pattern: &str) -> Result<Regex<CompactDFA>> {
+        Ok(self.to_compact(self.build_parallel::<usize>(pattern)?))
+    }
+
+    /// Build a regex from the given pattern using a specific representation
+    /// for the underlying DFA state IDs, choosing the representation of each
+    /// DFA like `build_compact`.
+    pub fn build_with_size_compact<S: StateID>(
+        &self,
+        pattern: &str,
+    ) -> Result<Regex<CompactDFA<S>>> {
+        Ok(self.to_compact(self.build_with_size::<S>(pattern)?))
+    }
+
+    /// Convert each DFA of the given regex to the representation chosen by
+    /// `build_compact`.
+    fn to_compact<S: StateID>(
+        &self,
+        re: Regex<DenseDFA<Vec<S>, S>>,
+    ) -> Regex<CompactDFA<S>> {
+        let Regex { forward, reverse, reverse_unanchored } = re;
+        let (budget, threshold) = (self.stride2_budget, self.nibble_threshold);
+        // A reverse scan spends most of its bytes in match states, where a
+        // stride-2 DFA follows one byte at a time anyway, so only the forward
+        // DFA is worth its pair table.
+        let reversed = |dfa| CompactDFA::with_limits(dfa, 0, threshold);
+        Regex {
+            forward: CompactDFA::with_limits(forward, budget, threshold),
+            reverse: reversed(reverse),
+            reverse_unanchored: reverse_unanchored.map(reversed),
+        }
+    }
+
+    /// Set the maximum size of the pair table, in entries, of a forward DFA
+    /// that
+    /// [`build_compact`](struct.RegexBuilder.html#method.build_compact)
+    /// converts to a stride-2 DFA. A DFA with `k` equivalence classes and
+    /// `n` states has `k^2 * n` entries in its pair table.
+    ///
+    /// Setting this to `0` disables stride-2 DFAs. This has no effect on any
+    /// other build routine.
+    ///
+    /// The default is 16,384 entries.
+    pub fn stride2_budget(&mut self, entries: usize) -> &mut RegexBuilder {
+        self.stride2_budget = entries;
+        self
+    }
+
+    /// Set the memory usage, in bytes, above which
+    /// [`build_compact`](struct.RegexBuilder.html#method.build_compact)
+    /// converts a dense DFA to a nibble DFA.
+    ///
+    /// This has no effect on any other build routine.
+    ///
+    /// The default is 1MB.
+    pub fn nibble_threshold(&mut self, bytes: usize) -> &mut RegexBuilder {
+        self.nibble_threshold = bytes;
+        self
     }
 
     /// Set whether matching must be anchored at the beginning of the input.
@@ -560,6 +1297,60 @@ impl RegexBuilder {
         self
     }
 
+    /// Build the forward and reverse DFAs at the same time, on two threads.
+    ///
+    /// The two DFAs are independent, so this can roughly halve the time it
+    /// takes to build a regex whose DFAs are expensive to build. Each DFA is
+    /// still determinized and, when `minimize` is enabled, minimized on a
+    /// single thread. Patterns whose NFAs are small are always built on the
+    /// current thread, since spawning a thread would cost about as much as
+    /// it saves. If a thread cannot be spawned, both DFAs are built on the
+    /// current thread.
+    ///
+    /// This only applies to `build`, `build_sparse` and `build_compact`.
+    /// The `build_with_size` routines always build one DFA after the other.
+    ///
+    /// By default this is disabled.
+    pub fn parallel(&mut self, yes: bool) -> &mut RegexBuilder {
+        self.parallel = yes;
+        self
+    }
+
+    /// Give the forward DFA an anchored start state in addition to its
+    /// unanchored one.
+    ///
+    /// This permits the same regex to be used for both unanchored searches
+    /// and searches anchored at an arbitrary position via
+    /// [`Regex::find_anchored_at`](struct.Regex.html#method.find_anchored_at)
+    /// and
+    /// [`Regex::is_match_anchored_at`](struct.Regex.html#method.is_match_anchored_at),
+    /// without building a second set of DFAs. Both start states are kept
+    /// when the DFA is serialized. See
+    /// [`dense::Builder::dual_start`](dense/struct.Builder.html#method.dual_start)
+    /// for more details.
+    ///
+    /// This has no effect when `anchored` is enabled.
+    ///
+    /// By default this is disabled.
+    pub fn dual_start(&mut self, yes: bool) -> &mut RegexBuilder {
+        self.dfa.dual_start(yes);
+        self
+    }
+
+    /// Also build the unanchored reverse DFA used by
+    /// [`Regex::rfind_iter`](struct.Regex.html#method.rfind_iter).
+    ///
+    /// This DFA finds the start of the last match in a text by scanning it
+    /// backwards from its end. Building it takes about as long as building
+    /// the forward DFA. It isn't built for anchored regexes, which don't
+    /// need it.
+    ///
+    /// By default this is disabled.
+    pub fn reverse_unanchored(&mut self, yes: bool) -> &mut RegexBuilder {
+        self.reverse_unanchored = yes;
+        self
+    }
+
     /// Enable or disable the case insensitive flag by default.
     ///
     /// By default this is disabled. It may alternatively be selectively
@@ -722,6 +1513,20 @@ impl RegexBuilder {
         self
     }
 
+    /// Pad each row of the underlying DFAs' transition tables to a power of
+    /// two.
+    ///
+    /// This is most useful with premultiplication disabled, where it lets
+    /// state identifiers stay small while rows are found with a shift. See
+    /// [`dense::Builder::power_of_two_stride`](dense/struct.Builder.html#method.power_of_two_stride)
+    /// for details.
+    ///
+    /// This option is disabled by default.
+    pub fn power_of_two_stride(&mut self, yes: bool) -> &mut RegexBuilder {
+        self.dfa.power_of_two_stride(yes);
+        self
+    }
+
     /// Shrink the size of the underlying DFA alphabet by mapping bytes to
     /// their equivalence classes.
     ///
@@ -769,3 +1574,100 @@ impl Default for RegexBuilder {
         RegexBuilder::new()
     }
 }
+
+/// Convert each DFA of the given regex to a sparse DFA.
+#[cfg(feature = "std")]
+fn to_sparse<S: StateID>(
+    re: Regex<DenseDFA<Vec<S>, S>>,
+) -> Result<Regex<SparseDFA<Vec<u8>, S>>> {
+    let fwd = re.forward().to_sparse()?;
+    let rev = re.reverse().to_sparse()?;
+    let mut sparse = Regex::from_dfas(fwd, rev);
+    if let Some(tail) = re.reverse_unanchored() {
+        sparse.reverse_unanchored = Some(tail.to_sparse()?);
+    }
+    Ok(sparse)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::RegexBuilder;
+
+    #[test]
+    fn rfind_iter_mirrors_find_iter() {
+        // None of these patterns can match overlapping text.
+        let patterns = &[r"[0-9]+", r"foo|bar", r"a*", r"b?", r"x*y", r"☃"];
+        let haystacks: &[&[u8]] = &[
+            b"",
+            b"a",
+            b"ba",
+            b"ab",
+            b"foo 12 bar 345",
+            b"aaxyxxyb",
+            "a☃b☃".as_bytes(),
+        ];
+        for pattern in patterns {
+            let re = RegexBuilder::new()
+                .reverse_unanchored(true)
+                .build(pattern)
+                .unwrap();
+            for &haystack in haystacks {
+                let mut expected: Vec<_> = re.find_iter(haystack).collect();
+                expected.reverse();
+                let got: Vec<_> = re.rfind_iter(haystack).collect();
+                assert_eq!(expected, got, "{:?} in {:?}", pattern, haystack);
+            }
+        }
+    }
+
+    #[test]
+    fn rfind_iter_anchored() {
+        let re = RegexBuilder::new().anchored(true).build(r"[a-z]+").unwrap();
+        assert!(re.reverse_unanchored().is_none());
+        let got: Vec<_> = re.rfind_iter(b"abc def").collect();
+        assert_eq!(vec![(0, 3)], got);
+        assert_eq!(None, re.rfind_iter(b" abc").next());
+    }
+
+    #[test]
+    #[should_panic]
+    fn rfind_iter_requires_reverse_unanchored() {
+        RegexBuilder::new().build(r"[a-z]+").unwrap().rfind_iter(b"abc");
+    }
+
+    #[test]
+    fn find_iter_validated_stops_at_invalid_byte() {
+        let re = RegexBuilder::new().build(r"a+").unwrap();
+        let mut it = re.find_iter_validated(b"aa\xFF");
+        assert_eq!(Some(Ok((0, 2))), it.next());
+        assert_eq!(Some(2), it.next().unwrap().err().map(|e| e.valid_up_to()));
+        assert_eq!(None, it.next());
+
+        let got: Vec<_> = re.find_iter_validated(b"a ba\xFFa").collect();
+        assert_eq!(3, got.len());
+        assert_eq!(Ok((0, 1)), got[0]);
+        assert_eq!(Ok((3, 4)), got[1]);
+        assert_eq!(Some(4), got[2].err().map(|e| e.valid_up_to()));
+    }
+
+    #[test]
+    fn parallel_build_agrees() {
+        // The first pattern is too small to be built on two threads, while
+        // the NFA of the second has several hundred states.
+        for pattern in &[r"foo[0-9]+", r"\w+@\w+"] {
+            let mut builder = RegexBuilder::new();
+            builder.reverse_unanchored(true);
+            let serial = builder.build(pattern).unwrap();
+            let parallel = builder.parallel(true).build(pattern).unwrap();
+            let bytes = |re: &super::Regex| {
+                let tail = re.reverse_unanchored().unwrap();
+                (
+                    re.forward().to_bytes_native_endian().unwrap(),
+                    re.reverse().to_bytes_native_endian().unwrap(),
+                    tail.to_bytes_native_endian().unwrap(),
+                )
+            };
+            assert!(bytes(&serial) == bytes(&parallel), "{}", pattern);
+        }
+    }
+}
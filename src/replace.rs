@@ -0,0 +1,392 @@
+use std::io;
+
+use dfa::DFA;
+use regex::Regex;
+
+/// What to substitute for each match of a regex when replacing matches.
+#[derive(Clone, Copy, Debug)]
+pub enum Replacement<'a> {
+    /// Replace each match with the given bytes.
+    Bytes(&'a [u8]),
+    /// Overwrite every byte of each match with the given byte. The output is
+    /// then exactly as long as the input.
+    Mask(u8),
+}
+
+impl<'a> Replacement<'a> {
+    /// Append the replacement for a match of `len` bytes to `out`.
+    fn push(&self, out: &mut Vec<u8>, len: usize) {
+        match *self {
+            Replacement::Bytes(bytes) => out.extend_from_slice(bytes),
+            Replacement::Mask(byte) => {
+                let new_len = out.len() + len;
+                out.resize(new_len, byte);
+            }
+        }
+    }
+}
+
+/// An owned `Replacement`, for writers that outlive the bytes they were
+/// given.
+#[derive(Clone, Debug)]
+enum OwnedReplacement {
+    Bytes(Vec<u8>),
+    Mask(u8),
+}
+
+impl OwnedReplacement {
+    fn as_ref(&self) -> Replacement {
+        match *self {
+            OwnedReplacement::Bytes(ref bytes) => Replacement::Bytes(bytes),
+            OwnedReplacement::Mask(byte) => Replacement::Mask(byte),
+        }
+    }
+}
+
+/// Routines for replacing every match of a regex.
+///
+/// These copy the input into an output buffer in a single pass over the
+/// matches. The bytes between two matches are copied with one bulk copy,
+/// and the output buffer is grown once up front, so that replacing matches
+/// costs little more than copying the input when matches are rare.
+impl<D: DFA> Regex<D> {
+    /// Append `input` to `out` with every match of this regex replaced by
+    /// `replacement`, and return the number of matches replaced.
+    ///
+    /// The matches replaced are those yielded by
+    /// [`find_iter`](struct.Regex.html#method.find_iter).
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::Regex;
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let re = Regex::new("[0-9]{3}-[0-9]{4}")?;
+    /// let mut out = vec![];
+    /// let text = b"call 555-1234 or 555-9876";
+    /// assert_eq!(2, re.replace_all_into(text, b"<phone>", &mut out));
+    /// assert_eq!(&b"call <phone> or <phone>"[..], &out[..]);
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn replace_all_into(
+        &self,
+        input: &[u8],
+        replacement: &[u8],
+        out: &mut Vec<u8>,
+    ) -> usize {
+        self.replace_into(input, Replacement::Bytes(replacement), out, true)
+    }
+
+    /// Append `input` to `out` with every byte of every match of this regex
+    /// overwritten by `mask`, and return the number of matches masked.
+    ///
+    /// This appends exactly `input.len()` bytes to `out`.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::Regex;
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let re = Regex::new("[0-9]{4}")?;
+    /// let mut out = vec![];
+    /// let text = b"pin 1234, code 9876";
+    /// assert_eq!(2, re.mask_all_into(text, b'*', &mut out));
+    /// assert_eq!(&b"pin ****, code ****"[..], &out[..]);
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn mask_all_into(
+        &self,
+        input: &[u8],
+        mask: u8,
+        out: &mut Vec<u8>,
+    ) -> usize {
+        self.replace_into(input, Replacement::Mask(mask), out, true)
+    }
+
+    /// Write `input` to `out` with every byte of every match of this regex
+    /// overwritten by `mask`, and return the number of matches masked.
+    ///
+    /// This is like `mask_all_into`, but writes to a caller-provided buffer
+    /// instead of growing a `Vec`.
+    ///
+    /// # Panics
+    ///
+    /// This panics if `out` is not exactly as long as `input`.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use regex_automata::Regex;
+    ///
+    /// # fn example() -> Result<(), regex_automata::Error> {
+    /// let re = Regex::new("[0-9]{4}")?;
+    /// let text = b"pin 1234, code 9876";
+    /// let mut out = [0; 19];
+    /// assert_eq!(2, re.mask_all_to_slice(text, b'*', &mut out));
+    /// assert_eq!(&b"pin ****, code ****"[..], &out[..]);
+    /// # Ok(()) }; example().unwrap()
+    /// ```
+    pub fn mask_all_to_slice(
+        &self,
+        input: &[u8],
+        mask: u8,
+        out: &mut [u8],
+    ) -> usize {
+        assert_eq!(input.len(), out.len(), "output must match input length");
+        let (mut count, mut copied) = (0, 0);
+        for (s, e) in self.find_iter(input) {
+            out[copied..s].copy_from_slice(&input[copied..s]);
+            for b in &mut out[s..e] {
+                *b = mask;
+            }
+            copied = e;
+            count += 1;
+        }
+        out[copied..].copy_from_slice(&input[copied..]);
+        count
+    }
+
+    /// Returns a writer that replaces the matches of this regex in the
+    /// records written to it, and writes the result to `wtr`.
+    ///
+    /// See [`ReplaceWriter`](struct.ReplaceWriter.html) for how the input is
+    /// split into records.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use std::io::Write;
+    /// use regex_automata::{Regex, Replacement};
+    ///
+    /// let re = Regex::new("secret=[a-z]+").unwrap();
+    /// let redact = Replacement::Bytes(b"secret=?");
+    /// let mut wtr = re.replace_writer(redact, b'\n', vec![]);
+    /// wtr.write_all(b"a secret=ab").unwrap();
+    /// wtr.write_all(b"c\nsecret=x b").unwrap();
+    /// let out = wtr.finish().unwrap();
+    /// assert_eq!(&b"a secret=?\nsecret=? b"[..], &out[..]);
+    /// ```
+    pub fn replace_writer<W: io::Write>(
+        &self,
+        replacement: Replacement,
+        delimiter: u8,
+        wtr: W,
+    ) -> ReplaceWriter<D, W> {
+        ReplaceWriter::new(self, replacement, delimiter, wtr)
+    }
+
+    /// Append `input` to `out` with every match replaced. When `last` is
+    /// false, `input` is followed by more input, which reports an empty
+    /// match at the end of `input` itself.
+    fn replace_into(
+        &self,
+        input: &[u8],
+        replacement: Replacement,
+        out: &mut Vec<u8>,
+        last: bool,
+    ) -> usize {
+        out.reserve(input.len());
+        let (mut count, mut copied) = (0, 0);
+        for (s, e) in self.find_iter(input) {
+            if !last && s == input.len() {
+                break;
+            }
+            out.extend_from_slice(&input[copied..s]);
+            replacement.push(out, e - s);
+            copied = e;
+            count += 1;
+        }
+        out.extend_from_slice(&input[copied..]);
+        count
+    }
+}
+
+/// A writer that replaces the matches of a regex in the bytes written to it,
+/// and writes the result to another writer.
+///
+/// The input is treated as a sequence of records, each terminated by a
+/// delimiter byte such as `\n`. Each write searches the complete records it
+/// finishes as one block, and buffers a trailing partial record until the
+/// rest of it has been written. The output is therefore the same as that of
+/// [`Regex::replace_all_into`](struct.Regex.html#method.replace_all_into)
+/// over all of the input, provided that no match of the regex contains the
+/// delimiter.
+///
+/// A record that is never terminated is buffered in full, so a stream
+/// without delimiters is buffered until `finish` is called.
+///
+/// This is built with
+/// [`Regex::replace_writer`](struct.Regex.html#method.replace_writer).
+#[derive(Clone, Debug)]
+pub struct ReplaceWriter<'r, D: DFA + 'r, W: io::Write> {
+    re: &'r Regex<D>,
+    replacement: OwnedReplacement,
+    delimiter: u8,
+    wtr: W,
+    /// A partial record left over from previous writes.
+    pending: Vec<u8>,
+    /// The output of the current write, reused across writes.
+    out: Vec<u8>,
+    count: usize,
+}
+
+impl<'r, D: DFA, W: io::Write> ReplaceWriter<'r, D, W> {
+    fn new(
+        re: &'r Regex<D>,
+        replacement: Replacement,
+        delimiter: u8,
+        wtr: W,
+    ) -> ReplaceWriter<'r, D, W> {
+        let replacement = match replacement {
+            Replacement::Bytes(bytes) => {
+                OwnedReplacement::Bytes(bytes.to_vec())
+            }
+            Replacement::Mask(byte) => OwnedReplacement::Mask(byte),
+        };
+        ReplaceWriter {
+            re,
+            replacement,
+            delimiter,
+            wtr,
+            pending: vec![],
+            out: vec![],
+            count: 0,
+        }
+    }
+
+    /// Returns the number of matches replaced so far.
+    pub fn count(&self) -> usize {
+        self.count
+    }
+
+    /// Replace the matches in any partial record buffered at the end of the
+    /// input, write it out, and return the underlying writer.
+    pub fn finish(mut self) -> io::Result<W> {
+        self.write_pending()?;
+        Ok(self.wtr)
+    }
+
+    /// Replace the matches in the buffered partial record, if any, as the
+    /// last record of the input, and write it out.
+    pub(crate) fn write_pending(&mut self) -> io::Result<()> {
+        self.out.clear();
+        self.count += self.re.replace_into(
+            &self.pending,
+            self.replacement.as_ref(),
+            &mut self.out,
+            true,
+        );
+        self.pending.clear();
+        self.wtr.write_all(&self.out)?;
+        self.wtr.flush()
+    }
+}
+
+impl<'r, D: DFA, W: io::Write> io::Write for ReplaceWriter<'r, D, W> {
+    fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+        let end = match buf.iter().rposition(|&b| b == self.delimiter) {
+            None => {
+                self.pending.extend_from_slice(buf);
+                return Ok(buf.len());
+            }
+            Some(i) => i + 1,
+        };
+        self.out.clear();
+        let replacement = self.replacement.as_ref();
+        if self.pending.is_empty() {
+            // Search the new records in place rather than copying them.
+            self.count += self.re.replace_into(
+                &buf[..end],
+                replacement,
+                &mut self.out,
+                false,
+            );
+        } else {
+            self.pending.extend_from_slice(&buf[..end]);
+            self.count += self.re.replace_into(
+                &self.pending,
+                replacement,
+                &mut self.out,
+                false,
+            );
+            self.pending.clear();
+        }
+        self.pending.extend_from_slice(&buf[end..]);
+        self.wtr.write_all(&self.out)?;
+        Ok(buf.len())
+    }
+
+    /// Flush the underlying writer. A partial record buffered at the end of
+    /// the input is only written by `finish`.
+    fn flush(&mut self) -> io::Result<()> {
+        self.wtr.flush()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::io::Write;
+
+    use super::Replacement;
+    use regex::Regex;
+
+    /// Replace matches in `input` with a plain loop over `find_iter`.
+    fn naive(re: &Regex, input: &[u8], replacement: Replacement) -> Vec<u8> {
+        let mut out = vec![];
+        let mut copied = 0;
+        for (s, e) in re.find_iter(input) {
+            out.extend_from_slice(&input[copied..s]);
+            match replacement {
+                Replacement::Bytes(bytes) => out.extend_from_slice(bytes),
+                Replacement::Mask(b) => out.extend(vec![b; e - s]),
+            }
+            copied = e;
+        }
+        out.extend_from_slice(&input[copied..]);
+        out
+    }
+
+    #[test]
+    fn same_as_naive() {
+        let input = b"id=17 user=bob\nid=4 user=al\n\nid= user=x\ntail 99";
+        for pattern in &[r"[0-9]+", r"user=[a-z]*", r"x*", r"", r"☃"] {
+            let re = Regex::new(pattern).unwrap();
+            for replacement in
+                &[Replacement::Bytes(b"<>"), Replacement::Mask(b'#')]
+            {
+                let want = naive(&re, input, *replacement);
+                let mut out = b"prefix".to_vec();
+                let count = match *replacement {
+                    Replacement::Bytes(b) => {
+                        re.replace_all_into(input, b, &mut out)
+                    }
+                    Replacement::Mask(b) => {
+                        re.mask_all_into(input, b, &mut out)
+                    }
+                };
+                assert_eq!(re.find_iter(input).count(), count, "{}", pattern);
+                assert_eq!(&b"prefix"[..], &out[..6]);
+                assert_eq!(want, &out[6..], "{}", pattern);
+                if let Replacement::Mask(b) = *replacement {
+                    let mut masked = vec![0; input.len()];
+                    re.mask_all_to_slice(input, b, &mut masked);
+                    assert_eq!(want, masked, "{}", pattern);
+                }
+
+                // Any split of the input into writes gives the same output,
+                // since no match contains a newline.
+                for &chunk in &[1, 2, 5, 7, 16, input.len()] {
+                    let mut wtr =
+                        re.replace_writer(*replacement, b'\n', vec![]);
+                    for piece in input.chunks(chunk) {
+                        wtr.write_all(piece).unwrap();
+                    }
+                    let got = wtr.finish().unwrap();
+                    assert_eq!(want, got, "{} {}", pattern, chunk);
+                }
+            }
+        }
+    }
+}
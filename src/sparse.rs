@@ -238,6 +238,12 @@ impl<T: AsRef<[u8]>, S: StateID> SparseDFA<T, S> {
         self.repr().memory_usage()
     }
 
+    /// Returns the total number of states in this DFA, including the dead
+    /// state.
+    pub fn state_count(&self) -> usize {
+        self.repr().state_count
+    }
+
     fn repr(&self) -> &Repr<T, S> {
         match *self {
             SparseDFA::Standard(ref r) => &r.0,
@@ -440,6 +446,11 @@ impl<T: AsRef<[u8]>, S: StateID> DFA for SparseDFA<T, S> {
         self.repr().is_anchored()
     }
 
+    #[inline]
+    fn anchored_start_state(&self) -> Option<S> {
+        self.repr().anchored_start_state()
+    }
+
     #[inline]
     fn next_state(&self, current: S, input: u8) -> S {
         match *self {
@@ -496,6 +507,52 @@ impl<T: AsRef<[u8]>, S: StateID> DFA for SparseDFA<T, S> {
             SparseDFA::__Nonexhaustive => unreachable!(),
         }
     }
+
+    #[inline]
+    fn is_match_anchored_at(&self, bytes: &[u8], start: usize) -> bool {
+        match *self {
+            SparseDFA::Standard(ref r) => r.is_match_anchored_at(bytes, start),
+            SparseDFA::ByteClass(ref r) => {
+                r.is_match_anchored_at(bytes, start)
+            }
+            SparseDFA::__Nonexhaustive => unreachable!(),
+        }
+    }
+
+    #[inline]
+    fn shortest_match_anchored_at(
+        &self,
+        bytes: &[u8],
+        start: usize,
+    ) -> Option<usize> {
+        match *self {
+            SparseDFA::Standard(ref r) => {
+                r.shortest_match_anchored_at(bytes, start)
+            }
+            SparseDFA::ByteClass(ref r) => {
+                r.shortest_match_anchored_at(bytes, start)
+            }
+            SparseDFA::__Nonexhaustive => unreachable!(),
+        }
+    }
+
+    #[inline]
+    fn find_anchored_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        match *self {
+            SparseDFA::Standard(ref r) => r.find_anchored_at(bytes, start),
+            SparseDFA::ByteClass(ref r) => r.find_anchored_at(bytes, start),
+            SparseDFA::__Nonexhaustive => unreachable!(),
+        }
+    }
+
+    #[inline]
+    fn rfind_anchored_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        match *self {
+            SparseDFA::Standard(ref r) => r.rfind_anchored_at(bytes, start),
+            SparseDFA::ByteClass(ref r) => r.rfind_anchored_at(bytes, start),
+            SparseDFA::__Nonexhaustive => unreachable!(),
+        }
+    }
 }
 
 /// A standard sparse DFA that does not use premultiplication or byte classes.
@@ -537,6 +594,11 @@ impl<T: AsRef<[u8]>, S: StateID> DFA for Standard<T, S> {
         self.0.is_anchored()
     }
 
+    #[inline]
+    fn anchored_start_state(&self) -> Option<S> {
+        self.0.anchored_start_state()
+    }
+
     #[inline]
     fn next_state(&self, current: S, input: u8) -> S {
         self.0.state(current).next(input)
@@ -598,6 +660,11 @@ impl<T: AsRef<[u8]>, S: StateID> DFA for ByteClass<T, S> {
         self.0.is_anchored()
     }
 
+    #[inline]
+    fn anchored_start_state(&self) -> Option<S> {
+        self.0.anchored_start_state()
+    }
+
     #[inline]
     fn next_state(&self, current: S, input: u8) -> S {
         let input = self.0.byte_classes.get(input);
@@ -617,6 +684,9 @@ impl<T: AsRef<[u8]>, S: StateID> DFA for ByteClass<T, S> {
 struct Repr<T: AsRef<[u8]>, S: StateID = usize> {
     anchored: bool,
     start: S,
+    /// The start state for anchored searches of an unanchored DFA, if one
+    /// exists. See the corresponding field on dense DFAs for more details.
+    anchored_start: Option<S>,
     state_count: usize,
     max_match: S,
     byte_classes: ByteClasses,
@@ -636,6 +706,7 @@ impl<T: AsRef<[u8]>, S: StateID> Repr<T, S> {
         Repr {
             anchored: self.anchored,
             start: self.start,
+            anchored_start: self.anchored_start,
             state_count: self.state_count,
             max_match: self.max_match,
             byte_classes: self.byte_classes.clone(),
@@ -648,6 +719,7 @@ impl<T: AsRef<[u8]>, S: StateID> Repr<T, S> {
         Repr {
             anchored: self.anchored,
             start: self.start,
+            anchored_start: self.anchored_start,
             state_count: self.state_count,
             max_match: self.max_match,
             byte_classes: self.byte_classes.clone(),
@@ -687,6 +759,14 @@ impl<T: AsRef<[u8]>, S: StateID> Repr<T, S> {
         self.start
     }
 
+    fn anchored_start_state(&self) -> Option<S> {
+        if self.anchored {
+            Some(self.start)
+        } else {
+            self.anchored_start
+        }
+    }
+
     fn is_match_state(&self, id: S) -> bool {
         self.is_match_or_dead_state(id) && !self.is_dead_state(id)
     }
@@ -737,6 +817,7 @@ impl<T: AsRef<[u8]>, S: StateID> Repr<T, S> {
         let mut new = Repr {
             anchored: self.anchored,
             start: map[&self.start],
+            anchored_start: self.anchored_start.map(|id| map[&id]),
             state_count: self.state_count,
             max_match: map[&self.max_match],
             byte_classes: self.byte_classes.clone(),
@@ -767,6 +848,9 @@ impl<T: AsRef<[u8]>, S: StateID> Repr<T, S> {
     #[cfg(feature = "std")]
     fn to_bytes<A: ByteOrder>(&self) -> Result<Vec<u8>> {
         let label = b"rust-regex-automata-sparse-dfa\x00";
+        // As with dense DFAs, version 2 only adds an anchored start state
+        // after the max match state, so it's only written when needed.
+        let version: u16 = if self.anchored_start.is_some() { 2 } else { 1 };
         let size =
             // For human readable label.
             label.len()
@@ -785,6 +869,8 @@ impl<T: AsRef<[u8]>, S: StateID> Repr<T, S> {
             + 8
             // For max match state.
             + 8
+            // For anchored start state (version 2 only).
+            + if version >= 2 { 8 } else { 0 }
             // For byte class map.
             + 256
             // For transition table.
@@ -802,7 +888,7 @@ impl<T: AsRef<[u8]>, S: StateID> Repr<T, S> {
         A::write_u16(&mut buf[i..], 0xFEFF);
         i += 2;
         // version number
-        A::write_u16(&mut buf[i..], 1);
+        A::write_u16(&mut buf[i..], version);
         i += 2;
         // size of state ID
         let state_size = size_of::<S>();
@@ -830,6 +916,11 @@ impl<T: AsRef<[u8]>, S: StateID> Repr<T, S> {
         // max match state
         A::write_u64(&mut buf[i..], self.max_match.to_usize() as u64);
         i += 8;
+        // anchored start state
+        if let Some(id) = self.anchored_start {
+            A::write_u64(&mut buf[i..], id.to_usize() as u64);
+            i += 8;
+        }
         // byte class map
         for b in (0..256).map(|b| b as u8) {
             buf[i] = self.byte_classes.get(b);
@@ -877,9 +968,9 @@ impl<'a, S: StateID> Repr<&'a [u8], S> {
         // check that the version number is supported
         let version = NativeEndian::read_u16(buf);
         buf = &buf[2..];
-        if version != 1 {
+        if version != 1 && version != 2 {
             panic!(
-                "expected version 1, but found unsupported version {}",
+                "expected version 1 or 2, but found unsupported version {}",
                 version,
             );
         }
@@ -912,6 +1003,15 @@ impl<'a, S: StateID> Repr<&'a [u8], S> {
         let max_match = S::from_usize(NativeEndian::read_u64(buf) as usize);
         buf = &buf[8..];
 
+        // read anchored start state, if present
+        let anchored_start = if version >= 2 {
+            let id = S::from_usize(NativeEndian::read_u64(buf) as usize);
+            buf = &buf[8..];
+            Some(id)
+        } else {
+            None
+        };
+
         // read byte classes
         let byte_classes = ByteClasses::from_slice(&buf[..256]);
         buf = &buf[256..];
@@ -919,6 +1019,7 @@ impl<'a, S: StateID> Repr<&'a [u8], S> {
         Repr {
             anchored: opts & dense::MASK_ANCHORED > 0,
             start,
+            anchored_start,
             state_count,
             max_match,
             byte_classes,
@@ -933,6 +1034,11 @@ impl<S: StateID> Repr<Vec<u8>, S> {
     fn from_dense_sized<T: AsRef<[S]>, A: StateID>(
         dfa: &dense::Repr<T, S>,
     ) -> Result<Repr<Vec<u8>, A>> {
+        // A sparse DFA has no room for a quit state between its dead state
+        // and its match states.
+        if dfa.has_quit() {
+            return Err(Error::unsupported_quit());
+        }
         // In order to build the transition table, we need to be able to write
         // state identifiers for each of the "next" transitions in each state.
         // Our state identifiers correspond to the byte offset in the
@@ -977,6 +1083,12 @@ impl<S: StateID> Repr<Vec<u8>, S> {
         let mut new = Repr {
             anchored: dfa.is_anchored(),
             start: remap[dfa.state_id_to_index(dfa.start_state())],
+            anchored_start: match dfa.anchored_start_state() {
+                Some(id) if !dfa.is_anchored() => {
+                    Some(remap[dfa.state_id_to_index(id)])
+                }
+                _ => None,
+            },
             state_count: dfa.state_count(),
             max_match: remap[dfa.state_id_to_index(dfa.max_match_state())],
             byte_classes: dfa.byte_classes().clone(),
@@ -1026,6 +1138,12 @@ impl<T: AsRef<[u8]>, S: StateID> fmt::Debug for Repr<T, S> {
                 } else {
                     "> "
                 }
+            } else if Some(id) == dfa.anchored_start {
+                if dfa.is_match_state(id) {
+                    "^*"
+                } else {
+                    "^ "
+                }
             } else {
                 if dfa.is_match_state(id) {
                     " *"
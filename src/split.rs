@@ -0,0 +1,280 @@
+use std::mem;
+use std::ptr;
+
+use byte_set::ByteSet;
+use dense::DenseDFA;
+use dfa::DFA;
+use regex::Regex;
+
+/// The number of bytes in a `usize`.
+const WORD: usize = mem::size_of::<usize>();
+
+/// A `usize` with every byte set to `0x01`.
+const LOW_BITS: usize = ::std::usize::MAX / 0xFF;
+
+/// A `usize` with the high bit of every byte set.
+const HIGH_BITS: usize = LOW_BITS * 0x80;
+
+/// The largest number of delimiter bytes searched for a word at a time.
+const MAX_WORD_NEEDLES: usize = 3;
+
+/// Splits texts into fields separated by the matches of a regex.
+///
+/// This reports the same fields as
+/// [`Regex::splitn`](struct.Regex.html#method.splitn), as offsets rather
+/// than slices, so that they can be handed across a foreign function
+/// interface in one call.
+///
+/// Many delimiters, such as `,` or `[\t;|]`, match exactly one byte from a
+/// fixed set. A `Splitter` detects such regexes when it is built, and then
+/// finds delimiters by scanning for those bytes directly instead of running
+/// the regex's DFAs. Sets of up to three bytes are scanned a word at a time.
+///
+/// # Example
+///
+/// ```
+/// use regex_automata::{Regex, Splitter};
+///
+/// # fn example() -> Result<(), regex_automata::Error> {
+/// let splitter = Splitter::new(Regex::new("[,;]")?);
+/// assert!(splitter.is_byte_set());
+///
+/// let (mut starts, mut ends) = ([0; 8], [0; 8]);
+/// let n = splitter.fields(b"a,bc;;d", &mut starts, &mut ends);
+/// assert_eq!(&starts[..n], &[0, 2, 5, 6]);
+/// assert_eq!(&ends[..n], &[1, 4, 5, 7]);
+/// # Ok(()) }; example().unwrap()
+/// ```
+#[derive(Clone, Debug)]
+pub struct Splitter<D: DFA = DenseDFA<Vec<usize>, usize>> {
+    re: Regex<D>,
+    delimiters: Option<Delimiters>,
+}
+
+/// The bytes a regex matches, when each of its matches is a single byte.
+#[derive(Clone, Debug)]
+struct Delimiters {
+    set: ByteSet,
+    /// The bytes in `set`, if there are at most `MAX_WORD_NEEDLES` of them.
+    needles: Vec<u8>,
+}
+
+impl<D: DFA> Splitter<D> {
+    /// Build a splitter for the given regex.
+    pub fn new(re: Regex<D>) -> Splitter<D> {
+        let delimiters = single_byte_set(&re).map(|set| {
+            let needles: Vec<u8> = (0..256)
+                .map(|b| b as u8)
+                .filter(|&b| set.contains(b))
+                .collect();
+            Delimiters {
+                set,
+                needles: if needles.len() <= MAX_WORD_NEEDLES {
+                    needles
+                } else {
+                    vec![]
+                },
+            }
+        });
+        Splitter { re, delimiters }
+    }
+
+    /// Return the regex whose matches separate fields.
+    pub fn regex(&self) -> &Regex<D> {
+        &self.re
+    }
+
+    /// Returns true if and only if every match of the regex is a single byte
+    /// from a fixed set, in which case delimiters are found by scanning for
+    /// those bytes.
+    pub fn is_byte_set(&self) -> bool {
+        self.delimiters.is_some()
+    }
+
+    /// Write the start and end offsets of the fields of `input` to `starts`
+    /// and `ends`, and return the number of fields written.
+    ///
+    /// The fields are those yielded by `Regex::splitn` with a limit of
+    /// `min(starts.len(), ends.len())`. In particular, when there are more
+    /// fields than that, the last field written covers all of the remaining
+    /// input.
+    pub fn fields(
+        &self,
+        input: &[u8],
+        starts: &mut [usize],
+        ends: &mut [usize],
+    ) -> usize {
+        let limit = ::std::cmp::min(starts.len(), ends.len());
+        if limit == 0 {
+            return 0;
+        }
+        let (mut count, mut last) = (0, 0);
+        match self.delimiters {
+            Some(ref delims) => {
+                while count + 1 < limit {
+                    let i = match delims.find(input, last) {
+                        None => break,
+                        Some(i) => i,
+                    };
+                    starts[count] = last;
+                    ends[count] = i;
+                    count += 1;
+                    last = i + 1;
+                }
+            }
+            None => {
+                for (s, e) in self.re.find_iter(input) {
+                    if count + 1 == limit {
+                        break;
+                    }
+                    starts[count] = last;
+                    ends[count] = s;
+                    count += 1;
+                    last = e;
+                }
+            }
+        }
+        starts[count] = last;
+        ends[count] = input.len();
+        count + 1
+    }
+}
+
+impl Delimiters {
+    /// Returns the offset of the first delimiter in `haystack[at..]`.
+    fn find(&self, haystack: &[u8], mut at: usize) -> Option<usize> {
+        if !self.needles.is_empty() {
+            // Skip words that contain none of the needles. A word contains
+            // a needle if XORing it with the needle repeated in every byte
+            // leaves a zero byte.
+            let mut reps = [0; MAX_WORD_NEEDLES];
+            for (rep, &b) in reps.iter_mut().zip(&self.needles) {
+                *rep = LOW_BITS * b as usize;
+            }
+            let reps = &reps[..self.needles.len()];
+            while at + WORD <= haystack.len() {
+                let word = unsafe {
+                    let p = haystack.as_ptr().add(at) as *const usize;
+                    ptr::read_unaligned(p)
+                };
+                if reps.iter().any(|&rep| has_zero_byte(word ^ rep)) {
+                    break;
+                }
+                at += WORD;
+            }
+        }
+        haystack[at..]
+            .iter()
+            .position(|&b| self.set.contains(b))
+            .map(|i| at + i)
+    }
+}
+
+/// Returns true if and only if some byte of `x` is zero.
+fn has_zero_byte(x: usize) -> bool {
+    x.wrapping_sub(LOW_BITS) & !x & HIGH_BITS != 0
+}
+
+/// Return the set of bytes matched by the given regex, if every match of it
+/// is exactly one byte from that set.
+///
+/// The reverse DFA reads a match starting from its last byte. For such a
+/// regex, every byte leads its start state either to the dead state or to a
+/// match state, and every byte leads each of those match states to the dead
+/// state.
+fn single_byte_set<D: DFA>(re: &Regex<D>) -> Option<ByteSet> {
+    let (fwd, rev) = (re.forward(), re.reverse());
+    let start = rev.start_state();
+    if fwd.is_anchored()
+        || fwd.is_match_or_dead_state(fwd.start_state())
+        || rev.is_match_or_dead_state(start)
+    {
+        return None;
+    }
+    let mut set = ByteSet::empty();
+    let mut checked = vec![];
+    for b in 0..256 {
+        let next = rev.next_state(start, b as u8);
+        if rev.is_dead_state(next) {
+            continue;
+        }
+        if !rev.is_match_state(next) {
+            return None;
+        }
+        if !checked.contains(&next) {
+            for b2 in 0..256 {
+                if !rev.is_dead_state(rev.next_state(next, b2 as u8)) {
+                    return None;
+                }
+            }
+            checked.push(next);
+        }
+        set.add(b as u8);
+    }
+    if set.is_empty() {
+        None
+    } else {
+        Some(set)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::Splitter;
+    use regex::{Regex, RegexBuilder};
+
+    #[test]
+    fn detects_byte_sets() {
+        for pattern in &[",", "[,;]", r"[\t |]", r"[\x00-\x7F]", "[[:punct:]]"]
+        {
+            let re = Regex::new(pattern).unwrap();
+            assert!(Splitter::new(re).is_byte_set(), "{}", pattern);
+        }
+        for pattern in &[",,", ",+", ",?", r"\s", "é", "[é,]", "a|bc"] {
+            let re = Regex::new(pattern).unwrap();
+            assert!(!Splitter::new(re).is_byte_set(), "{}", pattern);
+        }
+        let re = RegexBuilder::new().anchored(true).build(",").unwrap();
+        assert!(!Splitter::new(re).is_byte_set());
+    }
+
+    #[test]
+    fn same_as_splitn() {
+        let long = "field,".repeat(40) + ";x|y\t\tz,";
+        let inputs =
+            &["", ",", ",,", "a", "a,b", ",a,", "a;b|c,,d ", &long[..]];
+        let patterns = &[",", "[,;|]", "[,;| \t]", r"[\t ]+", ",*", r"\|"];
+        for pattern in patterns {
+            let re = Regex::new(pattern).unwrap();
+            let splitter = Splitter::new(re.clone());
+            for input in inputs {
+                let input = input.as_bytes();
+                for limit in 0..50 {
+                    let want: Vec<&[u8]> = re.splitn(input, limit).collect();
+                    let mut starts = vec![0; limit];
+                    let mut ends = vec![0; limit + 3];
+                    let n = splitter.fields(input, &mut starts, &mut ends);
+                    let got: Vec<&[u8]> =
+                        (0..n).map(|i| &input[starts[i]..ends[i]]).collect();
+                    assert_eq!(want, got, "{} {}", pattern, limit);
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn split_yields_parts_between_matches() {
+        let re = Regex::new(",").unwrap();
+        let parts: Vec<&[u8]> = re.split(b",a,,b,").collect();
+        assert_eq!(parts, vec![&b""[..], b"a", b"", b"b", b""]);
+        let parts: Vec<&[u8]> = re.split(b"").collect();
+        assert_eq!(parts, vec![&b""[..]]);
+
+        // The empty match following "xx" is skipped, like in find_iter.
+        let re = Regex::new("x*").unwrap();
+        let parts: Vec<&[u8]> = re.split(b"axxb").collect();
+        assert_eq!(parts, vec![&b""[..], b"a", b"b", b""]);
+        let parts: Vec<&[u8]> = re.splitn(b"axxb", 2).collect();
+        assert_eq!(parts, vec![&b""[..], b"axxb"]);
+    }
+}
@@ -0,0 +1,434 @@
+use std::mem;
+
+use classes::ByteClasses;
+use dense::DenseDFA;
+use dfa::DFA;
+use state_id::StateID;
+
+/// The default maximum number of entries, `alphabet_len^2 * state_count`, in
+/// the pair table of a stride-2 DFA.
+pub const DEFAULT_STRIDE2_BUDGET: usize = 1 << 14;
+
+/// A DFA that follows two bytes of a haystack with each table lookup.
+///
+/// Searching with a DFA is a chain of dependent loads: the next transition
+/// can only be looked up once the current one is known. A stride-2 DFA has a
+/// table with a transition for every state and every *pair* of equivalence
+/// classes, which leads directly to the state reached after both bytes.
+/// This halves the length of the chain, which is what bounds the throughput
+/// of a DFA that fits in cache.
+///
+/// The pair table has `alphabet_len^2` entries for each state, so a stride-2
+/// DFA is only worth building for small DFAs with few equivalence classes,
+/// such as minimized DFAs for simple ASCII patterns. It is built from a
+/// dense DFA with [`Stride2DFA::from_dense`](#method.from_dense), which only
+/// succeeds when the pair table fits within a budget.
+///
+/// A stride-2 DFA reports precisely the same matches as the dense DFA it was
+/// built from. Whenever the first byte of a pair leads to a match or dead
+/// state, the pair is followed one byte at a time instead, so that the
+/// position of a match is never skipped. A trailing odd byte is also
+/// followed on its own.
+///
+/// # Example
+///
+/// ```
+/// use regex_automata::{dense, Stride2DFA, DFA};
+///
+/// # fn example() -> Result<(), regex_automata::Error> {
+/// let dense = dense::Builder::new().minimize(true).build("[0-9]+")?;
+/// let dfa = Stride2DFA::from_dense(&dense, 1 << 16).unwrap();
+/// assert_eq!(Some(6), dfa.find(b"foo123"));
+/// assert_eq!(Some(5), dfa.find(b"foo12"));
+/// # Ok(()) }; example().unwrap()
+/// ```
+#[derive(Clone, Debug)]
+pub struct Stride2DFA<S: StateID = usize> {
+    /// The transitions of each state, in rows of `pair_len + alphabet_len`.
+    /// A row starts with the transitions on pairs of classes, followed by
+    /// the transitions on single classes. When the first class of a pair
+    /// leads to a match or dead state, the pair's entry is that state
+    /// instead of the state reached after both.
+    ///
+    /// State identifiers are premultiplied by the length of a row, so
+    /// following either a pair or a single class needs no multiplication or
+    /// division.
+    trans: Vec<S>,
+    classes: ByteClasses,
+    alphabet_len: usize,
+    /// The number of transitions on pairs of classes in a row,
+    /// `alphabet_len^2`, which is also the offset of the transitions on
+    /// single classes.
+    pair_len: usize,
+    /// The length of a row, `pair_len + alphabet_len`.
+    row_len: usize,
+    start: S,
+    anchored_start: Option<S>,
+    max_match: S,
+    /// The quit state of the dense DFA, or the dead state if it has none.
+    quit: S,
+    anchored: bool,
+}
+
+impl<S: StateID> Stride2DFA<S> {
+    /// Build a stride-2 DFA that reports the same matches as the given dense
+    /// DFA.
+    ///
+    /// If `alphabet_len^2 * state_count` of the dense DFA exceeds the given
+    /// budget, or if the premultiplied identifiers of its states cannot be
+    /// represented by `S`, then this returns `None`.
+    pub fn from_dense<T: AsRef<[S]>>(
+        dense: &DenseDFA<T, S>,
+        budget: usize,
+    ) -> Option<Stride2DFA<S>> {
+        let repr = dense.repr();
+        let alphabet_len = repr.alphabet_len();
+        let pair_len = alphabet_len * alphabet_len;
+        let row_len = pair_len + alphabet_len;
+        let entries = pair_len
+            .checked_mul(repr.state_count())
+            .unwrap_or(::std::usize::MAX);
+        if entries > budget {
+            return None;
+        }
+        match (repr.state_count() - 1).checked_mul(row_len) {
+            Some(max_id) if max_id <= S::max_id() => {}
+            _ => return None,
+        }
+
+        // The dense DFA's states keep their order. In particular, the match
+        // states still directly follow the dead state.
+        let index =
+            |id: S| S::from_usize(repr.state_id_to_index(id) * row_len);
+        let reps: Vec<u8> = repr.byte_classes().representatives().collect();
+        let mut trans = Vec::with_capacity(repr.state_count() * row_len);
+        let mut max_match = index(repr.quit_state());
+        for (id, _) in repr.states() {
+            if dense.is_match_state(id) {
+                max_match = index(id);
+            }
+            for &b1 in &reps {
+                let mid = dense.next_state(id, b1);
+                for &b2 in &reps {
+                    trans.push(if dense.is_match_or_dead_state(mid) {
+                        index(mid)
+                    } else {
+                        index(dense.next_state(mid, b2))
+                    });
+                }
+            }
+            for &b1 in &reps {
+                trans.push(index(dense.next_state(id, b1)));
+            }
+        }
+        Some(Stride2DFA {
+            trans,
+            classes: repr.byte_classes().clone(),
+            alphabet_len,
+            pair_len,
+            row_len,
+            start: index(dense.start_state()),
+            anchored_start: dense.anchored_start_state().map(index),
+            max_match,
+            quit: index(repr.quit_state()),
+            anchored: dense.is_anchored(),
+        })
+    }
+
+    /// Returns the number of states in this DFA.
+    pub fn state_count(&self) -> usize {
+        self.trans.len() / self.row_len
+    }
+
+    /// Returns the memory usage, in bytes, of this DFA's transitions.
+    pub fn memory_usage(&self) -> usize {
+        self.trans.len() * mem::size_of::<S>()
+    }
+
+    /// Return the state reached from `current` after the given pair of
+    /// bytes, or the state reached after the first byte if that is a match
+    /// or dead state.
+    #[inline(always)]
+    unsafe fn next_pair_unchecked(&self, current: S, b1: u8, b2: u8) -> S {
+        let c1 = self.classes.get_unchecked(b1) as usize;
+        let c2 = self.classes.get_unchecked(b2) as usize;
+        let o = current.to_usize() + c1 * self.alphabet_len + c2;
+        *self.trans.get_unchecked(o)
+    }
+
+    /// Return the offset of the given state's transitions on single classes.
+    #[inline(always)]
+    fn row(&self, id: S) -> usize {
+        id.to_usize() + self.pair_len
+    }
+
+    /// Search forward from the given state, two bytes at a time, and return
+    /// the end of the leftmost first match. When `earliest` is true, this
+    /// returns as soon as a match or dead state is entered, like
+    /// `DFA::shortest_match_at`.
+    #[inline(always)]
+    fn find_fwd(
+        &self,
+        mut state: S,
+        bytes: &[u8],
+        start: usize,
+        earliest: bool,
+    ) -> Option<usize> {
+        if self.is_dead_state(state) {
+            return None;
+        }
+        let mut last_match = None;
+        if self.is_match_state(state) {
+            if earliest {
+                return Some(start);
+            }
+            last_match = Some(start);
+        }
+        let mut at = start;
+        while at < bytes.len() {
+            if at + 1 < bytes.len() {
+                let next = unsafe {
+                    self.next_pair_unchecked(state, bytes[at], bytes[at + 1])
+                };
+                if !self.is_match_or_dead_state(next) {
+                    state = next;
+                    at += 2;
+                    continue;
+                }
+            }
+            // Either this is the last byte, or a match or dead state was
+            // entered after one of the two bytes. Follow the first byte on
+            // its own to find out which.
+            state = unsafe { self.next_state_unchecked(state, bytes[at]) };
+            at += 1;
+            if self.is_match_or_dead_state(state) {
+                if self.is_dead_state(state) {
+                    return last_match;
+                }
+                if earliest {
+                    return Some(at);
+                }
+                last_match = Some(at);
+            }
+        }
+        last_match
+    }
+
+    /// Search backward from the given state, two bytes at a time, and return
+    /// the start of the longest match, like `DFA::rfind_at`.
+    #[inline(always)]
+    fn find_rev(
+        &self,
+        mut state: S,
+        bytes: &[u8],
+        start: usize,
+    ) -> Option<usize> {
+        let mut last_match = if self.is_dead_state(state) {
+            return None;
+        } else if self.is_match_state(state) {
+            Some(start)
+        } else {
+            None
+        };
+        let mut at = start;
+        while at > 0 {
+            if at > 1 {
+                let next = unsafe {
+                    self.next_pair_unchecked(
+                        state,
+                        bytes[at - 1],
+                        bytes[at - 2],
+                    )
+                };
+                if !self.is_match_or_dead_state(next) {
+                    state = next;
+                    at -= 2;
+                    continue;
+                }
+            }
+            at -= 1;
+            state = unsafe { self.next_state_unchecked(state, bytes[at]) };
+            if self.is_match_or_dead_state(state) {
+                if self.is_dead_state(state) {
+                    return last_match;
+                }
+                last_match = Some(at);
+            }
+        }
+        last_match
+    }
+}
+
+impl<S: StateID> DFA for Stride2DFA<S> {
+    type ID = S;
+
+    #[inline]
+    fn start_state(&self) -> S {
+        self.start
+    }
+
+    #[inline]
+    fn is_match_state(&self, id: S) -> bool {
+        id <= self.max_match && id > self.quit
+    }
+
+    #[inline]
+    fn is_dead_state(&self, id: S) -> bool {
+        id <= self.quit
+    }
+
+    #[inline]
+    fn is_match_or_dead_state(&self, id: S) -> bool {
+        id <= self.max_match
+    }
+
+    #[inline]
+    fn is_anchored(&self) -> bool {
+        self.anchored
+    }
+
+    #[inline]
+    fn anchored_start_state(&self) -> Option<S> {
+        if self.anchored {
+            Some(self.start)
+        } else {
+            self.anchored_start
+        }
+    }
+
+    #[inline]
+    fn next_state(&self, current: S, input: u8) -> S {
+        let class = self.classes.get(input) as usize;
+        self.trans[self.row(current) + class]
+    }
+
+    #[inline]
+    unsafe fn next_state_unchecked(&self, current: S, input: u8) -> S {
+        let class = self.classes.get_unchecked(input) as usize;
+        *self.trans.get_unchecked(self.row(current) + class)
+    }
+
+    // The following methods are specialized to search two bytes at a time.
+
+    #[inline]
+    fn is_match_at(&self, bytes: &[u8], start: usize) -> bool {
+        self.shortest_match_at(bytes, start).is_some()
+    }
+
+    #[inline]
+    fn shortest_match_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        if self.anchored && start > 0 {
+            return None;
+        }
+        self.find_fwd(self.start, bytes, start, true)
+    }
+
+    #[inline]
+    fn find_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        if self.anchored && start > 0 {
+            return None;
+        }
+        self.find_fwd(self.start, bytes, start, false)
+    }
+
+    #[inline]
+    fn rfind_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        if self.anchored && start < bytes.len() {
+            return None;
+        }
+        self.find_rev(self.start, bytes, start)
+    }
+
+    #[inline]
+    fn is_match_anchored_at(&self, bytes: &[u8], start: usize) -> bool {
+        self.shortest_match_anchored_at(bytes, start).is_some()
+    }
+
+    #[inline]
+    fn shortest_match_anchored_at(
+        &self,
+        bytes: &[u8],
+        start: usize,
+    ) -> Option<usize> {
+        let state = self.anchored_start_state().expect(NO_ANCHORED_START);
+        self.find_fwd(state, bytes, start, true)
+    }
+
+    #[inline]
+    fn find_anchored_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        let state = self.anchored_start_state().expect(NO_ANCHORED_START);
+        self.find_fwd(state, bytes, start, false)
+    }
+
+    #[inline]
+    fn rfind_anchored_at(&self, bytes: &[u8], start: usize) -> Option<usize> {
+        let state = self.anchored_start_state().expect(NO_ANCHORED_START);
+        self.find_rev(state, bytes, start)
+    }
+}
+
+const NO_ANCHORED_START: &str = "DFA has no anchored start state";
+
+#[cfg(test)]
+mod tests {
+    use super::Stride2DFA;
+    use dense::{self, DenseDFA};
+    use dfa::DFA;
+
+    #[test]
+    fn same_as_dense() {
+        let patterns = &[r"[0-9]+", r"(?-u:\w+@\w+)", r"ab|abcd", r"a*", r""];
+        let haystacks: &[&[u8]] = &[
+            b"",
+            b"1",
+            b"abc 123",
+            b"me@example x",
+            b"zabcd abc",
+            b"\xFFaab",
+        ];
+        for &minimize in &[false, true] {
+            for &anchored in &[false, true] {
+                for &pattern in patterns {
+                    let dense: DenseDFA<Vec<u32>, u32> = dense::Builder::new()
+                        .minimize(minimize)
+                        .anchored(anchored)
+                        .dual_start(true)
+                        .build_with_size(pattern)
+                        .unwrap();
+                    let dfa = Stride2DFA::from_dense(&dense, 1 << 20).unwrap();
+                    assert_eq!(dense.state_count(), dfa.state_count());
+                    for &haystack in haystacks {
+                        for at in 0..haystack.len() + 1 {
+                            assert_eq!(
+                                dense.find_at(haystack, at),
+                                dfa.find_at(haystack, at),
+                                "{:?} on {:?} at {}",
+                                pattern,
+                                haystack,
+                                at,
+                            );
+                            assert_eq!(
+                                dense.shortest_match_at(haystack, at),
+                                dfa.shortest_match_at(haystack, at),
+                            );
+                            assert_eq!(
+                                dense.rfind_at(haystack, at),
+                                dfa.rfind_at(haystack, at),
+                            );
+                            assert_eq!(
+                                dense.find_anchored_at(haystack, at),
+                                dfa.find_anchored_at(haystack, at),
+                            );
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn respects_budget() {
+        let dense = DenseDFA::new(r"\w+").unwrap();
+        assert!(Stride2DFA::from_dense(&dense, 1 << 16).is_none());
+    }
+}
@@ -0,0 +1,317 @@
+/*!
+Optional tracing of DFA state and transition visits.
+
+When the `trace` feature is enabled, every search routine on the
+[`DFA`](trait.DFA.html) trait reports each state it starts in and each
+transition it follows to a recorder installed on the current thread via
+[`Trace::record`](struct.Trace.html#method.record). When the feature is
+disabled, the hooks in the search loops expand to nothing, so there is no
+overhead.
+
+State identifiers are reported exactly as the DFA uses them. For
+premultiplied dense DFAs, this means identifiers are premultiplied, which
+matches the identifiers printed by the DFA's `Debug` implementation.
+*/
+
+// The hooks used by search routines. These are always defined so that
+// callers need not be littered with `cfg` attributes.
+
+#[cfg(feature = "trace")]
+macro_rules! trace_start {
+    ($id:expr) => {
+        ::trace::start(::state_id::StateID::to_usize($id))
+    };
+}
+
+#[cfg(not(feature = "trace"))]
+macro_rules! trace_start {
+    ($id:expr) => {};
+}
+
+#[cfg(feature = "trace")]
+macro_rules! trace_transition {
+    ($from:expr, $byte:expr, $to:expr) => {
+        ::trace::transition(
+            ::state_id::StateID::to_usize($from),
+            $byte,
+            ::state_id::StateID::to_usize($to),
+        )
+    };
+}
+
+#[cfg(not(feature = "trace"))]
+macro_rules! trace_transition {
+    ($from:expr, $byte:expr, $to:expr) => {};
+}
+
+#[cfg(feature = "trace")]
+pub use self::imp::*;
+
+#[cfg(feature = "trace")]
+mod imp {
+    use std::cell::RefCell;
+    use std::collections::{BTreeMap, HashMap};
+    use std::fmt::Write;
+    use std::mem;
+
+    thread_local! {
+        static RECORDER: RefCell<Option<Trace>> = RefCell::new(None);
+    }
+
+    /// Visit counts for the states and transitions of a DFA, collected while
+    /// searching.
+    ///
+    /// A state's visit count is the number of times a search started in it
+    /// or transitioned into it. A transition's count is the number of times
+    /// it was followed, keyed by `(from, byte, to)`.
+    #[derive(Clone, Debug, Default)]
+    pub struct Trace {
+        states: HashMap<usize, u64>,
+        transitions: HashMap<(usize, u8, usize), u64>,
+    }
+
+    impl Trace {
+        /// Run the given closure while recording every DFA search it
+        /// performs on the current thread, and return its result along with
+        /// the collected trace.
+        ///
+        /// Calls may be nested. An inner call records only the searches
+        /// performed by its own closure.
+        ///
+        /// # Example
+        ///
+        /// ```
+        /// use regex_automata::{DenseDFA, Trace, DFA};
+        ///
+        /// # fn example() -> Result<(), regex_automata::Error> {
+        /// let dfa = DenseDFA::new("foo[0-9]+")?;
+        /// let (m, trace) = Trace::record(|| dfa.find(b"foo12345"));
+        /// assert_eq!(Some(8), m);
+        /// // The start state, plus one state entered per byte.
+        /// assert_eq!(9, trace.states().values().sum::<u64>());
+        /// # Ok(()) }; example().unwrap()
+        /// ```
+        pub fn record<T, F: FnOnce() -> T>(f: F) -> (T, Trace) {
+            let saved = RECORDER.with(|r| {
+                mem::replace(&mut *r.borrow_mut(), Some(Trace::default()))
+            });
+            let restore = Restore(saved);
+            let result = f();
+            let trace = RECORDER.with(|r| r.borrow_mut().take()).unwrap();
+            drop(restore);
+            (result, trace)
+        }
+
+        /// Returns the visit count of every visited state, ordered by state
+        /// identifier.
+        pub fn states(&self) -> BTreeMap<usize, u64> {
+            self.states.iter().map(|(&id, &n)| (id, n)).collect()
+        }
+
+        /// Returns the number of times each followed transition was taken,
+        /// ordered by `(from, byte, to)`.
+        pub fn transitions(&self) -> BTreeMap<(usize, u8, usize), u64> {
+            self.transitions.iter().map(|(&t, &n)| (t, n)).collect()
+        }
+
+        /// Add the counts from another trace into this one.
+        pub fn merge(&mut self, other: &Trace) {
+            for (&id, &n) in &other.states {
+                *self.states.entry(id).or_insert(0) += n;
+            }
+            for (&t, &n) in &other.transitions {
+                *self.transitions.entry(t).or_insert(0) += n;
+            }
+        }
+
+        /// Render this trace as a JSON object with `states` and
+        /// `transitions` arrays.
+        pub fn to_json(&self) -> String {
+            let mut out = String::new();
+            out.push_str("{\n  \"states\": [");
+            for (i, (id, n)) in self.states().into_iter().enumerate() {
+                if i > 0 {
+                    out.push(',');
+                }
+                write!(out, "\n    {{\"id\": {}, \"visits\": {}}}", id, n)
+                    .unwrap();
+            }
+            out.push_str("\n  ],\n  \"transitions\": [");
+            for (i, ((from, byte, to), n)) in
+                self.transitions().into_iter().enumerate()
+            {
+                if i > 0 {
+                    out.push(',');
+                }
+                write!(
+                    out,
+                    "\n    {{\"from\": {}, \"byte\": {}, \"to\": {}, \
+                     \"count\": {}}}",
+                    from, byte, to, n
+                )
+                .unwrap();
+            }
+            out.push_str("\n  ]\n}\n");
+            out
+        }
+
+        /// Render this trace as a Graphviz DOT digraph. Transitions between
+        /// the same pair of states are collapsed into a single edge labeled
+        /// with the bytes that were seen and the total count.
+        pub fn to_dot(&self) -> String {
+            let mut edges: BTreeMap<(usize, usize), (Vec<u8>, u64)> =
+                BTreeMap::new();
+            for ((from, byte, to), n) in self.transitions() {
+                let edge = edges.entry((from, to)).or_insert((vec![], 0));
+                edge.0.push(byte);
+                edge.1 += n;
+            }
+
+            let mut out = String::new();
+            out.push_str("digraph dfa {\n");
+            for (id, n) in self.states() {
+                writeln!(out, "  {} [label=\"{}\\n{}\"];", id, id, n).unwrap();
+            }
+            for ((from, to), (bytes, n)) in edges {
+                writeln!(
+                    out,
+                    "  {} -> {} [label=\"{} ({})\"];",
+                    from,
+                    to,
+                    escape_bytes(&bytes),
+                    n
+                )
+                .unwrap();
+            }
+            out.push_str("}\n");
+            out
+        }
+    }
+
+    /// Reinstalls the recorder that `Trace::record` replaced when dropped,
+    /// so that it is reinstalled even if the closure given to `record`
+    /// panics.
+    struct Restore(Option<Trace>);
+
+    impl Drop for Restore {
+        fn drop(&mut self) {
+            let saved = self.0.take();
+            RECORDER.with(|r| *r.borrow_mut() = saved);
+        }
+    }
+
+    pub(crate) fn start(id: usize) {
+        RECORDER.with(|r| {
+            if let Some(ref mut trace) = *r.borrow_mut() {
+                *trace.states.entry(id).or_insert(0) += 1;
+            }
+        });
+    }
+
+    pub(crate) fn transition(from: usize, byte: u8, to: usize) {
+        RECORDER.with(|r| {
+            if let Some(ref mut trace) = *r.borrow_mut() {
+                *trace.states.entry(to).or_insert(0) += 1;
+                *trace.transitions.entry((from, byte, to)).or_insert(0) += 1;
+            }
+        });
+    }
+
+    /// Render a sorted set of bytes compactly as ranges, escaping
+    /// characters that are special in DOT labels.
+    fn escape_bytes(bytes: &[u8]) -> String {
+        fn escape(b: u8) -> String {
+            match b {
+                b'"' => "\\\"".to_string(),
+                b'\\' => "\\\\".to_string(),
+                b' '..=b'~' => (b as char).to_string(),
+                _ => format!("\\\\x{:02X}", b),
+            }
+        }
+
+        let mut out = String::new();
+        let mut i = 0;
+        while i < bytes.len() {
+            let start = bytes[i];
+            let mut end = start;
+            while i + 1 < bytes.len() && bytes[i + 1] == end.wrapping_add(1) {
+                i += 1;
+                end = bytes[i];
+            }
+            if !out.is_empty() {
+                out.push(' ');
+            }
+            if start == end {
+                out.push_str(&escape(start));
+            } else {
+                out.push_str(&escape(start));
+                out.push('-');
+                out.push_str(&escape(end));
+            }
+            i += 1;
+        }
+        out
+    }
+
+    #[cfg(test)]
+    mod tests {
+        use super::Trace;
+        use dense;
+        use dfa::DFA;
+
+        #[test]
+        fn counts_states_and_transitions() {
+            let dfa = dense::Builder::new()
+                .anchored(true)
+                .premultiply(false)
+                .byte_classes(false)
+                .build("ab")
+                .unwrap();
+            let start = dfa.start_state();
+            let ((), trace) = Trace::record(|| {
+                assert_eq!(Some(2), dfa.find(b"ab"));
+                assert_eq!(Some(2), dfa.find(b"ab"));
+            });
+            let states = trace.states();
+            assert_eq!(Some(&2), states.get(&start));
+            assert_eq!(6, states.values().sum::<u64>());
+
+            let transitions = trace.transitions();
+            assert_eq!(2, transitions.len());
+            assert!(transitions.values().all(|&n| n == 2));
+            assert!(trace.to_dot().contains("[label=\"a (2)\"]"));
+            assert!(trace.to_json().contains("\"byte\": 98"));
+        }
+
+        #[test]
+        fn nested() {
+            let dfa = dense::Builder::new().anchored(true).build("a").unwrap();
+            let (inner, outer) = Trace::record(|| {
+                dfa.find(b"a");
+                Trace::record(|| dfa.find(b"a")).1
+            });
+            assert_eq!(2, outer.states().values().sum::<u64>());
+            assert_eq!(2, inner.states().values().sum::<u64>());
+        }
+
+        #[test]
+        fn restores_recorder_after_panic() {
+            use std::panic::{catch_unwind, AssertUnwindSafe};
+
+            let dfa = dense::Builder::new().anchored(true).build("a").unwrap();
+            let ((), outer) = Trace::record(|| {
+                let inner = catch_unwind(AssertUnwindSafe(|| {
+                    Trace::record(|| {
+                        dfa.find(b"a");
+                        panic!("search failed");
+                    })
+                }));
+                assert!(inner.is_err());
+                dfa.find(b"a");
+            });
+            assert_eq!(2, outer.states().values().sum::<u64>());
+            // No recorder is left installed once the outermost call returns.
+            assert!(super::RECORDER.with(|r| r.borrow().is_none()));
+        }
+    }
+}
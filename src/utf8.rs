@@ -0,0 +1,313 @@
+use core::cmp;
+use core::fmt;
+use core::mem;
+use core::ptr;
+
+use dfa::DFA;
+
+/// The number of bytes validated at a time by a fused search. Validation runs
+/// ahead of the DFA by at most this many bytes, which keeps the bytes being
+/// searched in cache after they've been validated.
+const CHUNK: usize = 4 * 1024;
+
+/// The number of bytes in a word, which is the unit of the ASCII fast path.
+const WORD: usize = mem::size_of::<usize>();
+
+/// A word with the most significant bit of each of its bytes set.
+const HIGH_BITS: usize = ::core::usize::MAX / 0xFF * 0x80;
+
+/// An error that occurs when a haystack searched with a fused UTF-8
+/// validating search is not valid UTF-8.
+///
+/// This is returned by the iterator produced by
+/// [`Regex::find_iter_validated`](struct.Regex.html#method.find_iter_validated).
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+pub struct Utf8Error {
+    valid_up_to: usize,
+}
+
+impl Utf8Error {
+    /// Returns the offset of the first byte that is not part of a valid UTF-8
+    /// encoded codepoint. Every byte preceding this offset is valid UTF-8.
+    ///
+    /// This has the same meaning as the offset returned by
+    /// `std::str::Utf8Error::valid_up_to`.
+    pub fn valid_up_to(&self) -> usize {
+        self.valid_up_to
+    }
+}
+
+#[cfg(feature = "std")]
+impl ::std::error::Error for Utf8Error {
+    fn description(&self) -> &str {
+        "invalid UTF-8"
+    }
+}
+
+impl fmt::Display for Utf8Error {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        write!(f, "invalid UTF-8 sequence at offset {}", self.valid_up_to)
+    }
+}
+
+/// An incremental UTF-8 validator over a single haystack.
+///
+/// The validator tracks the length of the longest prefix of the haystack
+/// that is known to be valid. This always ends on a codepoint boundary.
+///
+/// Once invalid UTF-8 has been found, the prefix stops growing and every
+/// subsequent attempt to validate more of the haystack fails. This lets a
+/// search finish with the valid bytes preceding an error before the error is
+/// reported, even though validation runs ahead of the search.
+#[derive(Clone, Debug)]
+pub(crate) struct Validator {
+    valid_up_to: usize,
+    invalid: bool,
+}
+
+impl Validator {
+    /// Create a new validator that has validated nothing.
+    pub fn new() -> Validator {
+        Validator { valid_up_to: 0, invalid: false }
+    }
+
+    /// Validate the next chunk of the given haystack.
+    ///
+    /// This only returns an error if no more of the haystack can be
+    /// validated.
+    pub fn advance(&mut self, bytes: &[u8]) -> Result<(), Utf8Error> {
+        let end = cmp::min(self.valid_up_to + CHUNK, bytes.len());
+        self.validate_to(bytes, end)
+    }
+
+    /// Validate the remainder of the given haystack.
+    pub fn finish(&mut self, bytes: &[u8]) -> Result<(), Utf8Error> {
+        let end = bytes.len();
+        self.validate_to(bytes, end)?;
+        if self.invalid {
+            return Err(Utf8Error { valid_up_to: self.valid_up_to });
+        }
+        Ok(())
+    }
+
+    fn validate_to(
+        &mut self,
+        bytes: &[u8],
+        end: usize,
+    ) -> Result<(), Utf8Error> {
+        if self.invalid {
+            return Err(Utf8Error { valid_up_to: self.valid_up_to });
+        }
+        match validate(bytes, self.valid_up_to, end) {
+            Ok(valid_up_to) => self.valid_up_to = valid_up_to,
+            Err(err) => {
+                self.invalid = true;
+                if err.valid_up_to == self.valid_up_to {
+                    return Err(err);
+                }
+                self.valid_up_to = err.valid_up_to;
+            }
+        }
+        Ok(())
+    }
+}
+
+/// Execute a leftmost first search with the given DFA starting at `start`,
+/// while validating the haystack with the given validator as the search
+/// proceeds.
+///
+/// This behaves exactly like `DFA::find_at`, except that the search stops
+/// when the DFA would read a byte that belongs to an invalid UTF-8 sequence,
+/// as if the haystack ended just before it. If a match was found by then, it
+/// is returned, and otherwise an error is returned. Validation happens one
+/// chunk at a time just before the DFA reads the chunk, so that the haystack
+/// is only brought into cache once.
+#[inline(never)]
+pub(crate) fn find_at<D: DFA + ?Sized>(
+    dfa: &D,
+    validator: &mut Validator,
+    bytes: &[u8],
+    start: usize,
+) -> Result<Option<usize>, Utf8Error> {
+    if dfa.is_anchored() && start > 0 {
+        return Ok(None);
+    }
+    let mut state = dfa.start_state();
+    trace_start!(state);
+    let mut last_match = if dfa.is_dead_state(state) {
+        return Ok(None);
+    } else if dfa.is_match_state(state) {
+        Some(start)
+    } else {
+        None
+    };
+    let mut at = start;
+    while at < bytes.len() {
+        if at >= validator.valid_up_to {
+            if let Err(err) = validator.advance(bytes) {
+                // The error is reported by the next search, which can't
+                // read any further than this one.
+                return last_match.map(Some).ok_or(err);
+            }
+        }
+        let end = cmp::min(validator.valid_up_to, bytes.len());
+        while at < end {
+            let b = unsafe { *bytes.get_unchecked(at) };
+            let next = unsafe { dfa.next_state_unchecked(state, b) };
+            trace_transition!(state, b, next);
+            state = next;
+            at += 1;
+            if dfa.is_match_or_dead_state(state) {
+                if dfa.is_dead_state(state) {
+                    return Ok(last_match);
+                }
+                last_match = Some(at);
+            }
+        }
+    }
+    Ok(last_match)
+}
+
+/// Validate `bytes[at..end]`, where `at` must be on a codepoint boundary.
+///
+/// If the last codepoint starting before `end` extends past `end`, then
+/// validation continues until the end of that codepoint. On success, the
+/// offset at which validation stopped is returned, which is always on a
+/// codepoint boundary and no less than `end`.
+fn validate(
+    bytes: &[u8],
+    mut at: usize,
+    end: usize,
+) -> Result<usize, Utf8Error> {
+    while at < end {
+        if bytes[at] < 0x80 {
+            // Most text is ASCII, so skip over it two words at a time before
+            // falling back to checking one byte at a time.
+            while at + 2 * WORD <= end {
+                let (a, b) = unsafe {
+                    let p = bytes.as_ptr().add(at) as *const usize;
+                    (ptr::read_unaligned(p), ptr::read_unaligned(p.add(1)))
+                };
+                if (a | b) & HIGH_BITS != 0 {
+                    break;
+                }
+                at += 2 * WORD;
+            }
+            while at < end && bytes[at] < 0x80 {
+                at += 1;
+            }
+        } else {
+            at = validate_multi_byte(bytes, at)?;
+        }
+    }
+    Ok(at)
+}
+
+/// Validate the multi-byte codepoint beginning at `bytes[at]` and return the
+/// offset immediately following it.
+///
+/// This follows the table of well-formed byte sequences in the Unicode
+/// standard (Table 3-7), which rejects overlong encodings, surrogates and
+/// codepoints greater than `U+10FFFF`.
+fn validate_multi_byte(bytes: &[u8], at: usize) -> Result<usize, Utf8Error> {
+    let err = Utf8Error { valid_up_to: at };
+    let cont = |i: usize, lo: u8, hi: u8| -> Result<(), Utf8Error> {
+        match bytes.get(at + i) {
+            Some(&b) if lo <= b && b <= hi => Ok(()),
+            _ => Err(err),
+        }
+    };
+    let len = match bytes[at] {
+        0xC2..=0xDF => 2,
+        0xE0 => {
+            cont(1, 0xA0, 0xBF)?;
+            3
+        }
+        0xE1..=0xEC | 0xEE..=0xEF => {
+            cont(1, 0x80, 0xBF)?;
+            3
+        }
+        0xED => {
+            cont(1, 0x80, 0x9F)?;
+            3
+        }
+        0xF0 => {
+            cont(1, 0x90, 0xBF)?;
+            4
+        }
+        0xF1..=0xF3 => {
+            cont(1, 0x80, 0xBF)?;
+            4
+        }
+        0xF4 => {
+            cont(1, 0x80, 0x8F)?;
+            4
+        }
+        _ => return Err(err),
+    };
+    // The second byte of three and four byte sequences was checked above.
+    let first = if len == 2 { 1 } else { 2 };
+    for i in first..len {
+        cont(i, 0x80, 0xBF)?;
+    }
+    Ok(at + len)
+}
+
+#[cfg(all(test, feature = "std"))]
+mod tests {
+    use super::{validate, Utf8Error, Validator, CHUNK};
+    use std::str;
+
+    fn check(bytes: &[u8]) {
+        let expected = str::from_utf8(bytes)
+            .map(|_| ())
+            .map_err(|e| Utf8Error { valid_up_to: e.valid_up_to() });
+        let got = validate(bytes, 0, bytes.len()).map(|_| ());
+        assert_eq!(expected, got, "{:?}", bytes);
+    }
+
+    #[test]
+    fn agrees_with_std() {
+        let cases: &[&[u8]] = &[
+            b"",
+            b"abcdefghijklmnopqrstuvwxyz0123456789",
+            "☃ snowman ☃ and 𝛃 and Ω".as_bytes(),
+            b"\xC0\x80",
+            b"\xC2",
+            b"\xE0\x80\x80",
+            b"\xED\xA0\x80",
+            b"\xEF\xBF\xBF",
+            b"\xF0\x8F\xBF\xBF",
+            b"\xF4\x90\x80\x80",
+            b"\xF4\x8F\xBF\xBF",
+            b"\xF5\x80\x80\x80",
+            b"\x80",
+            b"abcdefghijklmnopqrstuvwxyz\xFFabc",
+            b"abcdefghijklmnopqrstuvwxyz\xE2\x98",
+        ];
+        for &case in cases {
+            check(case);
+        }
+        for b1 in 0..=255u8 {
+            for &b2 in &[0x00, 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF, 0xC0]
+            {
+                check(&[b1, b2, 0x80, 0x80]);
+                check(&[b1, b2, 0x80]);
+                check(&[b'a', b1, b2]);
+            }
+        }
+    }
+
+    #[test]
+    fn codepoint_across_chunks() {
+        let mut bytes = vec![b'a'; CHUNK - 1];
+        bytes.extend_from_slice("☃".as_bytes());
+        bytes.push(b'b');
+
+        let mut v = Validator::new();
+        v.advance(&bytes).unwrap();
+        assert_eq!(CHUNK + 2, v.valid_up_to);
+        v.finish(&bytes).unwrap();
+        assert_eq!(bytes.len(), v.valid_up_to);
+    }
+}
@@ -1,6 +1,7 @@
 use std::collections::BTreeMap;
 use std::env;
 use std::fmt::{self, Write};
+use std::str;
 use std::thread;
 
 use regex;
@@ -269,13 +270,31 @@ impl RegexTester {
             .find_iter(&test.input)
             .map(|(start, end)| Match { start, end })
             .collect();
-        if got == test.matches {
+        if got != test.matches {
+            self.results.failed.push(RegexTestFailure {
+                test: test.clone(),
+                kind: RegexTestFailureKind::FindIter { got },
+            });
+            return;
+        }
+
+        // The fused UTF-8 validating search must find the same matches on
+        // valid UTF-8, and must report the same error as std otherwise.
+        let expected = str::from_utf8(&test.input)
+            .map(|_| test.matches.clone())
+            .map_err(|e| e.valid_up_to());
+        let got = re
+            .find_iter_validated(&test.input)
+            .map(|m| m.map(|(start, end)| Match { start, end }))
+            .collect::<Result<Vec<Match>, _>>()
+            .map_err(|e| e.valid_up_to());
+        if got == expected {
             self.results.succeeded.push(test.clone());
             return;
         }
         self.results.failed.push(RegexTestFailure {
             test: test.clone(),
-            kind: RegexTestFailureKind::FindIter { got },
+            kind: RegexTestFailureKind::FindIterValidated { got },
         });
     }
 
@@ -338,6 +357,7 @@ pub enum RegexTestFailureKind {
     IsMatch,
     Find { got: Option<Match> },
     FindIter { got: Vec<Match> },
+    FindIterValidated { got: Result<Vec<Match>, usize> },
 }
 
 impl RegexTestResults {
@@ -409,6 +429,11 @@ impl RegexTestFailureKind {
                 "expected {:?}, but found {:?}",
                 test.matches, got
             )?,
+            RegexTestFailureKind::FindIterValidated { ref got } => write!(
+                buf,
+                "expected {:?} from a validating search, but found {:?}",
+                test.matches, got
+            )?,
         }
         Ok(buf)
     }
@@ -0,0 +1,290 @@
+// Checks the C++ headers against the Rust engine. This compiles the programs
+// in tests/cpp with the C++ compiler in `$CXX` (or `c++`), and is skipped
+// when there isn't one.
+//
+// The search routines in clamor_dfa.h are checked by conformance.cpp, and
+// the wrapper in clamor_regex.hpp by wrapper.cpp. The latter is linked with
+// the shared library built from this crate, and is skipped when that isn't
+// available.
+
+use std::env;
+use std::ffi::{OsStr, OsString};
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::process::Command;
+
+use byteorder::{ByteOrder, NativeEndian};
+use regex_automata::{dense, DenseDFA, Regex, RegexBuilder, StateID, DFA};
+
+const PATTERNS: &[&str] = &[
+    r"[a-z]+[0-9]",
+    r"foo|foobar|bar",
+    r"a*",
+    r"(?-u)\w+\s+\w+",
+    r"quux-?[a-z]*",
+    r"[0-9]{2,4}",
+    r"b[a-z ]*",
+];
+
+const HAYSTACKS: &[&str] = &[
+    "",
+    "a",
+    "abc1",
+    "xyz 12 foobar quux",
+    "foofoobarbaz",
+    "aaabaa",
+    "hello world\nbye now",
+    "1234",
+    "12345",
+    "quux-quuxx quux",
+    "no digits here\nbar",
+];
+
+/// Compile `tests/cpp/{name}.cpp` with the given extra arguments, returning
+/// the path to the program, or None if there is no C++ compiler.
+fn compile(name: &str, args: &[&OsStr]) -> Option<PathBuf> {
+    let cxx = env::var("CXX").unwrap_or("c++".to_string());
+    let root = Path::new(env!("CARGO_MANIFEST_DIR"));
+    let exe = env::temp_dir().join(format!(
+        "clamor-{}-{}",
+        name,
+        std::process::id()
+    ));
+    let status = Command::new(&cxx)
+        .arg("-O2")
+        .arg("-Wall")
+        .arg("-Werror")
+        .arg("-I")
+        .arg(root)
+        .arg(root.join("tests").join("cpp").join(format!("{}.cpp", name)))
+        .arg("-o")
+        .arg(&exe)
+        .args(args)
+        .status();
+    match status {
+        Err(_) => None,
+        Ok(status) => {
+            assert!(status.success(), "failed to compile {}.cpp", name);
+            Some(exe)
+        }
+    }
+}
+
+/// The shared library built from this crate, which cargo puts in the parent
+/// of the `deps` directory holding this test.
+fn cdylib() -> Option<PathBuf> {
+    let exe = env::current_exe().ok()?;
+    let dir = exe.parent()?.parent()?;
+    let name = if cfg!(target_os = "macos") {
+        "libregex_automata.dylib"
+    } else {
+        "libregex_automata.so"
+    };
+    let path = dir.join(name);
+    if path.exists() {
+        Some(path)
+    } else {
+        None
+    }
+}
+
+/// Write `HAYSTACKS` to a file in the format the C++ programs read: each
+/// haystack prefixed by its length as a native endian u64.
+fn write_haystacks(path: &Path) {
+    let mut hays = vec![];
+    for hay in HAYSTACKS {
+        let mut len = [0; 8];
+        NativeEndian::write_u64(&mut len, hay.len() as u64);
+        hays.extend_from_slice(&len);
+        hays.extend_from_slice(hay.as_bytes());
+    }
+    fs::write(path, &hays).unwrap();
+}
+
+fn offset(o: Option<usize>) -> String {
+    o.map_or("-".to_string(), |o| o.to_string())
+}
+
+fn matches<D: DFA>(re: &Regex<D>, hay: &[u8]) -> String {
+    let iter: Vec<String> =
+        re.find_iter(hay).map(|(s, e)| format!("{}-{}", s, e)).collect();
+    if iter.is_empty() {
+        "-".to_string()
+    } else {
+        iter.join(",")
+    }
+}
+
+/// Format the results of the Rust engine the same way as the conformance
+/// program.
+fn expected<D: DFA>(re: &Regex<D>, hay: &[u8]) -> String {
+    format!(
+        "is_match={} shortest={} find={} rfind={} iter={}\n",
+        re.forward().is_match(hay) as u8,
+        offset(re.forward().shortest_match(hay)),
+        offset(re.forward().find(hay)),
+        offset(re.reverse().rfind(hay)),
+        matches(re, hay),
+    )
+}
+
+fn check<T: AsRef<[S]>, S: StateID>(
+    exe: &Path,
+    name: &str,
+    re: &Regex<DenseDFA<T, S>>,
+) {
+    let dir = env::temp_dir();
+    let prefix = format!("clamor-conformance-{}-{}", std::process::id(), name);
+    let fwd_path = dir.join(format!("{}.fwd", prefix));
+    let rev_path = dir.join(format!("{}.rev", prefix));
+    let hay_path = dir.join(format!("{}.hay", prefix));
+
+    let mut want = String::new();
+    for hay in HAYSTACKS {
+        want.push_str(&expected(re, hay.as_bytes()));
+    }
+    fs::write(&fwd_path, re.forward().to_bytes_native_endian().unwrap())
+        .unwrap();
+    fs::write(&rev_path, re.reverse().to_bytes_native_endian().unwrap())
+        .unwrap();
+    write_haystacks(&hay_path);
+
+    let out = Command::new(exe)
+        .arg(&fwd_path)
+        .arg(&rev_path)
+        .arg(&hay_path)
+        .output();
+    let _ = fs::remove_file(&fwd_path);
+    let _ = fs::remove_file(&rev_path);
+    let _ = fs::remove_file(&hay_path);
+    let out = out.unwrap();
+    assert!(
+        out.status.success(),
+        "{}: {}",
+        name,
+        String::from_utf8_lossy(&out.stderr)
+    );
+    let got = String::from_utf8(out.stdout).unwrap();
+    assert_eq!(want, got, "{}", name);
+}
+
+#[test]
+fn conformance() {
+    let exe = match compile("conformance", &["-std=c++11".as_ref()]) {
+        None => return,
+        Some(exe) => exe,
+    };
+    for (i, pattern) in PATTERNS.iter().enumerate() {
+        let name = |config: &str| format!("{}-{}", i, config);
+        for &premultiply in &[false, true] {
+            for &byte_classes in &[false, true] {
+                let re = RegexBuilder::new()
+                    .premultiply(premultiply)
+                    .byte_classes(byte_classes)
+                    .build(pattern)
+                    .unwrap();
+                let config = format!("p{}b{}", premultiply, byte_classes);
+                check(&exe, &name(&config), &re);
+            }
+        }
+
+        let re = RegexBuilder::new().minimize(true).build(pattern).unwrap();
+        let (fwd, rev) = (re.forward(), re.reverse());
+        if let (Ok(f), Ok(r)) = (fwd.to_u8(), rev.to_u8()) {
+            check(&exe, &name("u8"), &Regex::from_dfas(f, r));
+        }
+        let re16 =
+            Regex::from_dfas(fwd.to_u16().unwrap(), rev.to_u16().unwrap());
+        check(&exe, &name("u16"), &re16);
+        let re32 =
+            Regex::from_dfas(fwd.to_u32().unwrap(), rev.to_u32().unwrap());
+        check(&exe, &name("u32"), &re32);
+        let re64 =
+            Regex::from_dfas(fwd.to_u64().unwrap(), rev.to_u64().unwrap());
+        check(&exe, &name("u64"), &re64);
+
+        let re = RegexBuilder::new()
+            .premultiply(false)
+            .power_of_two_stride(true)
+            .build(pattern)
+            .unwrap();
+        check(&exe, &name("pow2"), &re);
+
+        let re = RegexBuilder::new().dual_start(true).build(pattern).unwrap();
+        check(&exe, &name("dual"), &re);
+
+        let re = RegexBuilder::new().anchored(true).build(pattern).unwrap();
+        check(&exe, &name("anchored"), &re);
+
+        let fwd = dense::Builder::new().quit(b'\n', true).build(pattern);
+        let rev = dense::Builder::new()
+            .anchored(true)
+            .reverse(true)
+            .longest_match(true)
+            .quit(b'\n', true)
+            .build(pattern);
+        check(
+            &exe,
+            &name("quit"),
+            &Regex::from_dfas(fwd.unwrap(), rev.unwrap()),
+        );
+    }
+    let _ = fs::remove_file(&exe);
+}
+
+#[test]
+fn wrapper() {
+    let lib = match cdylib() {
+        None => return,
+        Some(lib) => lib,
+    };
+    let dir = lib.parent().unwrap();
+    let mut rpath = OsString::from("-Wl,-rpath,");
+    rpath.push(dir);
+    let args: &[&OsStr] = &[
+        "-std=c++17".as_ref(),
+        "-L".as_ref(),
+        dir.as_ref(),
+        "-lregex_automata".as_ref(),
+        &rpath,
+    ];
+    let exe = match compile("wrapper", args) {
+        None => return,
+        Some(exe) => exe,
+    };
+    let hay_path = env::temp_dir()
+        .join(format!("clamor-wrapper-{}.hay", std::process::id()));
+    write_haystacks(&hay_path);
+
+    let run = |pattern: &str| {
+        let out = Command::new(&exe).arg(pattern).arg(&hay_path).output();
+        let out = out.unwrap();
+        assert!(
+            out.status.success(),
+            "{}: {}",
+            pattern,
+            String::from_utf8_lossy(&out.stderr)
+        );
+        String::from_utf8(out.stdout).unwrap()
+    };
+    for pattern in PATTERNS {
+        let re = Regex::new(pattern).unwrap();
+        let mut want = String::new();
+        // The wrapper ends with a search of a null, empty string_view.
+        for hay in HAYSTACKS.iter().chain(&[""]) {
+            let hay = hay.as_bytes();
+            let find = re.find(hay).map(|(s, e)| format!("{}-{}", s, e));
+            want.push_str(&format!(
+                "is_match={} find={} iter={}\n",
+                re.is_match(hay) as u8,
+                find.unwrap_or("-".to_string()),
+                matches(&re, hay),
+            ));
+        }
+        assert_eq!(want, run(pattern), "{}", pattern);
+    }
+    assert!(run("(").starts_with("error "));
+
+    let _ = fs::remove_file(&hay_path);
+    let _ = fs::remove_file(&exe);
+}
@@ -0,0 +1,130 @@
+// Runs the searches in clamor_dfa.h over a list of haystacks and prints
+// their results, so that tests/cpp.rs can compare them with the results of
+// the Rust engine.
+//
+// Usage: conformance <forward DFA> <reverse DFA> <haystacks>
+//
+// Both DFAs are files written by `DenseDFA::to_bytes_native_endian`. The
+// haystacks file is a sequence of haystacks, each prefixed by its length as
+// a native endian u64. For each haystack, this prints one line:
+//
+//     is_match=1 shortest=3 find=5 rfind=0 iter=0-3,5-7
+//
+// where `-` stands for no match. `rfind` is computed with the reverse DFA.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "clamor_dfa.h"
+
+namespace {
+
+// Read a whole file into a buffer aligned to 8 bytes, which suits state
+// identifiers of every size.
+std::vector<uint64_t> read_file(const char* path, size_t* len) {
+  std::vector<uint64_t> buf;
+  FILE* f = std::fopen(path, "rb");
+  if (f == nullptr) {
+    std::fprintf(stderr, "could not open %s\n", path);
+    std::exit(2);
+  }
+  std::string bytes;
+  char chunk[4096];
+  size_t n;
+  while ((n = std::fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    bytes.append(chunk, n);
+  }
+  std::fclose(f);
+  buf.resize(bytes.size() / 8 + 1);
+  std::memcpy(buf.data(), bytes.data(), bytes.size());
+  *len = bytes.size();
+  return buf;
+}
+
+void print_offset(size_t offset) {
+  if (offset == clamor::NO_MATCH) {
+    std::printf("-");
+  } else {
+    std::printf("%zu", offset);
+  }
+}
+
+struct Run {
+  const std::vector<uint64_t>* reverse_buf;
+  size_t reverse_len;
+  const std::vector<std::string>* haystacks;
+
+  template <typename DFA>
+  void operator()(const DFA& forward) const {
+    DFA reverse;
+    clamor::LoadError err =
+        DFA::from_bytes(reverse_buf->data(), reverse_len, &reverse);
+    if (err != clamor::LoadError::None) {
+      std::fprintf(stderr, "could not load reverse DFA: %d\n",
+                   static_cast<int>(err));
+      std::exit(2);
+    }
+    clamor::Regex<DFA> re(forward, reverse);
+    for (size_t i = 0; i < haystacks->size(); i++) {
+      const std::string& hay = (*haystacks)[i];
+      const uint8_t* text = reinterpret_cast<const uint8_t*>(hay.data());
+      size_t len = hay.size();
+      std::printf("is_match=%d shortest=", forward.is_match(text, len));
+      print_offset(forward.shortest_match(text, len));
+      std::printf(" find=");
+      print_offset(forward.find(text, len));
+      std::printf(" rfind=");
+      print_offset(reverse.rfind(text, len));
+      std::printf(" iter=");
+      typename clamor::Regex<DFA>::Matches it = re.find_iter(text, len);
+      size_t s, e;
+      bool first = true;
+      while (it.next(&s, &e)) {
+        std::printf("%s%zu-%zu", first ? "" : ",", s, e);
+        first = false;
+      }
+      if (first) {
+        std::printf("-");
+      }
+      std::printf("\n");
+    }
+  }
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 4) {
+    std::fprintf(stderr, "usage: %s <forward> <reverse> <haystacks>\n",
+                 argv[0]);
+    return 2;
+  }
+  size_t forward_len, reverse_len, haystacks_len;
+  std::vector<uint64_t> forward = read_file(argv[1], &forward_len);
+  std::vector<uint64_t> reverse = read_file(argv[2], &reverse_len);
+  std::vector<uint64_t> raw = read_file(argv[3], &haystacks_len);
+
+  std::vector<std::string> haystacks;
+  const char* p = reinterpret_cast<const char*>(raw.data());
+  const char* end = p + haystacks_len;
+  while (p < end) {
+    uint64_t len;
+    std::memcpy(&len, p, sizeof(len));
+    p += sizeof(len);
+    haystacks.push_back(std::string(p, static_cast<size_t>(len)));
+    p += len;
+  }
+
+  Run run = {&reverse, reverse_len, &haystacks};
+  clamor::LoadError err =
+      clamor::with_dense_dfa(forward.data(), forward_len, run);
+  if (err != clamor::LoadError::None) {
+    std::fprintf(stderr, "could not load forward DFA: %d\n",
+                 static_cast<int>(err));
+    return 2;
+  }
+  return 0;
+}
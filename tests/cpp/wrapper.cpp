@@ -0,0 +1,117 @@
+// Exercises clamor_regex.hpp against the Rust library, so that tests/cpp.rs
+// can compare its results with those of the Rust engine.
+//
+// Usage: wrapper <pattern> <haystacks>
+//
+// The haystacks file has the same format as for conformance.cpp. For each
+// haystack, this prints one line:
+//
+//     is_match=1 find=0-3 iter=0-3,5-7
+//
+// where `-` stands for no match. The matches are fetched with several batch
+// sizes, which must all agree, and also with a regex built with the
+// `parallel` option. A final line, in the same format, is printed
+// for a default constructed `std::string_view`, whose data pointer is null.
+// If the pattern is invalid, this prints `error` followed by the error
+// message instead.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "clamor_regex.hpp"
+
+namespace {
+
+std::string read_file(const char* path) {
+  FILE* f = std::fopen(path, "rb");
+  if (f == nullptr) {
+    std::fprintf(stderr, "could not open %s\n", path);
+    std::exit(2);
+  }
+  std::string bytes;
+  char chunk[4096];
+  size_t n;
+  while ((n = std::fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    bytes.append(chunk, n);
+  }
+  std::fclose(f);
+  return bytes;
+}
+
+template <size_t BatchSize>
+std::string matches(const clamor::Regex& re, std::string_view hay) {
+  std::string out;
+  for (clamor::Match m : re.find_iter<BatchSize>(hay)) {
+    if (!out.empty()) {
+      out += ",";
+    }
+    out += std::to_string(m.start) + "-" + std::to_string(m.end);
+  }
+  return out.empty() ? "-" : out;
+}
+
+// Print the results of searching `hay`, returning false if the batch sizes
+// or the two regexes disagree.
+bool print_results(const clamor::Regex& re,
+                   const clamor::Regex& parallel,
+                   std::string_view hay) {
+  std::string iter = matches<64>(re, hay);
+  if (matches<1>(re, hay) != iter || matches<2>(re, hay) != iter) {
+    std::fprintf(stderr, "batch sizes disagree\n");
+    return false;
+  }
+  if (matches<64>(parallel, hay) != iter) {
+    std::fprintf(stderr, "parallel build disagrees\n");
+    return false;
+  }
+  std::optional<clamor::Match> first = re.find(hay);
+  std::printf("is_match=%d find=", re.is_match(hay));
+  if (first) {
+    std::printf("%zu-%zu", first->start, first->end);
+  } else {
+    std::printf("-");
+  }
+  std::printf(" iter=%s\n", iter.c_str());
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    std::fprintf(stderr, "usage: %s <pattern> <haystacks>\n", argv[0]);
+    return 2;
+  }
+  clamor::Expected<clamor::Regex> built = clamor::Regex::build(argv[1]);
+  if (!built) {
+    std::printf("error %s\n", built.error().message().c_str());
+    return 0;
+  }
+  // A null, empty pattern is the empty regex.
+  if (!clamor::Regex::build(std::string_view{})) {
+    std::fprintf(stderr, "could not build the empty regex\n");
+    return 1;
+  }
+  // Exercise moving the regex out of its `Expected`.
+  clamor::Regex re = std::move(built).value();
+  clamor::Regex parallel =
+      clamor::Regex::build(argv[1], clamor::Options().parallel(true)).value();
+
+  std::string raw = read_file(argv[2]);
+  const char* p = raw.data();
+  const char* end = p + raw.size();
+  while (p < end) {
+    uint64_t len;
+    std::memcpy(&len, p, sizeof(len));
+    p += sizeof(len);
+    std::string_view hay(p, static_cast<size_t>(len));
+    p += len;
+    if (!print_results(re, parallel, hay)) {
+      return 1;
+    }
+  }
+  return print_results(re, parallel, std::string_view{}) ? 0 : 1;
+}
@@ -1,4 +1,6 @@
 #[cfg(feature = "std")]
+extern crate byteorder;
+#[cfg(feature = "std")]
 #[macro_use]
 extern crate lazy_static;
 #[cfg(feature = "std")]
@@ -18,6 +20,8 @@ extern crate toml;
 #[cfg(feature = "std")]
 mod collection;
 #[cfg(feature = "std")]
+mod cpp;
+#[cfg(feature = "std")]
 mod regression;
 #[cfg(feature = "std")]
 mod suite;